@@ -0,0 +1,309 @@
+#include "ap_datapackage.h"
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+
+namespace Archipelago {
+
+static uint32_t HashName(const char* name, size_t len)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) h = (h ^ uint8_t(name[i])) * 16777619u;
+    return h;
+}
+
+static size_t HashId(int64_t id)
+{
+    uint64_t h = uint64_t(id) * 0x9E3779B97F4A7C15ull;
+    return size_t(h ^ (h >> 32));
+}
+
+//
+// APNameTable
+//
+
+void APNameTable::Build(const nlohmann::json& name_to_id)
+{
+    names_.clear();
+    entries_.clear();
+    if (!name_to_id.is_object())
+        return;
+
+    entries_.reserve(name_to_id.size());
+    for (auto it = name_to_id.begin(); it != name_to_id.end(); ++it)
+    {
+        if (!it.value().is_number_integer())
+            continue;
+        const std::string& name = it.key();
+        entries_.push_back({ it.value().get<int64_t>(), uint32_t(names_.size()), HashName(name.data(), name.size()) });
+        names_.append(name);
+        names_.push_back('\0');
+    }
+
+    // Keep the tables at most half full so that probe sequences stay short.
+    size_t size = 16;
+    while (size < entries_.size() * 2) size <<= 1;
+    mask_ = size - 1;
+    by_id_.assign(size, -1);
+    by_name_.assign(size, -1);
+
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        size_t slot = HashId(entries_[i].id) & mask_;
+        while (by_id_[slot] >= 0) slot = (slot + 1) & mask_;
+        by_id_[slot] = int32_t(i);
+
+        slot = entries_[i].hash & mask_;
+        while (by_name_[slot] >= 0) slot = (slot + 1) & mask_;
+        by_name_[slot] = int32_t(i);
+    }
+}
+
+const char* APNameTable::GetName(int64_t id) const
+{
+    if (entries_.empty())
+        return nullptr;
+
+    for (size_t slot = HashId(id) & mask_; by_id_[slot] >= 0; slot = (slot + 1) & mask_)
+    {
+        const Entry& entry = entries_[by_id_[slot]];
+        if (entry.id == id)
+            return names_.c_str() + entry.name;
+    }
+    return nullptr;
+}
+
+bool APNameTable::GetId(const std::string& name, int64_t& id) const
+{
+    if (entries_.empty())
+        return false;
+
+    uint32_t hash = HashName(name.data(), name.size());
+    for (size_t slot = hash & mask_; by_name_[slot] >= 0; slot = (slot + 1) & mask_)
+    {
+        const Entry& entry = entries_[by_name_[slot]];
+        if (entry.hash == hash && name == names_.c_str() + entry.name)
+        {
+            id = entry.id;
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// APDataPackage
+//
+
+void APDataPackage::SetCacheDirectory(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(path, ec);
+    cache_dir_ = path;
+}
+
+nlohmann::json APDataPackage::LoadCache()
+{
+    nlohmann::json result;
+    result["games"] = nlohmann::json::object();
+    if (cache_dir_.empty())
+        return result;
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    GameMap games = *Games();
+    struct CachedGame {
+        std::filesystem::file_time_type time;
+        std::filesystem::path path;
+    };
+    std::map<std::string, CachedGame> newest;
+    std::vector<std::filesystem::path> superseded;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir_, ec))
+    {
+        if (entry.path().extension() != ".json")
+            continue;
+
+        try
+        {
+            std::ifstream file(entry.path());
+            nlohmann::json j;
+            file >> j;
+            std::string game = j.value("game", "");
+            if (game.empty() || !j.contains("package"))
+                continue;
+
+            // Several versions of a game may be cached. The newest one is the likeliest
+            // to be wanted, the others are not needed anymore.
+            auto time = entry.last_write_time(ec);
+            auto found = newest.find(game);
+            if (found != newest.end() && found->second.time >= time)
+            {
+                superseded.push_back(entry.path());
+                continue;
+            }
+            if (found != newest.end())
+                superseded.push_back(found->second.path);
+            newest[game] = { time, entry.path() };
+
+            AddGame(games, game, j["package"], false);
+            result["games"][game] = std::move(j["package"]);
+        }
+        catch (const std::exception&)
+        {
+            // Damaged cache entries just get downloaded again.
+        }
+    }
+
+    for (const auto& path : superseded)
+        std::filesystem::remove(path, ec);
+
+    std::atomic_store(&games_, std::shared_ptr<const GameMap>(std::make_shared<GameMap>(std::move(games))));
+    return result;
+}
+
+void APDataPackage::AddGames(const nlohmann::json& games)
+{
+    if (!games.is_object())
+        return;
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    GameMap newgames = *Games();
+    for (auto it = games.begin(); it != games.end(); ++it)
+    {
+        AddGame(newgames, it.key(), it.value(), true);
+    }
+    std::atomic_store(&games_, std::shared_ptr<const GameMap>(std::make_shared<GameMap>(std::move(newgames))));
+}
+
+void APDataPackage::AddGame(GameMap& games, const std::string& game, const nlohmann::json& package, bool save)
+{
+    auto tables = std::make_shared<GameTables>();
+    tables->checksum = package.value("checksum", "");
+
+    auto existing = games.find(game);
+    if (existing != games.end() && !tables->checksum.empty() && existing->second->checksum == tables->checksum)
+        return;
+
+    if (package.contains("item_name_to_id"))
+        tables->items.Build(package["item_name_to_id"]);
+    if (package.contains("location_name_to_id"))
+        tables->locations.Build(package["location_name_to_id"]);
+    games[game] = tables;
+
+    // Packages without a checksum cannot be validated later, so they are not cached.
+    if (save && !cache_dir_.empty() && !tables->checksum.empty())
+    {
+        nlohmann::json j;
+        j["game"] = game;
+        j["package"] = package;
+
+        std::string filename = cache_dir_ + "/" + tables->checksum + ".json";
+        std::ofstream file(filename + ".tmp", std::ios::trunc);
+        file << j.dump();
+        file.close();
+
+        std::error_code ec;
+        if (file.good()) std::filesystem::rename(filename + ".tmp", filename, ec);
+        PruneCache();
+    }
+}
+
+// Rooms with many games would otherwise grow the cache without limit.
+void APDataPackage::PruneCache()
+{
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir_, ec))
+    {
+        if (entry.path().extension() == ".json")
+            files.emplace_back(entry.last_write_time(ec), entry.path());
+    }
+    if (files.size() <= MaxCachedPackages)
+        return;
+
+    std::sort(files.begin(), files.end());
+    for (size_t i = 0; i < files.size() - MaxCachedPackages; i++)
+        std::filesystem::remove(files[i].second, ec);
+}
+
+std::shared_ptr<const APDataPackage::GameMap> APDataPackage::Games() const
+{
+    return std::atomic_load(&games_);
+}
+
+std::shared_ptr<const APDataPackage::GameTables> APDataPackage::FindGame(const std::string& game) const
+{
+    auto games = Games();
+    auto it = games->find(game);
+    return it != games->end() ? it->second : nullptr;
+}
+
+// The returned names share ownership of the tables they point into.
+static APName MakeName(const std::shared_ptr<const void>& owner, const char* name)
+{
+    return name ? APName(owner, name) : APName();
+}
+
+APName APDataPackage::GetItemName(const std::string& game, int64_t id) const
+{
+    auto tables = FindGame(game);
+    return tables ? MakeName(tables, tables->items.GetName(id)) : APName();
+}
+
+APName APDataPackage::GetLocationName(const std::string& game, int64_t id) const
+{
+    auto tables = FindGame(game);
+    return tables ? MakeName(tables, tables->locations.GetName(id)) : APName();
+}
+
+bool APDataPackage::GetItemId(const std::string& game, const std::string& name, int64_t& id) const
+{
+    auto tables = FindGame(game);
+    return tables && tables->items.GetId(name, id);
+}
+
+bool APDataPackage::GetLocationId(const std::string& game, const std::string& name, int64_t& id) const
+{
+    auto tables = FindGame(game);
+    return tables && tables->locations.GetId(name, id);
+}
+
+APName APDataPackage::GetItemName(int64_t id) const
+{
+    auto room = std::atomic_load(&room_games_);
+    for (const auto& game : *room)
+    {
+        auto tables = FindGame(game);
+        if (const char* name = tables ? tables->items.GetName(id) : nullptr)
+            return MakeName(tables, name);
+    }
+    return APName();
+}
+
+APName APDataPackage::GetLocationName(int64_t id) const
+{
+    auto room = std::atomic_load(&room_games_);
+    for (const auto& game : *room)
+    {
+        auto tables = FindGame(game);
+        if (const char* name = tables ? tables->locations.GetName(id) : nullptr)
+            return MakeName(tables, name);
+    }
+    return APName();
+}
+
+void APDataPackage::SetRoomGames(const std::vector<std::string>& games)
+{
+    auto room = std::make_shared<std::vector<std::string>>();
+    room->push_back("Archipelago");
+    for (const auto& game : games)
+    {
+        if (std::find(room->begin(), room->end(), game) == room->end())
+            room->push_back(game);
+    }
+    std::atomic_store(&room_games_, std::shared_ptr<const std::vector<std::string>>(std::move(room)));
+}
+
+} // namespace Archipelago
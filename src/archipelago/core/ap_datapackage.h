@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ap_types.h"
+#include "../dependencies/archipelago_fixes.h"
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Archipelago {
+
+// Flat open addressing tables for one name <-> id mapping. All names live in
+// one pool, so a lookup never allocates and the returned pointers stay valid
+// as long as the table does.
+class APNameTable {
+public:
+    void Build(const nlohmann::json& name_to_id);
+
+    const char* GetName(int64_t id) const;
+    bool GetId(const std::string& name, int64_t& id) const;
+    size_t Size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        int64_t id;
+        uint32_t name;      // offset into names_
+        uint32_t hash;      // hash of the name
+    };
+
+    std::string names_;
+    std::vector<Entry> entries_;
+    std::vector<int32_t> by_id_;
+    std::vector<int32_t> by_name_;
+    size_t mask_ = 0;
+};
+
+// A name from a DataPackage. It shares ownership of the tables it points
+// into, so it stays valid after a newer version of the game replaced them.
+using APName = std::shared_ptr<const char>;
+
+// The server's DataPackage for every game in the room.
+//
+// Packages are cached on disk by checksum, so they only get downloaded once
+// per game version. Each game's tables are immutable once built and the set
+// of games is replaced as a whole when a package arrives, so lookups from
+// the game thread never wait for the network thread. Replaced tables are
+// freed as soon as no reader holds a name from them anymore.
+class APDataPackage {
+public:
+    // The cache keeps at most this many packages, the least recently written ones go first.
+    static constexpr size_t MaxCachedPackages = 256;
+
+    void SetCacheDirectory(const std::string& path);
+
+    // Loads every cached package and returns them in DataPackage format, so
+    // that the client only requests games whose checksum it does not have.
+    nlohmann::json LoadCache();
+
+    // Takes the "games" object of a DataPackage packet.
+    void AddGames(const nlohmann::json& games);
+
+    // These return an empty name for unknown ids.
+    APName GetItemName(const std::string& game, int64_t id) const;
+    APName GetLocationName(const std::string& game, int64_t id) const;
+    bool GetItemId(const std::string& game, const std::string& name, int64_t& id) const;
+    bool GetLocationId(const std::string& game, const std::string& name, int64_t& id) const;
+
+    // Searches the games of the current room, for when the owner of an id is
+    // not known. The cache also holds packages of other rooms, whose ids may
+    // overlap, so nothing is found until SetRoomGames was called.
+    APName GetItemName(int64_t id) const;
+    APName GetLocationName(int64_t id) const;
+
+    // Takes the games of the room's players. The common "Archipelago" package is always included.
+    void SetRoomGames(const std::vector<std::string>& games);
+
+private:
+    struct GameTables {
+        std::string checksum;
+        APNameTable items;
+        APNameTable locations;
+    };
+    using GameMap = std::map<std::string, std::shared_ptr<const GameTables>>;
+
+    std::shared_ptr<const GameTables> FindGame(const std::string& game) const;
+    std::shared_ptr<const GameMap> Games() const;
+    void AddGame(GameMap& games, const std::string& game, const nlohmann::json& package, bool save);
+    void PruneCache();
+
+    std::string cache_dir_;
+    std::mutex write_mutex_;                // serializes writers, readers never take it
+    std::shared_ptr<const GameMap> games_ = std::make_shared<GameMap>();
+    std::shared_ptr<const std::vector<std::string>> room_games_ = std::make_shared<std::vector<std::string>>();
+};
+
+} // namespace Archipelago
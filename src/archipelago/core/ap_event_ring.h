@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Archipelago {
+
+// Fixed size single producer / single consumer queue.
+// Push is only ever called from one thread (the network thread) and
+// Front/Pop only from another (the game thread). Slots are reused, so
+// moving a value in and out does not allocate once the ring has warmed up.
+template<class T>
+class APEventRing {
+public:
+    explicit APEventRing(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        slots_ = std::make_unique<T[]>(size);
+    }
+
+    APEventRing(const APEventRing&) = delete;
+    APEventRing& operator=(const APEventRing&) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool Push(T&& value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_)
+            return false;
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Front returns nullptr if the ring is empty.
+    T* Front()
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots_[head & mask_];
+    }
+
+    void Pop()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool Empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace Archipelago
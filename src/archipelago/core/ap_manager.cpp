@@ -2,6 +2,9 @@
 #include "ap_network.h"
 #include "ap_state.h"
 #include "ap_protocol.h"
+#include "ap_datapackage.h"
+#include <cctype>
+#include <filesystem>
 
 // Include nlohmann/json
 #include "../dependencies/archipelago_fixes.h"
@@ -10,6 +13,7 @@
 #include "common/console/c_console.h"
 #include "d_main.h"
 #include "g_game.h"
+#include "i_specialpaths.h"
 
 namespace Archipelago {
 
@@ -17,6 +21,18 @@ namespace Archipelago {
 static Manager* s_instance = nullptr;
 static std::mutex s_instance_mutex;
 
+// Every slot on every server keeps its own state, next to the outbox.
+// Files that belong to one slot on one server, so that rooms never share them.
+static std::string RoomPath(const char* prefix, const std::string& server, const std::string& slot) {
+    std::string name = slot + "@" + server;
+    for (char& c : name) {
+        if (!isalnum((unsigned char)c) && c != '@' && c != '-' && c != '.') c = '_';
+    }
+    FString path = M_GetAppDataPath(true);
+    path << "/" << prefix << name.c_str() << ".json";
+    return path.GetChars();
+}
+
 Manager& Manager::GetInstance() {
     std::lock_guard<std::mutex> lock(s_instance_mutex);
     if (!s_instance) {
@@ -53,6 +69,13 @@ bool Manager::Initialize(const Config& config) {
         state_manager_ = std::make_unique<APStateManager>();
         protocol_handler_ = std::make_unique<APProtocolHandler>();
         
+        // DataPackages are cached by checksum, so reconnecting never downloads them again.
+        FString cache = M_GetCachePath(true);
+        cache << "/archipelago";
+        data_package_ = std::make_unique<APDataPackage>();
+        data_package_->SetCacheDirectory(cache.GetChars());
+        network_client_->SetDataPackage(data_package_.get());
+        
         // Set up network callbacks
         network_client_->on_connection_status_changed = [this](ConnectionStatus status) {
             std::lock_guard<std::mutex> lock(manager_mutex_);
@@ -115,6 +138,13 @@ bool Manager::Initialize(const Config& config) {
         network_client_->on_players_updated = [this](const std::vector<NetworkPlayer>& players) {
             std::lock_guard<std::mutex> lock(manager_mutex_);
             connected_players_ = players;
+            
+            // Names of ids without a known owner are only looked up in the games of this room.
+            std::vector<std::string> games;
+            for (const auto& player : players) {
+                games.push_back(player.game);
+            }
+            data_package_->SetRoomGames(games);
         };
         
         initialized_ = true;
@@ -145,6 +175,7 @@ void Manager::Shutdown() {
     protocol_handler_.reset();
     state_manager_.reset();
     network_client_.reset();
+    data_package_.reset();
     
     initialized_ = false;
     Printf("Archipelago: Shutdown complete\n");
@@ -173,6 +204,26 @@ bool Manager::Connect(const std::string& server, const std::string& slot_name,
     
     Printf("Archipelago: Connecting to %s as '%s'...\n", server.c_str(), slot_name.c_str());
     
+    // Checks the server never confirmed last time are sent again once this connection is up.
+    // Older versions kept a single outbox for every room. SetOutbox only takes
+    // its checks if they belong to this slot, the file itself is left alone.
+    std::string outbox = RoomPath("ap_outbox_", server, slot_name);
+    FString legacy = M_GetAppDataPath(true);
+    legacy << "/ap_outbox.json";
+    std::error_code ec;
+    if (!std::filesystem::exists(outbox, ec) && std::filesystem::exists(legacy.GetChars(), ec)) {
+        std::filesystem::copy_file(legacy.GetChars(), outbox, ec);
+    }
+    network_client_->SetOutbox(outbox, server, slot_name);
+    
+    // The previous room's games must not resolve this room's ids.
+    data_package_->SetRoomGames({});
+    
+    // Loads what this slot had so far. From here on checks and items only get appended to the journal.
+    if (state_manager_ && !state_manager_->OpenJournal(RoomPath("ap_state_", server, slot_name))) {
+        Printf("Archipelago: Unable to open the state journal, progress will not be saved\n");
+    }
+    
     // Connect
     if (!network_client_->Connect(uri, "Selaco")) {
         Printf("Archipelago: Failed to initiate connection\n");
@@ -191,6 +242,9 @@ void Manager::Disconnect() {
     if (network_client_) {
         network_client_->Disconnect();
     }
+    if (state_manager_) {
+        state_manager_->CloseJournal();
+    }
 }
 
 bool Manager::IsConnected() const {
@@ -206,7 +260,8 @@ ConnectionStatus Manager::GetConnectionStatus() const {
 void Manager::CheckLocation(int64_t location_id) {
     std::lock_guard<std::mutex> lock(manager_mutex_);
     
-    if (!network_client_ || !network_client_->IsConnected()) {
+    // Checks made while disconnected wait in the outbox.
+    if (!network_client_) {
         return;
     }
     
@@ -224,7 +279,7 @@ void Manager::CheckLocation(int64_t location_id) {
 void Manager::CheckLocations(const std::vector<int64_t>& location_ids) {
     std::lock_guard<std::mutex> lock(manager_mutex_);
     
-    if (!network_client_ || !network_client_->IsConnected() || !state_manager_) {
+    if (!network_client_ || !state_manager_) {
         return;
     }
     
@@ -258,7 +313,7 @@ void Manager::Update() {
     }
     
     // Process network events
-    network_client_->ProcessNetworkEvents();
+    network_client_->ProcessNetworkEvents(config_.max_items_per_tic, config_.max_messages_per_tic);
     
     // Update state manager
     if (state_manager_) {
@@ -300,6 +355,10 @@ Message Manager::GetNextMessage() {
     return Message{};
 }
 
+const APDataPackage* Manager::GetDataPackage() const {
+    return data_package_.get();
+}
+
 const std::vector<NetworkPlayer>& Manager::GetConnectedPlayers() const {
     return connected_players_;
 }
@@ -12,6 +12,7 @@ namespace Archipelago {
 class APNetworkClient;
 class APStateManager;
 class APProtocolHandler;
+class APDataPackage;
 
 class Manager {
 public:
@@ -65,6 +66,9 @@ public:
     Message GetNextMessage();
     std::vector<Message> GetAllMessages();
     
+    // Item and location names of all games in the room
+    const APDataPackage* GetDataPackage() const;
+    
     // Player info
     const std::vector<NetworkPlayer>& GetConnectedPlayers() const;
     const NetworkPlayer* GetPlayer(int slot) const;
@@ -85,6 +89,7 @@ private:
     std::unique_ptr<APNetworkClient> network_client_;
     std::unique_ptr<APStateManager> state_manager_;
     std::unique_ptr<APProtocolHandler> protocol_handler_;
+    std::unique_ptr<APDataPackage> data_package_;
     
     // Thread safety
     mutable std::mutex manager_mutex_;
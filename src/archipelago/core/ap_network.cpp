@@ -1,6 +1,10 @@
 #include "ap_network.h"
+#include "ap_datapackage.h"
 #include <chrono>
 #include <tuple>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
 #include "../dependencies/apclient.hpp"
 #include "../dependencies/apuuid.hpp"
 #include "../dependencies/archipelago_fixes.h"
@@ -8,6 +12,11 @@
 
 namespace Archipelago {
 
+// Checks made within this time of each other go out in a single packet.
+static const auto kOutboxWindow = std::chrono::milliseconds(100);
+// Checks the server has not confirmed within this time are sent again.
+static const auto kOutboxRetry = std::chrono::seconds(10);
+
 APNetworkClient::APNetworkClient()
     : connection_status_(ConnectionStatus::Disconnected)
     , should_stop_(false)
@@ -65,6 +74,13 @@ void APNetworkClient::Disconnect()
     
     ap_client_.reset();
     connection_status_ = ConnectionStatus::Disconnected;
+    
+    // Whatever the server has not confirmed yet has to go out again on the next connection.
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        outbox_in_flight_.clear();
+    }
+    WriteOutbox();
 }
 
 bool APNetworkClient::Authenticate(const std::string& slot_name, const std::string& password)
@@ -86,18 +102,207 @@ bool APNetworkClient::Authenticate(const std::string& slot_name, const std::stri
     return true;
 }
 
-void APNetworkClient::ProcessNetworkEvents()
+void APNetworkClient::ProcessNetworkEvents(int max_items, int max_messages)
 {
     // This is called from the main thread
-    // Process any callbacks that need to happen on the main thread
+    if (max_items < 1) max_items = 1;
+    if (max_messages < 1) max_messages = 1;
+    item_batch_.clear();
+    
+    while (NetworkEvent* event = event_ring_.Front())
+    {
+        if (event->type == NetworkEvent::ItemReceived)
+        {
+            if ((int)item_batch_.size() >= max_items)
+                break;
+            item_batch_.push_back(std::move(event->item));
+            event_ring_.Pop();
+            continue;
+        }
+        
+        // Deliver collected items first so that the callbacks see everything in order.
+        if (!item_batch_.empty())
+        {
+            if (on_items_received)
+                on_items_received(item_batch_);
+            item_batch_.clear();
+        }
+        
+        if (event->type == NetworkEvent::StatusChanged)
+        {
+            if (on_connection_status_changed)
+                on_connection_status_changed(event->status);
+        }
+        else if (event->type == NetworkEvent::LocationsChecked)
+        {
+            if (on_locations_checked)
+                on_locations_checked(event->locations);
+            event->locations.clear();
+        }
+        else if (event->type == NetworkEvent::PrintJson)
+        {
+            if (max_messages <= 0)
+                break;
+            max_messages--;
+            if (on_print_json)
+                on_print_json(event->data);
+            event->data = nullptr;
+        }
+        event_ring_.Pop();
+    }
+    
+    if (!item_batch_.empty() && on_items_received)
+        on_items_received(item_batch_);
+}
+
+void APNetworkClient::PostEvent(NetworkEvent&& event)
+{
+    while (!event_ring_.Push(std::move(event)))
+    {
+        // A full resync can outrun the game thread's per tic budget.
+        if (should_stop_)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 }
 
 void APNetworkClient::SendLocationChecks(const std::vector<int64_t>& locations)
 {
-    NetworkCommand cmd;
-    cmd.type = NetworkCommand::CheckLocations;
-    cmd.data["locations"] = locations;
-    EnqueueCommand(cmd);
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    for (int64_t location : locations)
+    {
+        if (!outbox_set_.insert(location).second)
+            continue;
+        
+        // The coalescing window starts with the first check that is not on its way yet.
+        if (outbox_.size() == outbox_in_flight_.size())
+            outbox_first_unsent_ = std::chrono::steady_clock::now();
+        outbox_.push_back(location);
+        outbox_dirty_ = true;
+    }
+}
+
+void APNetworkClient::SetOutbox(const std::string& filename, const std::string& server, const std::string& slot)
+{
+    // The previous room's checks go to its own file before they are dropped from memory.
+    WriteOutbox();
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    
+    // Checks belong to one slot on one server and must never leak into another room.
+    if (server != outbox_server_ || slot != outbox_slot_)
+    {
+        outbox_.clear();
+        outbox_set_.clear();
+        outbox_in_flight_.clear();
+    }
+    outbox_file_ = filename;
+    outbox_server_ = server;
+    outbox_slot_ = slot;
+    
+    try
+    {
+        std::ifstream file(filename);
+        if (!file.is_open())
+            return;
+        
+        nlohmann::json j;
+        file >> j;
+        if (j.value("server", "") != server || j.value("slot", "") != slot)
+            return;
+        
+        for (const auto& loc : j["locations"])
+        {
+            int64_t location = loc.get<int64_t>();
+            if (outbox_set_.insert(location).second)
+                outbox_.push_back(location);
+        }
+        outbox_first_unsent_ = std::chrono::steady_clock::now();
+    }
+    catch (const std::exception&)
+    {
+        // A damaged outbox only means the checks get sent again when they are made again.
+    }
+}
+
+// Called from the network thread.
+void APNetworkClient::FlushOutbox()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::vector<int64_t> send;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        if (!ap_client_ || connection_status_ != ConnectionStatus::Authenticated)
+            return;
+        
+        if (!outbox_in_flight_.empty() && now - outbox_last_send_ >= kOutboxRetry)
+            outbox_in_flight_.clear();
+        
+        if (outbox_in_flight_.size() < outbox_.size() && now - outbox_first_unsent_ >= kOutboxWindow)
+        {
+            for (int64_t location : outbox_)
+            {
+                if (outbox_in_flight_.insert(location).second)
+                    send.push_back(location);
+            }
+            outbox_last_send_ = now;
+        }
+    }
+    
+    if (!send.empty())
+    {
+        ap_client_->LocationChecks(send);
+    }
+}
+
+// Called from the network thread with the server's list of checked
+// locations. This covers both the confirmation of new checks and the full
+// list the server sends on connect, which reconciles the persisted outbox.
+void APNetworkClient::AcknowledgeChecks(const std::vector<int64_t>& locations)
+{
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    bool removed = false;
+    for (int64_t location : locations)
+    {
+        if (outbox_set_.erase(location))
+        {
+            outbox_in_flight_.erase(location);
+            removed = true;
+        }
+    }
+    if (removed)
+    {
+        outbox_.erase(std::remove_if(outbox_.begin(), outbox_.end(),
+            [this](int64_t location) { return outbox_set_.count(location) == 0; }), outbox_.end());
+        outbox_dirty_ = true;
+    }
+}
+
+void APNetworkClient::WriteOutbox()
+{
+    nlohmann::json j;
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        if (!outbox_dirty_ || outbox_file_.empty())
+            return;
+        outbox_dirty_ = false;
+        filename = outbox_file_;
+        j["server"] = outbox_server_;
+        j["slot"] = outbox_slot_;
+        j["locations"] = outbox_;
+    }
+    
+    std::string tempname = filename + ".tmp";
+    {
+        std::ofstream file(tempname, std::ios::trunc);
+        if (!file.is_open())
+            return;
+        file << j.dump();
+        if (!file.good())
+            return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempname, filename, ec);
 }
 
 void APNetworkClient::SendChat(const std::string& message)
@@ -110,6 +315,12 @@ void APNetworkClient::SendChat(const std::string& message)
 
 void APNetworkClient::NetworkThreadMain()
 {
+    // Only games whose checksum is not in the cache get requested from the server.
+    if (ap_client_ && data_package_)
+    {
+        ap_client_->set_data_package(data_package_->LoadCache());
+    }
+    
     while (!should_stop_)
     {
         // Process commands
@@ -121,6 +332,10 @@ void APNetworkClient::NetworkThreadMain()
             ap_client_->poll();
         }
         
+        // Send and persist pending location checks
+        FlushOutbox();
+        WriteOutbox();
+        
         // Small sleep to prevent busy waiting
         std::unique_lock<std::mutex> lock(network_mutex_);
         network_cv_.wait_for(lock, std::chrono::milliseconds(10),
@@ -155,13 +370,6 @@ void APNetworkClient::ProcessCommands()
             }
             break;
             
-        case NetworkCommand::CheckLocations:
-            if (ap_client_ && connection_status_ == ConnectionStatus::Authenticated)
-            {
-                ap_client_->LocationChecks(cmd.data["locations"].get<std::vector<int64_t>>());
-            }
-            break;
-            
         case NetworkCommand::SendChat:
             if (ap_client_ && connection_status_ == ConnectionStatus::Authenticated)
             {
@@ -191,55 +399,162 @@ void APNetworkClient::SetupCallbacks()
     // Socket connected
     ap_client_->set_socket_connected_handler([this]() {
         connection_status_ = ConnectionStatus::Connected;
-        if (on_connection_status_changed)
-            on_connection_status_changed(ConnectionStatus::Connected);
+        NetworkEvent event{};
+        event.type = NetworkEvent::StatusChanged;
+        event.status = ConnectionStatus::Connected;
+        PostEvent(std::move(event));
     });
     
     // Socket disconnected
     ap_client_->set_socket_disconnected_handler([this]() {
         connection_status_ = ConnectionStatus::Disconnected;
-        if (on_connection_status_changed)
-            on_connection_status_changed(ConnectionStatus::Disconnected);
+        {
+            std::lock_guard<std::mutex> lock(outbox_mutex_);
+            outbox_in_flight_.clear();
+        }
+        NetworkEvent event{};
+        event.type = NetworkEvent::StatusChanged;
+        event.status = ConnectionStatus::Disconnected;
+        PostEvent(std::move(event));
     });
     
     // Slot connected (authenticated)
     ap_client_->set_slot_connected_handler([this](const nlohmann::json& slot_data) {
         connection_status_ = ConnectionStatus::Authenticated;
-        if (on_connection_status_changed)
-            on_connection_status_changed(ConnectionStatus::Authenticated);
+        NetworkEvent event{};
+        event.type = NetworkEvent::StatusChanged;
+        event.status = ConnectionStatus::Authenticated;
+        PostEvent(std::move(event));
     });
     
     // Slot refused
     ap_client_->set_slot_refused_handler([this](const std::vector<std::string>& errors) {
         connection_status_ = ConnectionStatus::ConnectionRefused;
-        if (on_connection_status_changed)
-            on_connection_status_changed(ConnectionStatus::ConnectionRefused);
+        NetworkEvent event{};
+        event.type = NetworkEvent::StatusChanged;
+        event.status = ConnectionStatus::ConnectionRefused;
+        PostEvent(std::move(event));
     });
     
-    // Items received
+    // Items received, one event per item so that the game thread can spread a resync over several tics
     ap_client_->set_items_received_handler([this](const std::vector<APClient::NetworkItem>& items) {
-        std::vector<NetworkItem> converted_items;
         for (const auto& ap_item : items)
         {
-            NetworkItem item;
-            item.item_id = ap_item.item;
-            item.location_id = ap_item.location;
-            item.player_id = ap_item.player;
-            item.flags = ap_item.flags;
-            converted_items.push_back(item);
+            NetworkEvent event{};
+            event.type = NetworkEvent::ItemReceived;
+            event.item.item_id = ap_item.item;
+            event.item.location_id = ap_item.location;
+            event.item.player_id = ap_item.player;
+            event.item.flags = ap_item.flags;
+            PostEvent(std::move(event));
         }
-        
-        if (on_items_received)
-            on_items_received(converted_items);
+    });
+    
+    // Checked locations, sent on connect and whenever new checks were accepted
+    ap_client_->set_location_checked_handler([this](const std::vector<int64_t>& locations) {
+        AcknowledgeChecks(locations);
+        NetworkEvent event{};
+        event.type = NetworkEvent::LocationsChecked;
+        event.locations = locations;
+        PostEvent(std::move(event));
+    });
+    
+    // DataPackage, built into lookup tables and cached right here so that the game thread never waits for it
+    ap_client_->set_data_package_changed_handler([this](const nlohmann::json& data) {
+        if (data_package_ && data.contains("games"))
+            data_package_->AddGames(data["games"]);
     });
     
     // Print/chat messages
     ap_client_->set_print_json_handler([this](const nlohmann::json& data) {
-        if (on_print_json)
-            on_print_json(data);
+        NetworkEvent event{};
+        event.type = NetworkEvent::PrintJson;
+        event.data = data;
+        PostEvent(std::move(event));
     });
 }
 
+bool APNetworkClient::SelfCheck(const std::string& outbox_file, std::string& report)
+{
+    bool ok = true;
+    auto check = [&](bool cond, const char* what) {
+        if (!cond) {
+            report += what;
+            report += "\n";
+            ok = false;
+        }
+    };
+    
+    // A reconnect resync: the items have to arrive in order, within the
+    // budget, and the status change after them must not overtake them.
+    {
+        APNetworkClient client;
+        std::vector<int64_t> received;
+        size_t largest_batch = 0;
+        bool status_early = false;
+        client.on_items_received = [&](const std::vector<NetworkItem>& items) {
+            largest_batch = std::max(largest_batch, items.size());
+            for (const auto& item : items) received.push_back(item.item_id);
+        };
+        client.on_connection_status_changed = [&](ConnectionStatus status) {
+            if (status == ConnectionStatus::Disconnected && received.size() != 1000) status_early = true;
+        };
+        
+        for (int i = 0; i < 1000; i++) {
+            NetworkEvent event{};
+            event.type = NetworkEvent::ItemReceived;
+            event.item.item_id = i;
+            client.PostEvent(std::move(event));
+        }
+        NetworkEvent event{};
+        event.type = NetworkEvent::StatusChanged;
+        event.status = ConnectionStatus::Disconnected;
+        client.PostEvent(std::move(event));
+        
+        int calls = 0;
+        while (!client.event_ring_.Empty() && calls < 100) {
+            client.ProcessNetworkEvents(64, 8);
+            calls++;
+        }
+        check(client.event_ring_.Empty(), "resync: events left in the ring");
+        check(received.size() == 1000, "resync: items lost");
+        check(largest_batch <= 64, "resync: item budget exceeded");
+        check(calls == 16, "resync: not spread over the expected number of tics");
+        check(!status_early, "resync: status change delivered before the items");
+        bool ordered = true;
+        for (size_t i = 0; i < received.size(); i++) ordered &= received[i] == int64_t(i);
+        check(ordered, "resync: items out of order");
+    }
+    
+    // Checks that were in flight when the connection dropped have to survive
+    // in the outbox file and be sent again after resuming, minus those the
+    // server confirmed. Another slot must not pick them up.
+    std::error_code ec;
+    std::filesystem::remove(outbox_file, ec);
+    {
+        APNetworkClient client;
+        client.SetOutbox(outbox_file, "selfcheck", "slot");
+        client.SendLocationChecks({ 1, 2, 3 });
+        {
+            std::lock_guard<std::mutex> lock(client.outbox_mutex_);
+            client.outbox_in_flight_ = { 1, 2, 3 };
+        }
+        client.AcknowledgeChecks({ 2 });
+        client.Disconnect();
+        check(client.outbox_in_flight_.empty(), "disconnect: checks still marked as in flight");
+    }
+    {
+        APNetworkClient client;
+        client.SetOutbox(outbox_file, "selfcheck", "slot");
+        check(client.outbox_ == std::vector<int64_t>({ 1, 3 }), "resume: outbox not restored");
+        check(client.outbox_in_flight_.empty(), "resume: restored checks not queued for sending");
+        client.SetOutbox(outbox_file, "selfcheck", "other");
+        check(client.outbox_.empty(), "resume: checks leaked into another slot");
+    }
+    std::filesystem::remove(outbox_file, ec);
+    return ok;
+}
+
 bool APNetworkClient::IsConnected() const
 {
     return connection_status_ == ConnectionStatus::Authenticated;
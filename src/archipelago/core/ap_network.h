@@ -1,11 +1,13 @@
 #pragma once
 
 #include "ap_types.h"
+#include "ap_event_ring.h"
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <queue>
 #include <mutex>
+#include <unordered_set>
 #include <condition_variable>
 
 #include "../dependencies/archipelago_fixes.h"`n`n`#include "../dependencies/archipelago_fixes.h"
@@ -18,6 +20,8 @@ namespace nlohmann { class json; }
 
 namespace Archipelago {
 
+class APDataPackage;
+
 class APNetworkClient {
 public:
     APNetworkClient();
@@ -33,7 +37,11 @@ public:
     bool IsConnected() const;
     
     // Send operations (thread-safe)
+    // Location checks go through an outbox: they are collected for a short
+    // time and sent as one packet, and stay queued (and persisted in the
+    // outbox file) until the server confirms them, even across disconnects.
     void SendLocationChecks(const std::vector<int64_t>& locations);
+    void SetOutbox(const std::string& filename, const std::string& server, const std::string& slot);
     void SendLocationScouts(const std::vector<int64_t>& locations);
     void SendChat(const std::string& message);
     void SendBounce(const nlohmann::json& data);
@@ -43,10 +51,17 @@ public:
     void GetData(const std::vector<std::string>& keys);
     void SetData(const std::string& key, const nlohmann::json& value);
     
+    // Received DataPackages go here, and cached ones are offered to the server connection.
+    void SetDataPackage(APDataPackage* data_package) { data_package_ = data_package; }
+    
     // Network processing
-    void ProcessNetworkEvents();
+    // Dispatches queued network events on the calling (game) thread. At most
+    // max_items received items and max_messages printed messages are handled
+    // per call, the rest stays queued for the next one. Status changes are
+    // never held back.
+    void ProcessNetworkEvents(int max_items, int max_messages);
     
-    // Callbacks (called from network thread)
+    // Callbacks (called from ProcessNetworkEvents)
     std::function<void(ConnectionStatus)> on_connection_status_changed;
     std::function<void(const std::vector<NetworkItem>&)> on_items_received;
     std::function<void(const std::vector<int64_t>&)> on_locations_checked;
@@ -55,7 +70,34 @@ public:
     std::function<void(const std::vector<NetworkPlayer>&)> on_players_updated;
     std::function<void(const nlohmann::json&)> on_data_received;
     
+    // Runs the game thread side and the outbox through a disconnect and a
+    // resume without a server, feeding the events the network thread would
+    // post. Failures are appended to report, one per line.
+    static bool SelfCheck(const std::string& outbox_file, std::string& report);
+    
 private:
+    // Events from the network thread to the game thread
+    struct NetworkEvent {
+        enum Type {
+            StatusChanged,
+            ItemReceived,
+            LocationsChecked,
+            PrintJson,
+        };
+        
+        Type type;
+        ConnectionStatus status;
+        NetworkItem item;
+        std::vector<int64_t> locations;
+        nlohmann::json data;
+    };
+    
+    // Only called from the network thread. Waits while the game thread catches up if the ring is full.
+    void PostEvent(NetworkEvent&& event);
+    
+    APEventRing<NetworkEvent> event_ring_{4096};
+    std::vector<NetworkItem> item_batch_;
+    
     // Network thread management
     void NetworkThreadMain();
     void StopNetworkThread();
@@ -78,7 +120,6 @@ private:
             Connect,
             Authenticate,
             Disconnect,
-            CheckLocations,
             ScoutLocations,
             SendChat,
             SendBounce,
@@ -103,6 +144,24 @@ private:
     // Setup APClient callbacks
     void SetupCallbacks();
     
+    // Location check outbox, guarded by outbox_mutex_
+    void FlushOutbox();
+    void AcknowledgeChecks(const std::vector<int64_t>& locations);
+    void WriteOutbox();
+    
+    std::mutex outbox_mutex_;
+    std::vector<int64_t> outbox_;                       // unacknowledged checks, in the order they were made
+    std::unordered_set<int64_t> outbox_set_;
+    std::unordered_set<int64_t> outbox_in_flight_;      // sent, but not confirmed yet
+    std::chrono::steady_clock::time_point outbox_first_unsent_;
+    std::chrono::steady_clock::time_point outbox_last_send_;
+    bool outbox_dirty_ = false;
+    std::string outbox_file_;
+    std::string outbox_server_;
+    std::string outbox_slot_;
+    
+    APDataPackage* data_package_ = nullptr;
+    
     // Connection details
     std::string server_uri_;
     std::string game_name_;
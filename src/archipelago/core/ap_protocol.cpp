@@ -4,6 +4,189 @@
 
 namespace Archipelago {
 
+namespace {
+
+// SAX handler for DecodeFrame. It only tracks the fields of ReceivedItems
+// and PrintJSON packets and remembers which packets were something else,
+// so that those can be handed to the DOM parser afterwards.
+//
+// Since the order of keys in a packet is not fixed, fields are collected
+// before the packet's "cmd" is known and the result is discarded again at
+// the end of the packet if it turns out to be a different command.
+class FrameSaxHandler : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+    FrameSaxHandler(std::vector<NetworkItem>& items, std::string& text)
+        : items_(items), text_(text)
+    {
+    }
+    
+    std::vector<NetworkItem>& items_;
+    std::string& text_;
+    std::function<void(int, const std::vector<NetworkItem>&)> on_items;
+    std::function<void(const std::string& type, bool has_data)> on_print;
+    std::vector<int> unhandled;         // indices of the packets that need the DOM
+    
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t val) override { return Integer(int64_t(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return Integer(int64_t(val)); }
+    bool number_float(number_float_t val, const string_t&) override { return Integer(int64_t(val)); }
+    bool binary(binary_t&) override { return true; }
+    
+    bool string(string_t& val) override
+    {
+        if (depth_ == packet_depth_)
+        {
+            if (key_ == "cmd") cmd_ = val;
+            else if (key_ == "type") type_ = val;
+        }
+        else if (in_segments_ && depth_ == packet_depth_ + 1)
+        {
+            text_ += val;
+        }
+        else if (in_segments_ && depth_ == packet_depth_ + 2)
+        {
+            if (key_ == "text") { segment_text_ = val; segment_rank_ = 0; }
+            else if (key_ == "player_name" && segment_rank_ > 1) { segment_text_ = val; segment_rank_ = 1; }
+            else if (key_ == "item_name" && segment_rank_ > 2) { segment_text_ = val; segment_rank_ = 2; }
+            else if (key_ == "location_name" && segment_rank_ > 3) { segment_text_ = val; segment_rank_ = 3; }
+        }
+        return true;
+    }
+    
+    bool start_object(std::size_t) override
+    {
+        depth_++;
+        if (packet_depth_ < 0 && depth_ <= 2)
+        {
+            // Top level packet, either on its own or as an element of the frame array.
+            packet_depth_ = depth_;
+            cmd_.clear();
+            type_.clear();
+            text_.clear();
+            has_data_ = false;
+            items_start_ = items_.size();
+        }
+        else if (in_items_ && depth_ == packet_depth_ + 2)
+        {
+            items_.push_back(NetworkItem{ 0, 0, 0, std::string(), 0 });
+        }
+        else if (in_segments_ && depth_ == packet_depth_ + 2)
+        {
+            segment_text_.clear();
+            segment_rank_ = 4;
+        }
+        return true;
+    }
+    
+    bool key(string_t& val) override
+    {
+        if (depth_ == packet_depth_ || depth_ == packet_depth_ + 2)
+            key_ = val;
+        // Like HandlePrintJson, any "data" makes a message, only an array has text in it.
+        if (depth_ == packet_depth_ && val == "data")
+            has_data_ = true;
+        return true;
+    }
+    
+    bool end_object() override
+    {
+        if (depth_ == packet_depth_)
+        {
+            EndPacket();
+            packet_depth_ = -1;
+        }
+        else if (in_segments_ && depth_ == packet_depth_ + 2 && segment_rank_ < 4)
+        {
+            text_ += segment_text_;
+        }
+        depth_--;
+        key_.clear();
+        return true;
+    }
+    
+    bool start_array(std::size_t) override
+    {
+        depth_++;
+        if (depth_ == packet_depth_ + 1)
+        {
+            if (key_ == "items") in_items_ = true;
+            else if (key_ == "data") in_segments_ = true;
+        }
+        return true;
+    }
+    
+    bool end_array() override
+    {
+        if (depth_ == packet_depth_ + 1)
+        {
+            in_items_ = false;
+            in_segments_ = false;
+        }
+        depth_--;
+        return true;
+    }
+    
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+    {
+        return false;
+    }
+    
+private:
+    bool Integer(int64_t val)
+    {
+        if (depth_ == packet_depth_)
+        {
+            if (key_ == "index") index_ = int(val);
+        }
+        else if (in_items_ && depth_ == packet_depth_ + 2)
+        {
+            NetworkItem& item = items_.back();
+            if (key_ == "item") item.item_id = val;
+            else if (key_ == "location") item.location_id = val;
+            else if (key_ == "player") item.player_id = int(val);
+            else if (key_ == "flags") item.flags = int(val);
+        }
+        return true;
+    }
+    
+    void EndPacket()
+    {
+        if (cmd_ == "ReceivedItems")
+        {
+            if (on_items) on_items(index_, items_);
+        }
+        else if (cmd_ == "PrintJSON")
+        {
+            if (on_print) on_print(type_, has_data_);
+        }
+        else
+        {
+            unhandled.push_back(packet_count_);
+        }
+        items_.resize(items_start_);
+        index_ = 0;
+        packet_count_++;
+    }
+    
+    int depth_ = 0;
+    int packet_depth_ = -1;
+    int packet_count_ = 0;
+    std::string key_;
+    std::string cmd_;
+    std::string type_;
+    int index_ = 0;
+    size_t items_start_ = 0;
+    bool in_items_ = false;
+    bool in_segments_ = false;
+    bool has_data_ = false;
+    std::string segment_text_;
+    int segment_rank_ = 4;
+};
+
+} // namespace
+
 APProtocolHandler::APProtocolHandler()
 {
 }
@@ -71,8 +254,11 @@ MessageType APProtocolHandler::DetectMessageType(const nlohmann::json& data)
     if (!data.contains("type"))
         return MessageType::Chat;
         
-    std::string type = data["type"].get<std::string>();
-    
+    return MessageTypeFromName(data["type"].get<std::string>());
+}
+
+MessageType APProtocolHandler::MessageTypeFromName(const std::string& type)
+{
     if (type == "ItemSend")
         return MessageType::ItemSend;
     else if (type == "ItemCheat")
@@ -156,6 +342,52 @@ nlohmann::json APProtocolHandler::BuildBouncePacket(const nlohmann::json& data)
     return packet;
 }
 
+bool APProtocolHandler::DecodeFrame(const std::string& frame, const FrameSink& sink)
+{
+    frame_items_.clear();
+    frame_text_.clear();
+    frame_text_.reserve(256);
+    
+    FrameSaxHandler handler(frame_items_, frame_text_);
+    handler.on_items = [&sink](int index, const std::vector<NetworkItem>& items) {
+        if (sink.received_items)
+            sink.received_items(index, items);
+    };
+    handler.on_print = [this, &sink](const std::string& type, bool has_data) {
+        // Same rules as HandlePrintJson.
+        if (!has_data || !sink.print_json)
+            return;
+        Message msg;
+        msg.timestamp = std::chrono::system_clock::now();
+        msg.type = type.empty() ? MessageType::Chat : MessageTypeFromName(type);
+        msg.priority = 0;
+        msg.text = frame_text_;
+        sink.print_json(msg);
+    };
+    
+    if (!nlohmann::json::sax_parse(frame, &handler))
+        return false;
+    
+    // Anything else is rare enough that the DOM is fine.
+    if (!handler.unhandled.empty() && sink.other)
+    {
+        nlohmann::json packets = nlohmann::json::parse(frame, nullptr, false);
+        if (packets.is_object())
+        {
+            sink.other(packets);
+        }
+        else if (packets.is_array())
+        {
+            for (int index : handler.unhandled)
+            {
+                if (index < (int)packets.size())
+                    sink.other(packets[index]);
+            }
+        }
+    }
+    return true;
+}
+
 bool APProtocolHandler::ParseRoomInfoPacket(const nlohmann::json& data)
 {
     // Validate required fields
@@ -179,6 +411,7 @@ bool APProtocolHandler::ParseReceivedItemsPacket(const nlohmann::json& data,
         return false;
         
     items.clear();
+    items.reserve(data["items"].size());
     
     for (const auto& item_data : data["items"])
     {
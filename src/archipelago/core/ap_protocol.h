@@ -28,6 +28,19 @@ public:
     nlohmann::json BuildSayPacket(const std::string& message);
     nlohmann::json BuildBouncePacket(const nlohmann::json& data);
     
+    // Streaming decode of a raw server frame (a JSON array of packets).
+    // ReceivedItems and PrintJSON make up nearly all of the traffic on
+    // connect, so they are decoded straight from the text without building
+    // a DOM. Every other packet is parsed the regular way and handed to
+    // 'other'. The item array passed to 'received_items' is reused between
+    // packets and frames.
+    struct FrameSink {
+        std::function<void(int index, const std::vector<NetworkItem>& items)> received_items;
+        std::function<void(const Message&)> print_json;
+        std::function<void(const nlohmann::json&)> other;
+    };
+    bool DecodeFrame(const std::string& frame, const FrameSink& sink);
+    
     // Parse received packets
     bool ParseRoomInfoPacket(const nlohmann::json& data);
     bool ParseConnectedPacket(const nlohmann::json& data);
@@ -50,6 +63,11 @@ private:
     
     // Message type detection
     MessageType DetectMessageType(const nlohmann::json& data);
+    static MessageType MessageTypeFromName(const std::string& type);
+    
+    // Scratch buffers for DecodeFrame
+    std::vector<NetworkItem> frame_items_;
+    std::string frame_text_;
 };
 
 } // namespace Archipelago
\ No newline at end of file
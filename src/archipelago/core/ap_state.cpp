@@ -1,9 +1,250 @@
 #include "ap_state.h"
 #include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
 #include "../dependencies/archipelago_fixes.h"
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace Archipelago {
 
+namespace {
+
+// Journal file layout: "APJ1", a 64 bit generation that has to match the
+// snapshot's, then records of [type:u8][size:u32][payload][checksum:u32].
+// A torn or corrupt record ends the replay, everything before it is kept.
+const char kJournalMagic[4] = { 'A', 'P', 'J', '1' };
+const size_t kJournalHeaderSize = 12;
+const size_t kFlushBytes = 4096;
+const auto kFlushInterval = std::chrono::milliseconds(250);
+const size_t kMinCompactRecords = 1024;
+
+void PutU32(std::vector<uint8_t>& buf, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) buf.push_back(uint8_t(v >> (i * 8)));
+}
+
+void PutU64(std::vector<uint8_t>& buf, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) buf.push_back(uint8_t(v >> (i * 8)));
+}
+
+uint32_t GetU32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint64_t GetU64(const uint8_t* p)
+{
+    return uint64_t(GetU32(p)) | (uint64_t(GetU32(p + 4)) << 32);
+}
+
+uint32_t RecordChecksum(uint8_t type, const uint8_t* data, size_t len)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    h = (h ^ type) * 16777619u;
+    for (size_t i = 0; i < len; i++) h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+bool SyncFile(FILE* f)
+{
+    if (fflush(f) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Appends and syncs, or leaves the file as it was, so that a failed write
+// never leaves a torn record in front of the ones written after it.
+bool AppendFile(FILE* f, const std::vector<uint8_t>& data)
+{
+    long pos = ftell(f);
+    if (pos >= 0 && fwrite(data.data(), 1, data.size(), f) == data.size() && SyncFile(f))
+        return true;
+    
+    clearerr(f);
+    if (pos >= 0)
+    {
+        fflush(f);
+#ifdef _WIN32
+        _chsize(_fileno(f), pos);
+#else
+        if (ftruncate(fileno(f), pos) != 0) {}
+#endif
+        fseek(f, pos, SEEK_SET);
+    }
+    return false;
+}
+
+std::string JournalPath(const std::string& filename)
+{
+    return filename + ".journal";
+}
+
+// SAX handler for LoadState, writes the snapshot straight into the state
+// manager's containers instead of going through a DOM.
+class SnapshotSaxHandler : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+    SnapshotSaxHandler(std::unordered_set<int64_t>& locations, std::vector<NetworkItem>& items)
+        : locations_(locations), items_(items)
+    {
+    }
+    
+    int total_locations_checked = 0;
+    int total_items_received = 0;
+    uint64_t generation = 0;
+    
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t val) override { return Integer(int64_t(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return Integer(int64_t(val)); }
+    bool number_float(number_float_t val, const string_t&) override { return Integer(int64_t(val)); }
+    bool binary(binary_t&) override { return true; }
+    
+    bool string(string_t& val) override
+    {
+        if (in_items_ && depth_ == 3 && key_ == "player_name")
+            items_.back().player_name = std::move(val);
+        return true;
+    }
+    
+    bool start_object(std::size_t) override
+    {
+        depth_++;
+        if (in_items_ && depth_ == 3)
+            items_.push_back(NetworkItem{ 0, 0, 0, std::string(), 0 });
+        return true;
+    }
+    
+    bool key(string_t& val) override
+    {
+        key_ = val;
+        return true;
+    }
+    
+    bool end_object() override
+    {
+        depth_--;
+        return true;
+    }
+    
+    bool start_array(std::size_t) override
+    {
+        depth_++;
+        if (depth_ == 2)
+        {
+            in_locations_ = key_ == "checked_locations";
+            in_items_ = key_ == "received_items";
+        }
+        return true;
+    }
+    
+    bool end_array() override
+    {
+        if (depth_ == 2)
+            in_locations_ = in_items_ = false;
+        depth_--;
+        return true;
+    }
+    
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+    {
+        return false;
+    }
+    
+private:
+    bool Integer(int64_t val)
+    {
+        if (depth_ == 1)
+        {
+            if (key_ == "total_locations_checked") total_locations_checked = int(val);
+            else if (key_ == "total_items_received") total_items_received = int(val);
+            else if (key_ == "journal_generation") generation = uint64_t(val);
+        }
+        else if (in_locations_ && depth_ == 2)
+        {
+            locations_.insert(val);
+        }
+        else if (in_items_ && depth_ == 3)
+        {
+            NetworkItem& item = items_.back();
+            if (key_ == "item_id") item.item_id = val;
+            else if (key_ == "location_id") item.location_id = val;
+            else if (key_ == "player_id") item.player_id = int(val);
+            else if (key_ == "flags") item.flags = int(val);
+        }
+        return true;
+    }
+    
+    std::unordered_set<int64_t>& locations_;
+    std::vector<NetworkItem>& items_;
+    int depth_ = 0;
+    std::string key_;
+    bool in_locations_ = false;
+    bool in_items_ = false;
+};
+
+// Writes to a temporary file first so that a crash never leaves a half written snapshot behind.
+bool WriteSnapshot(const std::string& filename, const std::vector<int64_t>& locations, const std::vector<NetworkItem>& items,
+    int total_locations_checked, int total_items_received, uint64_t generation)
+{
+    try
+    {
+        nlohmann::json j;
+        j["checked_locations"] = locations;
+        j["total_locations_checked"] = total_locations_checked;
+        j["total_items_received"] = total_items_received;
+        j["journal_generation"] = generation;
+        
+        // Save received items
+        nlohmann::json items_array = nlohmann::json::array();
+        for (const auto& item : items)
+        {
+            nlohmann::json item_obj;
+            item_obj["item_id"] = item.item_id;
+            item_obj["location_id"] = item.location_id;
+            item_obj["player_id"] = item.player_id;
+            item_obj["player_name"] = item.player_name;
+            item_obj["flags"] = item.flags;
+            items_array.push_back(item_obj);
+        }
+        j["received_items"] = items_array;
+        
+        std::string text = j.dump();
+        std::string tempname = filename + ".tmp";
+        FILE* f = fopen(tempname.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = fwrite(text.data(), 1, text.size(), f) == text.size() && SyncFile(f);
+        fclose(f);
+        
+        std::error_code ec;
+        if (ok) std::filesystem::rename(tempname, filename, ec);
+        if (!ok || ec)
+        {
+            std::filesystem::remove(tempname, ec);
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+} // namespace
+
 APStateManager::APStateManager()
     : total_locations_checked_(0)
     , total_items_received_(0)
@@ -12,6 +253,7 @@ APStateManager::APStateManager()
 
 APStateManager::~APStateManager()
 {
+    CloseJournal();
 }
 
 void APStateManager::MarkLocationChecked(int64_t location_id)
@@ -20,6 +262,13 @@ void APStateManager::MarkLocationChecked(int64_t location_id)
     if (checked_locations_.insert(location_id).second)
     {
         total_locations_checked_++;
+        
+        if (journaling_)
+        {
+            std::vector<uint8_t> payload;
+            PutU64(payload, uint64_t(location_id));
+            AppendRecord(JR_LocationChecked, payload);
+        }
     }
 }
 
@@ -40,6 +289,7 @@ void APStateManager::ClearCheckedLocations()
     std::lock_guard<std::mutex> lock(state_mutex_);
     checked_locations_.clear();
     total_locations_checked_ = 0;
+    if (journaling_) AppendRecord(JR_ClearLocations, {});
 }
 
 void APStateManager::AddReceivedItem(const NetworkItem& item)
@@ -47,6 +297,18 @@ void APStateManager::AddReceivedItem(const NetworkItem& item)
     std::lock_guard<std::mutex> lock(state_mutex_);
     received_items_.push_back(item);
     total_items_received_++;
+    
+    if (journaling_)
+    {
+        std::vector<uint8_t> payload;
+        PutU64(payload, uint64_t(item.item_id));
+        PutU64(payload, uint64_t(item.location_id));
+        PutU32(payload, uint32_t(item.player_id));
+        PutU32(payload, uint32_t(item.flags));
+        PutU32(payload, uint32_t(item.player_name.size()));
+        payload.insert(payload.end(), item.player_name.begin(), item.player_name.end());
+        AppendRecord(JR_ItemReceived, payload);
+    }
 }
 
 std::vector<NetworkItem> APStateManager::GetReceivedItems() const
@@ -60,6 +322,7 @@ void APStateManager::ClearReceivedItems()
     std::lock_guard<std::mutex> lock(state_mutex_);
     received_items_.clear();
     total_items_received_ = 0;
+    if (journaling_) AppendRecord(JR_ClearItems, {});
 }
 
 void APStateManager::AddMessage(const Message& message)
@@ -100,94 +363,345 @@ void APStateManager::ClearMessages()
     std::swap(message_queue_, empty);
 }
 
-bool APStateManager::SaveState(const std::string& filename) const
+bool APStateManager::SaveState(const std::string& filename)
 {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    
-    try
+    // Saving over the journal's own snapshot has to start a new journal generation.
     {
-        nlohmann::json j;
-        j["checked_locations"] = std::vector<int64_t>(checked_locations_.begin(), checked_locations_.end());
-        j["total_locations_checked"] = total_locations_checked_;
-        j["total_items_received"] = total_items_received_;
-        
-        // Save received items
-        nlohmann::json items_array = nlohmann::json::array();
-        for (const auto& item : received_items_)
+        std::lock_guard<std::mutex> jlock(journal_mutex_);
+        if (journal_file_ && filename == snapshot_path_)
         {
-            nlohmann::json item_obj;
-            item_obj["item_id"] = item.item_id;
-            item_obj["location_id"] = item.location_id;
-            item_obj["player_id"] = item.player_id;
-            item_obj["player_name"] = item.player_name;
-            item_obj["flags"] = item.flags;
-            items_array.push_back(item_obj);
+            return Compact();
         }
-        j["received_items"] = items_array;
-        
-        std::ofstream file(filename);
-        file << j.dump(4);
-        return true;
     }
-    catch (const std::exception&)
+    
+    std::vector<int64_t> locations;
+    std::vector<NetworkItem> items;
+    int total_locations_checked, total_items_received;
     {
-        return false;
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        locations.assign(checked_locations_.begin(), checked_locations_.end());
+        items = received_items_;
+        total_locations_checked = total_locations_checked_;
+        total_items_received = total_items_received_;
     }
+    // A standalone snapshot has no journal, so it must not claim any generation.
+    return WriteSnapshot(filename, locations, items, total_locations_checked, total_items_received, 0);
 }
 
 bool APStateManager::LoadState(const std::string& filename)
 {
     std::lock_guard<std::mutex> lock(state_mutex_);
     
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    
+    checked_locations_.clear();
+    received_items_.clear();
+    
+    SnapshotSaxHandler handler(checked_locations_, received_items_);
+    bool ok;
     try
     {
-        std::ifstream file(filename);
-        if (!file.is_open())
-            return false;
-            
-        nlohmann::json j;
-        file >> j;
-        
-        // Load checked locations
+        ok = nlohmann::json::sax_parse(file, &handler);
+    }
+    catch (const std::exception&)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
         checked_locations_.clear();
-        if (j.contains("checked_locations"))
+        received_items_.clear();
+        total_locations_checked_ = 0;
+        total_items_received_ = 0;
+        journal_generation_ = 0;
+        return false;
+    }
+    
+    total_locations_checked_ = handler.total_locations_checked;
+    total_items_received_ = handler.total_items_received;
+    journal_generation_ = handler.generation;
+    
+    if (journal_generation_ != 0)
+    {
+        ReplayJournal(JournalPath(filename));
+    }
+    return true;
+}
+
+//
+// Journal
+//
+
+// Must be called with state_mutex_ held.
+void APStateManager::AppendRecord(JournalRecord type, const std::vector<uint8_t>& payload)
+{
+    journal_pending_.push_back(type);
+    PutU32(journal_pending_, uint32_t(payload.size()));
+    journal_pending_.insert(journal_pending_.end(), payload.begin(), payload.end());
+    PutU32(journal_pending_, RecordChecksum(type, payload.data(), payload.size()));
+    journal_pending_records_++;
+}
+
+// Must be called with state_mutex_ held. Only journals written for the
+// snapshot's generation are applied; an older one was already folded into
+// the snapshot when a compaction got interrupted before truncating it.
+void APStateManager::ReplayJournal(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    
+    if (data.size() < kJournalHeaderSize || memcmp(data.data(), kJournalMagic, 4) != 0)
+        return;
+    if (GetU64(&data[4]) != journal_generation_)
+        return;
+    
+    size_t pos = kJournalHeaderSize;
+    while (data.size() - pos >= 9)
+    {
+        uint8_t type = data[pos];
+        size_t size = GetU32(&data[pos + 1]);
+        if (data.size() - pos - 9 < size)
+            break;
+        const uint8_t* payload = &data[pos + 5];
+        if (GetU32(payload + size) != RecordChecksum(type, payload, size))
+            break;
+        pos += size + 9;
+        
+        switch (type)
         {
-            for (const auto& loc : j["checked_locations"])
+        case JR_LocationChecked:
+            if (size >= 8 && checked_locations_.insert(int64_t(GetU64(payload))).second)
             {
-                checked_locations_.insert(loc.get<int64_t>());
+                total_locations_checked_++;
             }
-        }
-        
-        total_locations_checked_ = j.value("total_locations_checked", 0);
-        total_items_received_ = j.value("total_items_received", 0);
-        
-        // Load received items
-        received_items_.clear();
-        if (j.contains("received_items"))
-        {
-            for (const auto& item_obj : j["received_items"])
+            break;
+            
+        case JR_ItemReceived:
+            if (size >= 28 && size - 28 >= GetU32(payload + 24))
             {
                 NetworkItem item;
-                item.item_id = item_obj["item_id"].get<int64_t>();
-                item.location_id = item_obj["location_id"].get<int64_t>();
-                item.player_id = item_obj["player_id"].get<int>();
-                item.player_name = item_obj.value("player_name", "");
-                item.flags = item_obj.value("flags", 0);
+                item.item_id = int64_t(GetU64(payload));
+                item.location_id = int64_t(GetU64(payload + 8));
+                item.player_id = int(GetU32(payload + 16));
+                item.flags = int(GetU32(payload + 20));
+                item.player_name.assign((const char*)payload + 28, GetU32(payload + 24));
                 received_items_.push_back(item);
+                total_items_received_++;
             }
+            break;
+            
+        case JR_ClearLocations:
+            checked_locations_.clear();
+            total_locations_checked_ = 0;
+            break;
+            
+        case JR_ClearItems:
+            received_items_.clear();
+            total_items_received_ = 0;
+            break;
         }
-        
+    }
+}
+
+bool APStateManager::OpenJournal(const std::string& filename)
+{
+    CloseJournal();
+    
+    // A missing snapshot just means a new game.
+    if (!LoadState(filename))
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        checked_locations_.clear();
+        received_items_.clear();
+        total_locations_checked_ = 0;
+        total_items_received_ = 0;
+        journal_generation_ = 0;
+    }
+    
+    std::lock_guard<std::mutex> jlock(journal_mutex_);
+    snapshot_path_ = filename;
+    
+    // Start from a fresh snapshot, which also drops a torn record at the end of the old journal.
+    if (!Compact())
+    {
+        snapshot_path_.clear();
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    journaling_ = true;
+    return true;
+}
+
+void APStateManager::CloseJournal()
+{
+    JoinCompaction();
+    std::lock_guard<std::mutex> jlock(journal_mutex_);
+    if (!journal_file_)
+        return;
+    
+    // Folding the journal into the snapshot now saves the replay on the next load.
+    if (!Compact() && journal_file_)
+        WritePending();
+    if (journal_file_)
+        fclose(journal_file_);
+    journal_file_ = nullptr;
+    snapshot_path_.clear();
+    
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    journaling_ = false;
+    journal_pending_.clear();
+    journal_pending_records_ = 0;
+}
+
+bool APStateManager::FlushJournal()
+{
+    std::lock_guard<std::mutex> jlock(journal_mutex_);
+    return journal_file_ && WritePending();
+}
+
+bool APStateManager::IsJournalOpen() const
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return journaling_;
+}
+
+// Must be called with journal_mutex_ held. Writes all pending records with a single sync.
+bool APStateManager::WritePending()
+{
+    std::vector<uint8_t> buffer;
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        buffer.swap(journal_pending_);
+        count = journal_pending_records_;
+        journal_pending_records_ = 0;
+    }
+    last_flush_ = std::chrono::steady_clock::now();
+    
+    if (buffer.empty())
         return true;
+    if (!AppendFile(journal_file_, buffer))
+    {
+        RestorePending(buffer, count);
+        return false;
     }
-    catch (const std::exception&)
+    journal_records_ += count;
+    return true;
+}
+
+// Puts records that could not be written back in front of the ones added since, for the next attempt.
+void APStateManager::RestorePending(std::vector<uint8_t>& buffer, size_t count)
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    buffer.insert(buffer.end(), journal_pending_.begin(), journal_pending_.end());
+    journal_pending_.swap(buffer);
+    journal_pending_records_ += count;
+}
+
+// Must be called with journal_mutex_ held. Folds the journal into a new
+// snapshot and starts an empty journal for the next generation.
+bool APStateManager::Compact()
+{
+    std::vector<int64_t> locations;
+    std::vector<NetworkItem> items;
+    std::vector<uint8_t> pending;
+    size_t pending_records;
+    int total_locations_checked, total_items_received;
+    uint64_t generation;
+    {
+        // Everything still pending is contained in the copied state.
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        locations.assign(checked_locations_.begin(), checked_locations_.end());
+        items = received_items_;
+        total_locations_checked = total_locations_checked_;
+        total_items_received = total_items_received_;
+        generation = journal_generation_ + 1;
+        pending.swap(journal_pending_);
+        pending_records = journal_pending_records_;
+        journal_pending_records_ = 0;
+    }
+    
+    if (!WriteSnapshot(snapshot_path_, locations, items, total_locations_checked, total_items_received, generation))
+    {
+        // Keep the old generation going so that nothing gets lost.
+        RestorePending(pending, pending_records);
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        journal_generation_ = generation;
+    }
+    
+    if (journal_file_) fclose(journal_file_);
+    journal_file_ = fopen(JournalPath(snapshot_path_).c_str(), "wb");
+    
+    std::vector<uint8_t> header(kJournalMagic, kJournalMagic + 4);
+    PutU64(header, generation);
+    if (!journal_file_ || fwrite(header.data(), 1, header.size(), journal_file_) != header.size() || !SyncFile(journal_file_))
     {
+        // The snapshot is intact, but there is nowhere left to append to.
+        if (journal_file_) fclose(journal_file_);
+        journal_file_ = nullptr;
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        journaling_ = false;
+        journal_pending_.clear();
+        journal_pending_records_ = 0;
         return false;
     }
+    
+    journal_records_ = 0;
+    snapshot_entries_ = locations.size() + items.size();
+    last_flush_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void APStateManager::JoinCompaction()
+{
+    if (compact_thread_.joinable())
+        compact_thread_.join();
 }
 
 void APStateManager::Update()
 {
-    // Currently no time-based operations needed
+    // A compaction in the background holds the journal lock. New records
+    // keep collecting in journal_pending_ meanwhile and go to the new journal.
+    std::unique_lock<std::mutex> jlock(journal_mutex_, std::try_to_lock);
+    if (!jlock.owns_lock() || !journal_file_)
+        return;
+    
+    bool due;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        due = !journal_pending_.empty() &&
+            (journal_pending_.size() >= kFlushBytes || std::chrono::steady_clock::now() - last_flush_ >= kFlushInterval);
+    }
+    if (due)
+    {
+        WritePending();
+    }
+    
+    // Compacting only once the journal is as large as the snapshot keeps the
+    // amortized cost per record constant, regardless of how long the seed runs.
+    // Writing and syncing the snapshot is far too slow for the game thread.
+    if (journal_records_ >= std::max(kMinCompactRecords, snapshot_entries_) && !compacting_)
+    {
+        JoinCompaction();
+        compacting_ = true;
+        jlock.unlock();
+        compact_thread_ = std::thread([this]()
+        {
+            std::lock_guard<std::mutex> lock(journal_mutex_);
+            if (journal_file_)
+                Compact();
+            compacting_ = false;
+        });
+    }
 }
 
-} // namespace Archipelago
\ No newline at end of file
+} // namespace Archipelago
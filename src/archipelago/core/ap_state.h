@@ -4,6 +4,10 @@
 #include <unordered_set>
 #include <queue>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 
 namespace Archipelago {
 
@@ -30,14 +34,42 @@ public:
     void ClearMessages();
     
     // Save/Load state
-    bool SaveState(const std::string& filename) const;
+    // SaveState writes a complete snapshot. LoadState reads a snapshot and
+    // replays the journal next to it (<filename>.journal), if there is one.
+    bool SaveState(const std::string& filename);
     bool LoadState(const std::string& filename);
     
+    // Journaling
+    // After OpenJournal every check and received item is appended to the
+    // journal instead of rewriting the snapshot. Records are flushed in
+    // batches from Update() and folded into the snapshot on a background
+    // thread once the journal outgrows it.
+    bool OpenJournal(const std::string& filename);
+    void CloseJournal();
+    bool FlushJournal();
+    bool IsJournalOpen() const;
+    
     // Update (for any time-based operations)
     void Update();
     
 private:
+    enum JournalRecord : uint8_t {
+        JR_LocationChecked = 1,
+        JR_ItemReceived = 2,
+        JR_ClearLocations = 3,
+        JR_ClearItems = 4,
+    };
+    
+    void AppendRecord(JournalRecord type, const std::vector<uint8_t>& payload);
+    void ReplayJournal(const std::string& filename);
+    bool WritePending();
+    void RestorePending(std::vector<uint8_t>& buffer, size_t count);
+    bool Compact();
+    void JoinCompaction();
+    
+    // Lock order is journal_mutex_ before state_mutex_.
     mutable std::mutex state_mutex_;
+    std::mutex journal_mutex_;
     
     // Tracked locations
     std::unordered_set<int64_t> checked_locations_;
@@ -51,6 +83,19 @@ private:
     // Stats
     int total_locations_checked_ = 0;
     int total_items_received_ = 0;
+    
+    // Journal
+    std::string snapshot_path_;
+    bool journaling_ = false;                  // guarded by state_mutex_
+    uint64_t journal_generation_ = 0;          // guarded by state_mutex_
+    FILE* journal_file_ = nullptr;
+    std::vector<uint8_t> journal_pending_;     // encoded records not written yet, guarded by state_mutex_
+    size_t journal_pending_records_ = 0;
+    size_t journal_records_ = 0;               // records in the file since the last compaction
+    size_t snapshot_entries_ = 0;              // entries in the snapshot at the last compaction
+    std::chrono::steady_clock::time_point last_flush_;
+    std::thread compact_thread_;               // only started and joined by the thread calling Update()
+    std::atomic<bool> compacting_{false};
 };
 
 } // namespace Archipelago
\ No newline at end of file
@@ -74,6 +74,11 @@ struct Config {
     bool enable_hints = true;
     bool enable_item_tracking = true;
     
+    // Maximum number of received items and printed messages handled per tic.
+    // Anything above that is spread over the following tics.
+    int max_items_per_tic = 64;
+    int max_messages_per_tic = 8;
+    
     // UI settings
     bool show_connection_status = true;
     bool show_item_popups = true;
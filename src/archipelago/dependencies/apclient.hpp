@@ -30,4 +30,9 @@ public:
     void set_slot_refused_handler(std::function<void(const std::vector<std::string>&)> f) {}
     void set_items_received_handler(std::function<void(const std::vector<NetworkItem>&)> f) {}
     void set_print_json_handler(std::function<void(const json&)> f) {}
+    void set_location_checked_handler(std::function<void(const std::vector<int64_t>&)> f) {}
+    void set_data_package_changed_handler(std::function<void(const json&)> f) {}
+    
+    // Data package
+    void set_data_package(const json& data) {}
 };
@@ -1,5 +1,10 @@
 #include "selaco_integration.h"
 #include "../core/ap_manager.h"
+#include "../core/ap_state.h"
+#include "../core/ap_protocol.h"
+#include "../core/ap_datapackage.h"
+#include <chrono>
+#include <filesystem>
 
 // Include Selaco game headers - use the same pattern as other source files
 #include "common/console/c_console.h"
@@ -90,6 +95,91 @@ CCMD(ap_say) {
     }
 }
 
+// Measures the cost of persisting checks as the history grows. With the
+// journal this has to stay flat, full snapshots get slower with every check.
+CCMD(ap_journalbench) {
+    int count = argv.argc() > 1 ? atoi(argv[1]) : 20000;
+    if (count < 1000) count = 1000;
+    
+    std::error_code ec;
+    std::string filename = (std::filesystem::temp_directory_path(ec) / "ap_journalbench.json").string();
+    
+    APStateManager state;
+    if (!state.OpenJournal(filename)) {
+        Printf("Archipelago: Unable to open journal %s\n", filename.c_str());
+        return;
+    }
+    
+    int step = count / 10;
+    for (int i = 0; i < count; i += step) {
+        auto start = std::chrono::steady_clock::now();
+        for (int j = i; j < i + step; j++) {
+            state.MarkLocationChecked(j);
+            state.Update();
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        Printf("%6d checks: %.3f us/check\n", i + step, elapsed.count() / step);
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    state.SaveState(filename + ".full");
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    Printf("Full snapshot of %d checks: %.3f us\n", count, elapsed.count());
+    
+    state.CloseJournal();
+    std::filesystem::remove(filename, ec);
+    std::filesystem::remove(filename + ".journal", ec);
+    std::filesystem::remove(filename + ".full", ec);
+}
+
+// Compares the streaming decoder against the DOM path on a synthetic
+// ReceivedItems resync, which is what a reconnect to a long running seed sends.
+CCMD(ap_parsebench) {
+    int count = argv.argc() > 1 ? atoi(argv[1]) : 10000;
+    if (count < 1) count = 1;
+    
+    std::string frame = "[{\"cmd\":\"ReceivedItems\",\"index\":0,\"items\":[";
+    for (int i = 0; i < count; i++) {
+        if (i > 0) frame += ",";
+        frame += "{\"item\":" + std::to_string(SelacoAP::ITEM_BASE + i % 50) +
+            ",\"location\":" + std::to_string(SelacoAP::LOCATION_BASE + i) +
+            ",\"player\":" + std::to_string(1 + i % 8) +
+            ",\"flags\":" + std::to_string(i % 3) + ",\"class\":\"NetworkItem\"}";
+    }
+    frame += "]}]";
+    
+    APProtocolHandler protocol;
+    size_t decoded = 0;
+    APProtocolHandler::FrameSink sink;
+    sink.received_items = [&decoded](int index, const std::vector<NetworkItem>& items) {
+        decoded += items.size();
+    };
+    
+    auto start = std::chrono::steady_clock::now();
+    protocol.DecodeFrame(frame, sink);
+    std::chrono::duration<double, std::milli> sax = std::chrono::steady_clock::now() - start;
+    
+    start = std::chrono::steady_clock::now();
+    std::vector<NetworkItem> items;
+    nlohmann::json packets = nlohmann::json::parse(frame);
+    protocol.ParseReceivedItemsPacket(packets[0], items);
+    std::chrono::duration<double, std::milli> dom = std::chrono::steady_clock::now() - start;
+    
+    Printf("%d items (%d KB): streaming %.2f ms, DOM %.2f ms\n", (int)decoded, (int)(frame.size() / 1024), sax.count(), dom.count());
+}
+
+// Runs the network client's offline self-check, see APNetworkClient::SelfCheck.
+CCMD(ap_selfcheck) {
+    std::error_code ec;
+    std::string filename = (std::filesystem::temp_directory_path(ec) / "ap_selfcheck_outbox.json").string();
+    std::string report;
+    if (APNetworkClient::SelfCheck(filename, report)) {
+        Printf("Archipelago: Self-check passed\n");
+    } else {
+        Printf("Archipelago: Self-check failed:\n%s", report.c_str());
+    }
+}
+
 // Initialize Archipelago on game start
 static void InitializeArchipelago() {
     Printf("Archipelago: Initializing Selaco integration...\n");
@@ -128,6 +218,26 @@ public:
     }
 } g_archipelago_init;
 
+// Name lookups go through the room's DataPackage. Selaco's own ids are
+// checked first, the other games in the room are only searched if that fails.
+std::string GetItemName(int64_t item_id) {
+    if (const APDataPackage* package = Manager::GetInstance().GetDataPackage()) {
+        APName name = package->GetItemName("Selaco", item_id);
+        if (!name) name = package->GetItemName(item_id);
+        if (name) return name.get();
+    }
+    return "Item " + std::to_string(item_id);
+}
+
+std::string GetLocationName(int64_t location_id) {
+    if (const APDataPackage* package = Manager::GetInstance().GetDataPackage()) {
+        APName name = package->GetLocationName("Selaco", location_id);
+        if (!name) name = package->GetLocationName(location_id);
+        if (name) return name.get();
+    }
+    return "Location " + std::to_string(location_id);
+}
+
 // Update function to be called from game loop
 void UpdateArchipelago() {
     auto& manager = Manager::GetInstance();
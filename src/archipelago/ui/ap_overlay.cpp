@@ -1,4 +1,6 @@
 #include "ap_overlay.h"
+#include "../core/ap_manager.h"
+#include "../core/ap_datapackage.h"
 #include "common/2d/v_draw.h"
 #include "common/fonts/v_text.h"
 #include "common/fonts/v_font.h"
@@ -120,7 +122,12 @@ void APOverlay::Draw()
         }
         
         FString item_text;
-        item_text.Format("Received: Item %lld", current_popup_.item.item_id);
+        const APDataPackage* package = Manager::GetInstance().GetDataPackage();
+        APName item_name = package ? package->GetItemName("Selaco", current_popup_.item.item_id) : nullptr;
+        if (item_name)
+            item_text.Format("Received: %s", item_name.get());
+        else
+            item_text.Format("Received: Item %lld", current_popup_.item.item_id);
         
         DrawText(NewSmallFont, CR_WHITE, pos_x_, popup_y, item_text, 
                  DTA_Alpha, OPAQUE * alpha, TAG_DONE);
@@ -470,6 +470,8 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 	if (!isValidSoundId(sound_id) || volume <= 0 || nosfx || !SoundEnabled() || blockNewSounds)
 		return NULL;
 
+	NoteSoundUse(sound_id);
+
 	// prevent crashes.
 	if (type == SOURCE_Unattached && pt == nullptr) type = SOURCE_None;
 
@@ -257,6 +257,7 @@ private:
 protected:
 	virtual bool CheckSoundLimit(sfxinfo_t* sfx, const FVector3& pos, int near_limit, float limit_range, int sourcetype, const void* actor, int channel, float attenuation, sfxinfo_t* compareOrgID = nullptr);
 	virtual FSoundID ResolveSound(const void *ent, int srctype, FSoundID soundid, float &attenuation);
+	virtual void NoteSoundUse(FSoundID soundid) {}	// called for every sound that gets started
 
 public:
 	virtual ~SoundEngine()
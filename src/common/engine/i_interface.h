@@ -48,6 +48,7 @@ struct SystemCallbacks
 	FConfigFile* (*GetConfig)();
 	bool (*WantEscape)();
 	FTranslationID(*RemapTranslation)(FTranslationID trans);
+	void (*TextureSeen)(FGameTexture* tex);
 };
 
 extern SystemCallbacks sysCallbacks;
@@ -66,6 +66,8 @@
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
+static TMap<int, FString> PreloadedLumps;
+
 // CODE --------------------------------------------------------------------
 
 void VersionInfo::operator=(const char *string)
@@ -199,6 +201,12 @@ void FScanner::OpenString (const char *name, FString buffer)
 void FScanner :: OpenLumpNum (int lump)
 {
 	Close ();
+	if (auto preloaded = PreloadedLumps.CheckKey(lump))
+	{
+		ScriptBuffer = *preloaded;
+		PreloadedLumps.Remove(lump);
+	}
+	else
 	{
 		auto len = fileSystem.FileLength(lump);
 		auto buff = ScriptBuffer.LockNewBuffer(len);
@@ -211,6 +219,22 @@ void FScanner :: OpenLumpNum (int lump)
 	PrepareScript ();
 }
 
+//==========================================================================
+//
+// SC_SetPreloadedLumps
+//
+//==========================================================================
+
+void SC_SetPreloadedLumps(TMap<int, FString> &lumps)
+{
+	PreloadedLumps.TransferFrom(lumps);
+}
+
+void SC_ClearPreloadedLumps()
+{
+	PreloadedLumps.Clear();
+}
+
 //==========================================================================
 //
 // FScanner :: PrepareScript
@@ -310,5 +310,10 @@ struct FScriptPosition
 
 int ParseHex(const char* hex, FScriptPosition* sc);
 
+// Lump contents that were read ahead on another thread. OpenLumpNum uses
+// each one once instead of reading the lump. Main thread only.
+void SC_SetPreloadedLumps(TMap<int, FString> &lumps);
+void SC_ClearPreloadedLumps();
+
 
 #endif //__SC_MAN_H__
@@ -0,0 +1,221 @@
+/*
+** startupgraph.cpp
+** Dependency graph for the engine startup stages
+**
+*/
+
+#include <string.h>
+#include <algorithm>
+#include "startupgraph.h"
+#include "files.h"
+#include "printf.h"
+#include "engineerrors.h"
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FStartupGraph::~FStartupGraph()
+{
+	// Also reached when a main thread stage throws, so the workers must not outlive the graph.
+	StopWorkers();
+}
+
+void FStartupGraph::AddTask(const char *name, std::initializer_list<const char *> deps, TaskFunc func)
+{
+	Add(name, deps, std::move(func), false);
+}
+
+void FStartupGraph::AddWorkerTask(const char *name, std::initializer_list<const char *> deps, TaskFunc func)
+{
+	Add(name, deps, std::move(func), true);
+}
+
+void FStartupGraph::Add(const char *name, std::initializer_list<const char *> deps, TaskFunc func, bool worker)
+{
+	auto task = std::make_unique<Task>();
+	task->Name = name;
+	task->Func = std::move(func);
+	task->Worker = worker;
+	for (auto dep : deps)
+	{
+		auto it = std::find_if(Tasks.begin(), Tasks.end(), [=](const std::unique_ptr<Task> &t) { return t->Name.CompareNoCase(dep) == 0; });
+		if (it == Tasks.end())
+		{
+			I_FatalError("Startup stage '%s' depends on unknown stage '%s'", name, dep);
+		}
+		task->Deps.push_back(int(it - Tasks.begin()));
+	}
+	Tasks.push_back(std::move(task));
+}
+
+double FStartupGraph::Now() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Origin).count();
+}
+
+// Must be called with the mutex held.
+bool FStartupGraph::IsReady(const Task &task) const
+{
+	for (int dep : task.Deps)
+	{
+		if (!Tasks[dep]->Done) return false;
+	}
+	return true;
+}
+
+void FStartupGraph::Execute(Task &task, int thread)
+{
+	task.Thread = thread;
+	task.Start = Now();
+	task.Func();
+	task.End = Now();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FStartupGraph::WorkerMain(int thread)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	for (;;)
+	{
+		Task *next = nullptr;
+		bool pending = false;
+		for (auto &task : Tasks)
+		{
+			if (!task->Worker || task->Started) continue;
+			pending = true;
+			if (IsReady(*task))
+			{
+				next = task.get();
+				break;
+			}
+		}
+		if (!pending || aborted) return;
+		if (next == nullptr)
+		{
+			Signal.wait(lock);
+			continue;
+		}
+
+		next->Started = true;
+		lock.unlock();
+		try
+		{
+			Execute(*next, thread);
+		}
+		catch (...)
+		{
+			lock.lock();
+			if (!WorkerError) WorkerError = std::current_exception();
+			aborted = true;
+			next->Done = true;
+			Signal.notify_all();
+			return;
+		}
+		lock.lock();
+		next->Done = true;
+		Signal.notify_all();
+	}
+}
+
+void FStartupGraph::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		aborted = true;
+	}
+	Signal.notify_all();
+	for (auto &worker : Workers)
+	{
+		if (worker.joinable()) worker.join();
+	}
+	Workers.clear();
+}
+
+void FStartupGraph::Run()
+{
+	int numworkers = 0;
+	for (auto &task : Tasks)
+	{
+		if (task->Worker) numworkers++;
+	}
+	NumWorkers = std::min({ numworkers, 4, std::max(1, (int)std::thread::hardware_concurrency() - 1) });
+	for (int i = 0; i < NumWorkers; i++)
+	{
+		Workers.emplace_back(&FStartupGraph::WorkerMain, this, i + 1);
+	}
+
+	for (auto &task : Tasks)
+	{
+		if (task->Worker) continue;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			Signal.wait(lock, [&] { return IsReady(*task) || WorkerError; });
+			if (WorkerError)
+			{
+				lock.unlock();
+				StopWorkers();
+				std::rethrow_exception(WorkerError);
+			}
+			task->Started = true;
+		}
+		Execute(*task, 0);
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			task->Done = true;
+		}
+		Signal.notify_all();
+	}
+
+	// Whatever is still running on the workers now is of no use to anyone.
+	StopWorkers();
+	if (WorkerError) std::rethrow_exception(WorkerError);
+}
+
+//==========================================================================
+//
+// Chrome trace event format, one complete event per stage.
+//
+//==========================================================================
+
+bool FStartupGraph::WriteTrace(const char *filename) const
+{
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(filename));
+	if (fw == nullptr) return false;
+
+	FString out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Main\"}}";
+	for (int i = 1; i <= NumWorkers; i++)
+	{
+		out.AppendFormat(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Worker %d\"}}", i, i);
+	}
+	for (auto &task : Tasks)
+	{
+		if (!task->Started) continue;
+		// Stage names are plain identifiers, so they need no escaping.
+		out.AppendFormat(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.0f,\"dur\":%.0f}",
+			task->Name.GetChars(), task->Worker ? "worker" : "main", task->Thread, task->Start * 1000., (task->End - task->Start) * 1000.);
+	}
+	out << "\n]}\n";
+	return fw->Write(out.GetChars(), out.Len()) == out.Len();
+}
+
+void FStartupGraph::PrintTimes() const
+{
+	double total = 0;
+	for (auto &task : Tasks)
+	{
+		if (!task->Started) continue;
+		Printf("%-20s %s %8.2f ms\n", task->Name.GetChars(), task->Worker ? "(worker)" : "        ", task->End - task->Start);
+		// Abandoned workers do not hold up the main thread, so only its stages count.
+		if (!task->Worker) total = std::max(total, task->End);
+	}
+	Printf("%-20s          %8.2f ms\n", "total", total);
+}
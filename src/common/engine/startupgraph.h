@@ -0,0 +1,83 @@
+#pragma once
+/*
+** startupgraph.h
+** Dependency graph for the engine startup stages
+**
+*/
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <chrono>
+#include "zstring.h"
+
+//==========================================================================
+//
+// Startup is split into named stages with explicit dependencies.
+//
+// Main thread stages run on the thread that calls Run(), in the order
+// they were added, each one as soon as everything it depends on is done.
+// Worker stages run on a small thread pool concurrently with the main
+// thread and must not touch anything that is not thread safe - that
+// includes the console, the VM and the texture manager. The file system
+// may only be used for lookups and for reading lumps that no main thread
+// stage reads at the same time.
+// A worker stage nothing on the main thread depends on is optional and
+// gets asked to stop through Aborted() once the main thread is done.
+//
+// Every stage is timed, and the timeline can be written out in Chrome's
+// trace event format (chrome://tracing, Perfetto).
+//
+//==========================================================================
+
+class FStartupGraph
+{
+public:
+	using TaskFunc = std::function<void()>;
+
+	~FStartupGraph();
+
+	// Dependencies must have been added before the stage that uses them.
+	void AddTask(const char *name, std::initializer_list<const char *> deps, TaskFunc func);
+	void AddWorkerTask(const char *name, std::initializer_list<const char *> deps, TaskFunc func);
+
+	void Run();
+	bool Aborted() const { return aborted; }
+
+	bool WriteTrace(const char *filename) const;
+	void PrintTimes() const;
+
+private:
+	struct Task
+	{
+		FString Name;
+		std::vector<int> Deps;
+		TaskFunc Func;
+		bool Worker;
+		bool Started = false;
+		bool Done = false;
+		int Thread = 0;
+		double Start = 0, End = 0;		// in ms since the graph was created
+	};
+
+	void Add(const char *name, std::initializer_list<const char *> deps, TaskFunc func, bool worker);
+	bool IsReady(const Task &task) const;
+	void Execute(Task &task, int thread);
+	void WorkerMain(int thread);
+	void StopWorkers();
+	double Now() const;
+
+	std::vector<std::unique_ptr<Task>> Tasks;
+	std::vector<std::thread> Workers;
+	int NumWorkers = 0;
+	std::mutex Mutex;
+	std::condition_variable Signal;
+	std::atomic<bool> aborted{ false };
+	std::exception_ptr WorkerError;
+	std::chrono::steady_clock::time_point Origin = std::chrono::steady_clock::now();
+};
@@ -42,6 +42,7 @@ public:
 	void SetMaxIwadNum(int x) { MaxIwadIndex = x; }
 
 	bool HasExtraWads() { return (int)Files.size() > MaxIwadIndex + 1; }
+	void SetMapFiles(bool on) { MapFiles = on; }
 
 	bool InitSingleFile(const char *filename, FileSystemMessageFunc Printf = nullptr);
 	bool InitMultipleFiles (std::vector<std::string>& filenames, LumpFilterInfo* filter = nullptr, FileSystemMessageFunc Printf = nullptr, bool allowduplicates = false, FILE* hashfile = nullptr);
@@ -179,10 +180,14 @@ protected:
 
 	int IwadIndex = -1;
 	int MaxIwadIndex = -1;
+	bool MapFiles = true;	// memory map archives instead of reading them through stdio
 
 	StringPool* stringpool = nullptr;
 
 private:
+	struct PreparedFile;
+	bool PrepareFile(const char *filename, PreparedFile &file, LumpFilterInfo* filter, FileSystemMessageFunc Printf, StringPool *sp, bool checksum);
+	void AddPreparedFile(const char *filename, PreparedFile &file, LumpFilterInfo* filter, FileSystemMessageFunc Printf, FILE* hashfile);
 	void DeleteAll();
 	void MoveLumpsInFolder(const char *);
 
@@ -169,6 +169,9 @@ public:
 
 	// @Cocaktrice - Used for moving the file reader past the header (mostly zips) from exterior thread
 	virtual void SkipHeader(FileReader& fr);
+	// The same for archives in memory, returns the size of the header at the given address.
+	virtual size_t GetHeaderSize(const char* header, size_t avail) { return 0; }
+	size_t GetDataPosition(uint32_t entry);
 
 	// default is the safest reader type.
 	virtual FileReader GetEntryReader(uint32_t entry, int readertype = READER_NEW, int flags = READERFLAG_SEEKABLE);
@@ -111,6 +111,7 @@ class FZipFile : public FResourceFile
 {
 	void SetEntryAddress(uint32_t entry) override;
 	void SkipHeader(FileReader& fr) override;
+	size_t GetHeaderSize(const char* header, size_t avail) override;
 
 public:
 	FZipFile(const char* filename, FileReader& file, StringPool* sp);
@@ -389,6 +390,15 @@ void FZipFile::SkipHeader(FileReader& fr) {
 	fr.ShiftStart(sizeof(localHeader) + skiplen);
 }
 
+size_t FZipFile::GetHeaderSize(const char* header, size_t avail)
+{
+	FZipLocalFileHeader localHeader;
+
+	if (avail < sizeof(localHeader)) return 0;
+	memcpy(&localHeader, header, sizeof(localHeader));
+	return sizeof(localHeader) + LittleShort(localHeader.NameLength) + LittleShort(localHeader.ExtraLength);
+}
+
 //==========================================================================
 //
 // File open
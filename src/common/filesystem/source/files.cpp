@@ -38,6 +38,15 @@
 #include <algorithm>
 #include <assert.h>
 #include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "zstring.h"
 #include "files_internal.h"
 
@@ -385,6 +394,70 @@ char* BufferingReader::Gets(char* strbuf, ptrdiff_t len)
 	return MemoryReader::Gets(strbuf, len);
 }
 
+//==========================================================================
+//
+// MappedFileReader
+//
+// maps an entire file into memory. Since this is a memory reader, stored
+// lumps can be handed out without copying them, any number of threads can
+// read from it at once, and the pages are shared with the OS file cache
+// instead of being duplicated in a private buffer.
+//
+//==========================================================================
+
+class MappedFileReader : public MemoryReader
+{
+#ifdef _WIN32
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	HANDLE hMapping = nullptr;
+#endif
+
+public:
+	~MappedFileReader()
+	{
+#ifdef _WIN32
+		if (bufptr) UnmapViewOfFile(bufptr);
+		if (hMapping) CloseHandle(hMapping);
+		if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+#else
+		if (bufptr) munmap((void*)bufptr, Length);
+#endif
+	}
+
+	bool Open(const char *filename)
+	{
+#ifdef _WIN32
+		hFile = CreateFileW(toWide(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(hFile, &size) || size.QuadPart <= 0 || (uint64_t)size.QuadPart > (uint64_t)PTRDIFF_MAX) return false;
+		hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (hMapping == nullptr) return false;
+		bufptr = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (bufptr == nullptr) return false;
+		Length = (ptrdiff_t)size.QuadPart;
+#else
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0) return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0)
+		{
+			close(fd);
+			return false;
+		}
+		// Truncating the file on disk while it is mapped raises SIGBUS on the next access to the
+		// lost pages. MAP_PRIVATE would not prevent that, read-only private pages come from the file, too.
+		void *mem = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);	// the mapping stays valid.
+		if (mem == MAP_FAILED) return false;
+		bufptr = (const char*)mem;
+		Length = (ptrdiff_t)info.st_size;
+#endif
+		FilePos = 0;
+		return true;
+	}
+};
+
 //==========================================================================
 //
 // FileReader
@@ -407,6 +480,23 @@ bool FileReader::OpenFile(const char *filename, FileReader::Size start, FileRead
 	return true;
 }
 
+bool FileReader::OpenMappedFile(const char *filename)
+{
+	// Mapping large archives could exhaust a 32 bit address space.
+	if (sizeof(void*) >= 8)
+	{
+		auto reader = new MappedFileReader;
+		if (reader->Open(filename))
+		{
+			Close();
+			mReader = reader;
+			return true;
+		}
+		delete reader;
+	}
+	return OpenFile(filename);
+}
+
 bool FileReader::OpenFilePart(FileReader &parent, FileReader::Size start, FileReader::Size length)
 {
 	auto reader = new FileReaderRedirect(parent, start, length);
@@ -47,6 +47,11 @@
 #include "fs_findfile.h"
 #include "md5.hpp"
 #include "fs_stringpool.h"
+#include <stdarg.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <exception>
 
 namespace FileSys {
 	
@@ -221,6 +226,59 @@ void FileSystem::DeleteAll ()
 	stringpool = nullptr;
 }
 
+//==========================================================================
+//
+// Files are opened in two steps, see PrepareFile and AddPreparedFile.
+//
+//==========================================================================
+
+struct FileSystem::PreparedFile
+{
+	FileReader Reader;
+	std::unique_ptr<FResourceFile> ResFile;	// owned until AddPreparedFile hands it to Files
+	bool Found = false;
+	bool IsDir = false;
+	std::string Checksum;	// of the whole file, only calculated for the hash file.
+	ptrdiff_t Size = 0;
+	std::vector<std::pair<FSMessageLevel, std::string>> Messages;
+	std::exception_ptr Error;
+};
+
+static thread_local std::vector<std::pair<FSMessageLevel, std::string>> *DeferredMessages;
+
+static int DeferredPrintf(FSMessageLevel level, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	char buffer[1024];
+	int len = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+	va_end(ap);
+	if (len < 0) return 0;
+	DeferredMessages->emplace_back(level, std::string(buffer, std::min<size_t>(len, sizeof(buffer) - 1)));
+	return len;
+}
+
+static std::string ChecksumString(const uint8_t *cksum)
+{
+	char cksumout[33];
+	for (size_t j = 0; j < 16; ++j)
+	{
+		snprintf(cksumout + (j * 2), 3, "%02X", cksum[j]);
+	}
+	return cksumout;
+}
+
+// The resource file takes over the reader, so this must be done before opening it.
+static void ChecksumFile(FileReader &reader, std::string &checksum, ptrdiff_t &size)
+{
+	uint8_t cksum[16];
+	size = reader.GetLength();
+	reader.Seek(0, FileReader::SeekSet);
+	md5Hash(reader, cksum);
+	reader.Seek(0, FileReader::SeekSet);
+	checksum = ChecksumString(cksum);
+}
+
 //==========================================================================
 //
 // InitMultipleFiles
@@ -267,9 +325,45 @@ bool FileSystem::InitMultipleFiles (std::vector<std::string>& filenames, LumpFil
 		}
 	}
 
+	// Reading the directories of large archives is most of the time spent here, and
+	// the archives do not depend on each other, so they are opened in parallel and
+	// then added in load order.
+	std::vector<PreparedFile> prepared(filenames.size());
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]()
+	{
+		std::vector<std::pair<FSMessageLevel, std::string>> *oldmessages = DeferredMessages;
+		for (size_t i; (i = next++) < filenames.size(); )
+		{
+			auto &file = prepared[i];
+			DeferredMessages = &file.Messages;
+			try
+			{
+				// Each file gets a private string pool because the shared one is not thread safe.
+				PrepareFile(filenames[i].c_str(), file, filter, Printf ? DeferredPrintf : nullptr, nullptr, hashfile != nullptr);
+			}
+			catch (...)
+			{
+				file.Error = std::current_exception();
+			}
+		}
+		DeferredMessages = oldmessages;
+	};
+	size_t numthreads = std::min<size_t>({ filenames.size(), std::max(1u, std::thread::hardware_concurrency()), 8 });
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < numthreads; i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
 	for(size_t i=0;i<filenames.size(); i++)
 	{
-		AddFile(filenames[i].c_str(), nullptr, filter, Printf, hashfile);
+		AddPreparedFile(filenames[i].c_str(), prepared[i], filter, Printf, hashfile);
 
 		if (i == (unsigned)MaxIwadIndex) MoveLumpsInFolder("after_iwad/");
 		std::string path = "filter/%s";
@@ -319,57 +413,90 @@ int FileSystem::AddFromBuffer(const char* name, char* data, int size, int id, in
 
 //==========================================================================
 //
-// AddFile
+// PrepareFile
 //
-// Files with a .wad extension are wadlink files with multiple lumps,
-// other files are single lumps with the base filename for the lump name.
+// Opens a file and reads its directory. This touches nothing shared, so it
+// may run on any thread as long as the file gets its own string pool and
+// its messages get printed later on the main thread.
 //
-// [RH] Removed reload hack
 //==========================================================================
 
-void FileSystem::AddFile (const char *filename, FileReader *filer, LumpFilterInfo* filter, FileSystemMessageFunc Printf, FILE* hashfile)
+bool FileSystem::PrepareFile(const char *filename, PreparedFile &file, LumpFilterInfo* filter, FileSystemMessageFunc Printf, StringPool *sp, bool checksum)
 {
-	int startlump;
-	bool isdir = false;
-	FileReader filereader;
-
-	if (filer == nullptr)
+	// Does this exist? If so, is it a directory?
+	if (!FS_DirEntryExists(filename, &file.IsDir))
 	{
-		// Does this exist? If so, is it a directory?
-		if (!FS_DirEntryExists(filename, &isdir))
+		if (Printf)
 		{
+			Printf(FSMessageLevel::Error, "%s: File or Directory not found\n", filename);
+			PrintLastError(Printf);
+		}
+		return false;
+	}
+
+	if (!file.IsDir)
+	{
+		if (!(MapFiles ? file.Reader.OpenMappedFile(filename) : file.Reader.OpenFile(filename)))
+		{ // Didn't find file
 			if (Printf)
 			{
-				Printf(FSMessageLevel::Error, "%s: File or Directory not found\n", filename);
+				Printf(FSMessageLevel::Error, "%s: File not found\n", filename);
 				PrintLastError(Printf);
 			}
-			return;
-		}
-
-		if (!isdir)
-		{
-			if (!filereader.OpenFile(filename))
-			{ // Didn't find file
-				if (Printf)
-				{
-					Printf(FSMessageLevel::Error, "%s: File not found\n", filename);
-					PrintLastError(Printf);
-				}
-				return;
-			}
+			return false;
 		}
+		if (checksum) ChecksumFile(file.Reader, file.Checksum, file.Size);
+		file.ResFile.reset(FResourceFile::OpenResourceFile(filename, file.Reader, false, filter, Printf, sp));
 	}
-	else filereader = std::move(*filer);
+	else
+		file.ResFile.reset(FResourceFile::OpenDirectory(filename, filter, Printf, sp));
 
-	startlump = NumEntries;
+	file.Found = true;
+	return true;
+}
 
-	FResourceFile *resfile;
+//==========================================================================
+//
+// AddFile
+//
+// Files with a .wad extension are wadlink files with multiple lumps,
+// other files are single lumps with the base filename for the lump name.
+//
+// [RH] Removed reload hack
+//==========================================================================
 
+void FileSystem::AddFile (const char *filename, FileReader *filer, LumpFilterInfo* filter, FileSystemMessageFunc Printf, FILE* hashfile)
+{
+	PreparedFile file;
 
-	if (!isdir)
-		resfile = FResourceFile::OpenResourceFile(filename, filereader, false, filter, Printf, stringpool);
+	if (filer == nullptr)
+	{
+		if (!PrepareFile(filename, file, filter, Printf, stringpool, hashfile != nullptr)) return;
+	}
 	else
-		resfile = FResourceFile::OpenDirectory(filename, filter, Printf, stringpool);
+	{
+		file.Reader = std::move(*filer);
+		if (hashfile) ChecksumFile(file.Reader, file.Checksum, file.Size);
+		file.ResFile.reset(FResourceFile::OpenResourceFile(filename, file.Reader, false, filter, Printf, stringpool));
+		file.Found = true;
+	}
+	AddPreparedFile(filename, file, filter, Printf, hashfile);
+}
+
+void FileSystem::AddPreparedFile(const char *filename, PreparedFile &file, LumpFilterInfo* filter, FileSystemMessageFunc Printf, FILE* hashfile)
+{
+	if (Printf)
+	{
+		for (auto &msg : file.Messages)
+		{
+			Printf(msg.first, "%s", msg.second.c_str());
+		}
+	}
+	file.Messages.clear();
+	if (file.Error) std::rethrow_exception(file.Error);
+	if (!file.Found) return;
+
+	FResourceFile *resfile = file.ResFile.release();
 
 	if (resfile != NULL)
 	{
@@ -403,20 +530,10 @@ void FileSystem::AddFile (const char *filename, FileReader *filer, LumpFilterInf
 		if (hashfile)
 		{
 			uint8_t cksum[16];
-			char cksumout[33];
-			memset(cksumout, 0, sizeof(cksumout));
 
-			if (filereader.isOpen())
+			if (!file.Checksum.empty())
 			{
-				filereader.Seek(0, FileReader::SeekSet);
-				md5Hash(filereader, cksum);
-
-				for (size_t j = 0; j < sizeof(cksum); ++j)
-				{
-					snprintf(cksumout + (j * 2), 3, "%02X", cksum[j]);
-				}
-
-				fprintf(hashfile, "file: %s, hash: %s, size: %td\n", filename, cksumout, filereader.GetLength());
+				fprintf(hashfile, "file: %s, hash: %s, size: %td\n", filename, file.Checksum.c_str(), file.Size);
 			}
 
 			else
@@ -428,14 +545,9 @@ void FileSystem::AddFile (const char *filename, FileReader *filer, LumpFilterInf
 				if (!(flags & RESFF_EMBEDDED))
 				{
 					auto reader = resfile->GetEntryReader(i, READER_SHARED, 0);
-					md5Hash(filereader, cksum);
-
-					for (size_t j = 0; j < sizeof(cksum); ++j)
-					{
-						snprintf(cksumout + (j * 2), 3, "%02X", cksum[j]);
-					}
+					md5Hash(reader, cksum);
 
-					fprintf(hashfile, "file: %s, lump: %s, hash: %s, size: %zu\n", filename, resfile->getName(i), cksumout, (uint64_t)resfile->Length(i));
+					fprintf(hashfile, "file: %s, lump: %s, hash: %s, size: %zu\n", filename, resfile->getName(i), ChecksumString(cksum).c_str(), (uint64_t)resfile->Length(i));
 				}
 			}
 		}
@@ -677,7 +677,7 @@ FileReader FResourceFile::GetEntryReader(uint32_t entry, int readertype, int rea
 			// if this is backed by a memory buffer, create a new reader directly referencing it.
 			if (buf != nullptr)
 			{
-				fr.OpenMemory(buf + Entries[entry].Position, Entries[entry].Length);
+				fr.OpenMemory(buf + GetDataPosition(entry), Entries[entry].Length);
 			}
 			else
 			{
@@ -703,8 +703,12 @@ FileReader FResourceFile::GetEntryReader(uint32_t entry, int readertype, int rea
 		else
 		{
 			FileReader fri;
-			
-			if (readertype == READER_NEW || !mainThread) {
+			auto buf = Reader.GetBuffer();
+
+			if (buf != nullptr) {
+				// Memory backed readers can be shared by any number of threads.
+				fri.OpenMemory(buf + GetDataPosition(entry), Entries[entry].CompressedSize);
+			} else if (readertype == READER_NEW || !mainThread) {
 				fri.OpenFile(FileName, Entries[entry].Position, Entries[entry].CompressedSize);
 				
 				// @Cockatrice - To make this properly thread safe we CANNOT write the filestart info
@@ -727,6 +731,26 @@ void FResourceFile::SkipHeader(FileReader& fr) {
 	// Do nothing by defualt
 }
 
+//==========================================================================
+//
+// Where an entry's data starts in a memory backed archive. Other threads
+// may not store the skipped header, so they read it again from memory.
+// The header cannot be skipped on a reader limited to the entry's data,
+// that would cut off small entries.
+//
+//==========================================================================
+
+size_t FResourceFile::GetDataPosition(uint32_t entry)
+{
+	size_t pos = Entries[entry].Position;
+	if (!mainThread && (Entries[entry].Flags & RESFF_NEEDFILESTART))
+	{
+		size_t length = Reader.GetLength();
+		if (pos < length) pos += GetHeaderSize(Reader.GetBuffer() + pos, length - pos);
+	}
+	return pos;
+}
+
 
 FileData FResourceFile::Read(uint32_t entry)
 {
@@ -736,7 +760,10 @@ FileData FResourceFile::Read(uint32_t entry)
 		// if this is backed by a memory buffer, we can just return a reference to the backing store.
 		if (buf != nullptr)
 		{
-			return FileData(buf + Entries[entry].Position, Entries[entry].Length, false);
+			if ((Entries[entry].Flags & RESFF_NEEDFILESTART) && mainThread)
+				SetEntryAddress(entry);
+			if (!(Entries[entry].Flags & RESFF_NEEDFILESTART))
+				return FileData(buf + Entries[entry].Position, Entries[entry].Length, false);
 		}
 	}
 
@@ -85,6 +85,14 @@ FSavegameManagerBase::~FSavegameManagerBase()
 
 int FSavegameManagerBase::RemoveSaveSlot(int index)
 {
+	if ((unsigned)index >= SaveGames.Size()) return index;
+
+	// Finishing the save may insert its node, so the index must be looked up again afterward.
+	FSaveGameNode *node = SaveGames[index];
+	FinishPendingSave();
+	index = SaveGames.Find(node);
+	if ((unsigned)index >= SaveGames.Size()) return -1;
+
 	int listindex = SaveGames[0]->bNoDelete ? index - 1 : index;
 	if (listindex < 0) return index;
 
@@ -177,6 +185,7 @@ void FSavegameManagerBase::NotifyNewSave(const FString &file, const FString &tit
 			node->saveDate = saveDate;
 			node->bOldVersion = false;
 			node->bMissingWads = false;
+			node->PicLength = 0;	// the file has been rewritten.
 
 			SaveGames.Delete(i);
 			i = InsertSaveNode(node);
@@ -308,6 +317,42 @@ unsigned FSavegameManagerBase::ExtractSaveData(int index)
 
 	UnloadSaveData();
 
+	// If the savegame index told us where the savepic is, read it directly instead of opening the entire archive.
+	if ((unsigned)index < SaveGames.Size() &&
+		(node = SaveGames[index]) &&
+		!node->Filename.IsEmpty() &&
+		!node->bOldVersion &&
+		node->PicLength > 0)
+	{
+		FileReader fr;
+		if (fr.OpenFile(node->Filename.GetChars(), node->PicOffset, node->PicLength))
+		{
+			// Read everything into memory so that the savegame file does not remain locked.
+			auto picdata = fr.Read();
+			fr.Close();
+			if (picdata.size() == node->PicLength)
+			{
+				FileReader picreader;
+				picreader.OpenMemoryArray(picdata);
+				PNGHandle *png = M_VerifyPNG(picreader);
+				if (png != nullptr)
+				{
+					SaveCommentString = node->SaveComment;
+					SavePic = PNGTexture_CreateFromFile(png, node->Filename);
+					delete png;
+					if (SavePic && SavePic->GetDisplayWidth() == 1 && SavePic->GetDisplayHeight() == 1)
+					{
+						delete SavePic;
+						SavePic = nullptr;
+					}
+					return index;
+				}
+			}
+		}
+		// The index was stale. Use the slow path below.
+		node->PicLength = 0;
+	}
+
 	if ((unsigned)index < SaveGames.Size() &&
 		(node = SaveGames[index]) &&
 		!node->Filename.IsEmpty() &&
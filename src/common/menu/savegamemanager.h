@@ -12,6 +12,9 @@ struct FSaveGameNode
 	int saveDate;
 	FString SaveTitle;
 	FString Filename;
+	FString SaveComment;		// only valid if PicLength is not 0.
+	size_t PicOffset = 0;		// location of the uncompressed savepic inside the file, if known.
+	size_t PicLength = 0;
 	bool bOldVersion = false;
 	bool bMissingWads = false;
 	bool bNoDelete = false;
@@ -38,6 +41,7 @@ protected:
 	virtual void PerformLoadGame(const char *fn, bool) = 0;
 	virtual FString ExtractSaveComment(FSerializer &arc) = 0;
 	virtual FString BuildSaveName(const char* prefix, int slot) = 0;
+	virtual void FinishPendingSave() {}	// a save that is still being written must be complete before files get deleted.
 public:
 	void NotifyNewSave(const FString &file, const FString &title, int saveDate, bool okForQuicksave, bool forceQuicksave);
 	void ClearSaveGames();
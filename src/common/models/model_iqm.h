@@ -120,7 +120,7 @@ public:
 	void BuildVertexBuffer(FModelRenderer* renderer) override;
 	void AddSkins(uint8_t* hitlist, const FTextureID* surfaceskinids) override;
 	const TArray<TRS>* AttachAnimationData() override;
-	const TArray<VSMatrix> CalculateBones(int frame1, int frame2, float inter, int frame1_prev, float inter1_prev, int frame2_prev, float inter2_prev, const TArray<TRS>* animationData, DBoneComponents* bones, int index) override;
+	const TArray<VSMatrix>& CalculateBones(int frame1, int frame2, float inter, int frame1_prev, float inter1_prev, int frame2_prev, float inter2_prev, const TArray<TRS>* animationData, DBoneComponents* bones, int index) override;
 
 private:
 	void LoadGeometry();
@@ -150,6 +150,8 @@ private:
 
 	TArray<VSMatrix> baseframe;
 	TArray<VSMatrix> inversebaseframe;
+	TArray<VSMatrix> JointPre;		// swapYZ * baseframe[parent]
+	TArray<VSMatrix> JointPost;		// inversebaseframe * swapYZ
 	TArray<TRS> TRSData;
 };
 
@@ -176,6 +176,19 @@ bool IQMModel::Load(const char* path, int lumpnum, const char* buffer, int lengt
 			}			
 		}
 
+		// The constant parts of every joint's transform, so that posing a joint
+		// only takes three matrix multiplications instead of six.
+		static const float swapYZ[16] = { 1, 0, 0, 0,  0, 0, 1, 0,  0, 1, 0, 0,  0, 0, 0, 1 };
+		JointPre.Resize(num_joints);
+		JointPost.Resize(num_joints);
+		for (uint32_t i = 0; i < num_joints; i++)
+		{
+			JointPre[i].loadMatrix(swapYZ);
+			if (Joints[i].Parent >= 0) JointPre[i].multMatrix(baseframe[Joints[i].Parent]);
+			JointPost[i] = inversebaseframe[i];
+			JointPost[i].multMatrix(swapYZ);
+		}
+
 		TRSData.Resize(num_frames * num_poses);
 		reader.SeekTo(ofs_frames);
 		for (uint32_t i = 0; i < num_frames; i++)
@@ -541,11 +554,39 @@ const TArray<TRS>* IQMModel::AttachAnimationData()
 	return &TRSData;
 }
 
+#if !defined(USE_DOUBLE) && (defined(_M_X64) || defined(_M_IX86) || defined(__i386__) || defined(__amd64__))
+#define IQM_SSE2
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <emmintrin.h>
+#endif
+
 static TRS InterpolateBone(const TRS &from, const TRS &to, float t, float invt)
 {
 	TRS bone;
 
 	bone.translation = from.translation * invt + to.translation * t;
+	bone.scaling = from.scaling * invt + to.scaling * t;
+
+#ifdef IQM_SSE2
+	__m128 a = _mm_mul_ps(_mm_loadu_ps(&from.rotation.X), _mm_set1_ps(invt));
+	__m128 b = _mm_mul_ps(_mm_loadu_ps(&to.rotation.X), _mm_set1_ps(t));
+
+	// Take the shorter way around.
+	__m128 dot = _mm_mul_ps(a, b);
+	dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+	dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+	a = _mm_xor_ps(a, _mm_and_ps(dot, _mm_set1_ps(-0.f)));
+
+	__m128 q = _mm_add_ps(a, b);
+	__m128 len = _mm_mul_ps(q, q);
+	len = _mm_add_ps(len, _mm_shuffle_ps(len, len, _MM_SHUFFLE(2, 3, 0, 1)));
+	len = _mm_sqrt_ps(_mm_add_ps(len, _mm_shuffle_ps(len, len, _MM_SHUFFLE(1, 0, 3, 2))));
+	if (_mm_cvtss_f32(len) != 0) q = _mm_div_ps(q, len);
+	_mm_storeu_ps(&bone.rotation.X, q);
+#else
 	bone.rotation = from.rotation * invt;
 
 	if ((bone.rotation | to.rotation * t) < 0)
@@ -555,22 +596,84 @@ static TRS InterpolateBone(const TRS &from, const TRS &to, float t, float invt)
 
 	bone.rotation += to.rotation * t;
 	bone.rotation.MakeUnit();
-	bone.scaling = from.scaling * invt + to.scaling * t;
+#endif
 
 	return bone;
 }
 
-const TArray<VSMatrix> IQMModel::CalculateBones(int frame1, int frame2, float inter, int frame1_prev, float inter1_prev, int frame2_prev, float inter2_prev, const TArray<TRS>* animationData, DBoneComponents* boneComponentData, int index)
+// Same as loadIdentity, translate, multQuaternion and scale in a row.
+static void ComposeBone(const TRS &bone, FLOATTYPE *m)
+{
+	const auto &q = bone.rotation;
+	const auto &s = bone.scaling;
+	m[0] = (1 - 2 * q.Y * q.Y - 2 * q.Z * q.Z) * s.X;
+	m[1] = (2 * q.X * q.Y + 2 * q.W * q.Z) * s.X;
+	m[2] = (2 * q.X * q.Z - 2 * q.W * q.Y) * s.X;
+	m[3] = 0;
+	m[4] = (2 * q.X * q.Y - 2 * q.W * q.Z) * s.Y;
+	m[5] = (1 - 2 * q.X * q.X - 2 * q.Z * q.Z) * s.Y;
+	m[6] = (2 * q.Y * q.Z + 2 * q.W * q.X) * s.Y;
+	m[7] = 0;
+	m[8] = (2 * q.X * q.Z + 2 * q.W * q.Y) * s.Z;
+	m[9] = (2 * q.Y * q.Z - 2 * q.W * q.X) * s.Z;
+	m[10] = (1 - 2 * q.X * q.X - 2 * q.Y * q.Y) * s.Z;
+	m[11] = 0;
+	m[12] = bone.translation.X;
+	m[13] = bone.translation.Y;
+	m[14] = bone.translation.Z;
+	m[15] = 1;
+}
+
+// res = a * b, column major like VSMatrix. res may not alias the inputs.
+static void MultBoneMatrix(const FLOATTYPE *a, const FLOATTYPE *b, FLOATTYPE *res)
+{
+#ifdef IQM_SSE2
+	__m128 a0 = _mm_loadu_ps(a);
+	__m128 a1 = _mm_loadu_ps(a + 4);
+	__m128 a2 = _mm_loadu_ps(a + 8);
+	__m128 a3 = _mm_loadu_ps(a + 12);
+	for (int j = 0; j < 16; j += 4)
+	{
+		__m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[j]));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[j + 1])));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[j + 2])));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[j + 3])));
+		_mm_storeu_ps(res + j, r);
+	}
+#else
+	for (int j = 0; j < 16; j += 4)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			res[j + i] = a[i] * b[j] + a[4 + i] * b[j + 1] + a[8 + i] * b[j + 2] + a[12 + i] * b[j + 3];
+		}
+	}
+#endif
+}
+
+//===========================================================================
+//
+// Poses the skeleton for one model of an actor.
+//
+// The result is written straight into the actor's bone cache, which also
+// keeps the matrices of bones that did not move since the last frame, so
+// once the cache has been sized this does not allocate anything.
+//
+//===========================================================================
+
+const TArray<VSMatrix>& IQMModel::CalculateBones(int frame1, int frame2, float inter, int frame1_prev, float inter1_prev, int frame2_prev, float inter2_prev, const TArray<TRS>* animationData, DBoneComponents* boneComponentData, int index)
 {
 	const TArray<TRS>& animationFrames = animationData ? *animationData : TRSData;
 	if (Joints.Size() > 0)
 	{
 		int numbones = Joints.SSize();
 
-		if (boneComponentData->trscomponents[index].SSize() != numbones)
-			boneComponentData->trscomponents[index].Resize(numbones);
-		if (boneComponentData->trsmatrix[index].SSize() != numbones)
-			boneComponentData->trsmatrix[index].Resize(numbones);
+		auto& components = boneComponentData->trscomponents[index];
+		auto& bones = boneComponentData->trsmatrix[index];
+		if (components.SSize() != numbones)
+			components.Resize(numbones);
+		if (bones.SSize() != numbones)
+			bones.Resize(numbones);
 
 		frame1 = clamp(frame1, 0, (animationFrames.SSize() - 1) / numbones);
 		frame2 = clamp(frame2, 0, (animationFrames.SSize() - 1) / numbones);
@@ -585,14 +688,8 @@ const TArray<VSMatrix> IQMModel::CalculateBones(int frame1, int frame2, float in
 		float invt1 = 1.0f - inter1_prev;
 		float invt2 = 1.0f - inter2_prev;
 
-		float swapYZ[16] = { 0.0f };
-		swapYZ[0 + 0 * 4] = 1.0f;
-		swapYZ[1 + 2 * 4] = 1.0f;
-		swapYZ[2 + 1 * 4] = 1.0f;
-		swapYZ[3 + 3 * 4] = 1.0f;
-
-		TArray<VSMatrix> bones(numbones, true);
-		TArray<bool> modifiedBone(numbones, true);
+		static thread_local TArray<bool> modifiedBone;
+		modifiedBone.Resize(numbones);
 		for (int i = 0; i < numbones; i++)
 		{
 			TRS prev;
@@ -616,50 +713,40 @@ const TArray<VSMatrix> IQMModel::CalculateBones(int frame1, int frame2, float in
 				bone = inter < 0 ? animationFrames[offset1 + i] : InterpolateBone(prev, next , inter, invt);
 			}
 
-			if (Joints[i].Parent >= 0 && modifiedBone[Joints[i].Parent])
+			int parent = Joints[i].Parent;
+			if (parent >= 0 && modifiedBone[parent])
 			{
-				boneComponentData->trscomponents[index][i] = bone;
+				components[i] = bone;
 				modifiedBone[i] = true;
 			}
-			else if (boneComponentData->trscomponents[index][i].Equals(bone))
+			else if (components[i].Equals(bone))
 			{
-				bones[i] = boneComponentData->trsmatrix[index][i];
+				// the cached matrix is still valid.
 				modifiedBone[i] = false;
 				continue;
 			}
 			else
 			{
-				boneComponentData->trscomponents[index][i] = bone;
+				components[i] = bone;
 				modifiedBone[i] = true;
 			}
 
-			VSMatrix m;
-			m.loadIdentity();
-			m.translate(bone.translation.X, bone.translation.Y, bone.translation.Z);
-			m.multQuaternion(bone.rotation);
-			m.scale(bone.scaling.X, bone.scaling.Y, bone.scaling.Z);
-
-			VSMatrix& result = bones[i];
-			if (Joints[i].Parent >= 0)
+			FLOATTYPE m[16], tmp[16], result[16];
+			ComposeBone(bone, m);
+			if (parent >= 0)
 			{
-				result = bones[Joints[i].Parent];
-				result.multMatrix(swapYZ);
-				result.multMatrix(baseframe[Joints[i].Parent]);
-				result.multMatrix(m);
-				result.multMatrix(inversebaseframe[i]);
+				MultBoneMatrix(bones[parent].get(), JointPre[i].get(), tmp);
+				MultBoneMatrix(tmp, m, result);
 			}
 			else
 			{
-				result.loadMatrix(swapYZ);
-				result.multMatrix(m);
-				result.multMatrix(inversebaseframe[i]);
+				MultBoneMatrix(JointPre[i].get(), m, result);
 			}
-			result.multMatrix(swapYZ);
+			MultBoneMatrix(result, JointPost[i].get(), tmp);
+			bones[i].loadMatrix(tmp);
 		}
 
-		boneComponentData->trsmatrix[index] = bones;
-
 		return bones;
 	}
-	return {};
+	return FModel::CalculateBones(frame1, frame2, inter, frame1_prev, inter1_prev, frame2_prev, inter2_prev, animationData, boneComponentData, index);
 }
@@ -63,6 +63,8 @@
 #include "stats.h"
 #include "printf.h"
 #include "cmdlib.h"
+#include "c_cvars.h"
+#include "i_time.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -96,6 +98,10 @@
 // Sweeps traverse objects in chunks of this size
 #define GCSWEEPGRANULARITY	40
 
+// Number of single steps between clock checks when running on a time budget.
+// Most steps only cover one object, which is too little work to time by itself.
+#define GCTIMEBATCH			16
+
 // Cost of deleting an object
 #ifndef _DEBUG
 #define GCDELETECOST		75
@@ -125,6 +131,20 @@ public:
 	size_t GetAverage();
 };
 
+// Distribution of the time spent per collection step.
+struct FPauseHistogram
+{
+	static inline constexpr int NumBuckets = 7;
+	static inline const double Limits[NumBuckets - 1] = { 0.1, 0.25, 0.5, 1, 2, 4 };
+
+	int Count[NumBuckets];
+	double Longest;
+
+	void Add(double ms);
+	void Format(FString &out);
+	void Reset();
+};
+
 struct FStepStats
 {
 	cycle_t Clock[GC::GCS_COUNT];
@@ -135,6 +155,19 @@ struct FStepStats
 	void Reset();
 };
 
+// How the work of one cycle splits between objects that were created during
+// it and objects that had already survived a collection. Statistics only,
+// the collector treats both alike.
+struct FGenStats
+{
+	size_t MarkedBytes[2];		// [young, old]
+	int Freed[2];
+	int Promoted;
+
+	void Format(FString &out);
+	void Reset();
+};
+
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 
 // PUBLIC FUNCTION PROTOTYPES ----------------------------------------------
@@ -165,6 +198,8 @@ int Pause = DEFAULT_GCPAUSE;
 int StepMul = DEFAULT_GCMUL;
 FStepStats StepStats;
 FStepStats PrevStepStats;
+FGenStats GenStats;
+FGenStats PrevGenStats;
 bool FinalGC;
 bool HadToDestroy;
 
@@ -172,6 +207,8 @@ bool HadToDestroy;
 
 static FAveragizer AllocHistory;// Tracks allocation rate over time
 static cycle_t GCTime;			// Track time spent in GC
+static FPauseHistogram Pauses;	// Time spent per step
+static uint64_t StepCost[GCS_COUNT];	// Measured ns per single step, by state
 
 // CODE --------------------------------------------------------------------
 
@@ -222,8 +259,10 @@ size_t PropagateMark()
 	assert(obj->IsGray());
 	obj->Gray2Black();
 	Gray = obj->GCNext;
-	return !(obj->ObjectFlags & OF_EuthanizeMe) ? obj->PropagateMark() :
+	size_t size = !(obj->ObjectFlags & OF_EuthanizeMe) ? obj->PropagateMark() :
 		obj->GetClass()->Size;
+	GenStats.MarkedBytes[!(obj->ObjectFlags & OF_Young)] += size;
+	return size;
 }
 
 //==========================================================================
@@ -248,6 +287,11 @@ static size_t SweepObjects(size_t count)
 		{
 			assert(!curr->IsDead() || (curr->ObjectFlags & OF_Fixed));
 			curr->MakeWhite();	// make it white (for next cycle)
+			if (curr->ObjectFlags & OF_Young)
+			{
+				curr->ObjectFlags &= ~OF_Young;
+				GenStats.Promoted++;
+			}
 			SweepPos = &curr->ObjNext;
 		}
 		else
@@ -262,6 +306,7 @@ static size_t SweepObjects(size_t count)
 			else
 			{	// must erase 'curr'
 				*SweepPos = curr->ObjNext;
+				GenStats.Freed[!(curr->ObjectFlags & OF_Young)]++;
 				curr->ObjectFlags |= OF_Cleanup;
 				delete curr;
 				swept += GCDELETECOST;
@@ -384,6 +429,8 @@ static void MarkRoot()
 {
 	PrevStepStats = StepStats;
 	StepStats.Reset();
+	PrevGenStats = GenStats;
+	GenStats.Reset();
 
 	Gray = nullptr;
 
@@ -502,27 +549,39 @@ static size_t SingleStep()
 
 //==========================================================================
 //
-// Step
+// RunSteps
 //
-// Performs enough single steps to cover <StepSize> bytes of memory.
+// Performs single steps until <lim> bytes of memory have been covered.
 // Some of those bytes might be "fake" to account for the cost of freeing
 // or destroying object.
 //
+// With a time budget this also stops once the measured cost of the next
+// batch of steps would not fit anymore. Idle steps are not limited by
+// size and only cover the mark and sweep phases, because destroying
+// objects runs script code, which must not happen in the middle of
+// presenting a frame.
+//
 //==========================================================================
 
-void Step()
+static void RunSteps(size_t lim, double budget, bool idle)
 {
-	GCTime.ResetAndClock();
+	uint64_t start = I_nsTime();
+	uint64_t deadline = budget > 0 ? start + uint64_t(budget * 1'000'000) : 0;
+	uint64_t batchstart = start;
+	int batch = 0;
 
 	auto enter_state = State;
 	StepStats.Count[enter_state]++;
 	StepStats.Clock[enter_state].Clock();
 
 	size_t did = 0;
-	size_t lim = CalcStepSize();
 
 	do
 	{
+		if (idle && State != GCS_Propagate && State != GCS_Sweep)
+		{
+			break;
+		}
 		size_t done = SingleStep();
 		did += done;
 		if (done < lim)
@@ -544,14 +603,75 @@ void Step()
 			enter_state = State;
 			StepStats.Clock[enter_state].Clock();
 			StepStats.Count[enter_state]++;
+			batch = 0;
+			batchstart = I_nsTime();
 		}
-	} while (lim && State != GCS_Pause);
+		else if (deadline != 0 && ++batch == GCTIMEBATCH)
+		{
+			uint64_t now = I_nsTime();
+			uint64_t cost = (now - batchstart) / GCTIMEBATCH;
+			StepCost[State] = StepCost[State] == 0 ? cost : (StepCost[State] * 3 + cost) / 4;
+			if (now + StepCost[State] * GCTIMEBATCH > deadline)
+			{
+				break;
+			}
+			batch = 0;
+			batchstart = now;
+		}
+	} while ((lim || idle) && State != GCS_Pause);
 
 	StepStats.Clock[enter_state].Unclock();
 	StepStats.BytesCovered[enter_state] += did;
+	Pauses.Add((I_nsTime() - start) * 1e-6);
+}
+
+//==========================================================================
+//
+// Step
+//
+// Performs one collection step, sized by the allocation rate or, when
+// gc_budget is set, by time.
+//
+//==========================================================================
+
+CUSTOM_CVAR(Float, gc_budget, 0.f, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+}
+
+CVAR(Bool, gc_idlesteps, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+void Step()
+{
+	GCTime.ResetAndClock();
+
+	// If the collector is falling too far behind the allocations, memory use would
+	// run away, so the budget gets ignored until it has caught up again.
+	double budget = gc_budget;
+	if (AllocBytes >= Threshold * 2) budget = 0;
+
+	RunSteps(CalcStepSize(), budget, false);
 	GCTime.Unclock();
 }
 
+//==========================================================================
+//
+// StepIdle
+//
+// Continues a running collection for up to <ms> milliseconds. This is for
+// time the frame would otherwise spend waiting.
+//
+//==========================================================================
+
+void StepIdle(double ms)
+{
+	if (!gc_idlesteps || ms <= 0 || (State != GCS_Propagate && State != GCS_Sweep))
+	{
+		return;
+	}
+	RunSteps(0, ms, true);
+}
+
 //==========================================================================
 //
 // FullGC
@@ -779,6 +899,10 @@ ADD_STAT(gc)
 	GC::PrevStepStats.Format(out);
 	out << "\n";
 	GC::StepStats.Format(out);
+	out << "\n";
+	GC::Pauses.Format(out);
+	out << "\n";
+	GC::PrevGenStats.Format(out);
 	out.AppendFormat("\n%.2fms [%s] Rate:%3zuK (%3zuK)  Alloc:%6zuK  Est:%6zuK  Thresh:%6zuK",
 		time,
 		StateStrings[GC::State],
@@ -790,6 +914,37 @@ ADD_STAT(gc)
 	return out;
 }
 
+//==========================================================================
+//
+// FPauseHistogram
+//
+//==========================================================================
+
+void FPauseHistogram::Add(double ms)
+{
+	int i = 0;
+	while (i < NumBuckets - 1 && ms >= Limits[i]) i++;
+	Count[i]++;
+	Longest = max(Longest, ms);
+}
+
+void FPauseHistogram::Reset()
+{
+	for (auto &c : Count) c = 0;
+	Longest = 0;
+}
+
+void FPauseHistogram::Format(FString &out)
+{
+	out << "Steps:";
+	for (int i = 0; i < NumBuckets; ++i)
+	{
+		if (i < NumBuckets - 1) out.AppendFormat(" <%gms:%d", Limits[i], Count[i]);
+		else out.AppendFormat(" >=%gms:%d", Limits[i - 1], Count[i]);
+	}
+	out.AppendFormat("  Longest:%.2fms", Longest);
+}
+
 //==========================================================================
 //
 // FStepStats :: Reset
@@ -830,6 +985,36 @@ void FStepStats::Format(FString &out)
 	out << TEXTCOLOR_GREEN;
 }
 
+//==========================================================================
+//
+// FGenStats
+//
+// Young objects are the ones created since the previous sweep. Those that
+// are still alive when the sweep reaches them get promoted.
+//
+// This is bookkeeping only. There is no nursery and no minor collection,
+// every cycle still marks and sweeps all objects. The write barriers do not
+// know the object being written to, so a remembered set of old objects
+// pointing at young ones cannot be kept.
+//
+//==========================================================================
+
+void FGenStats::Reset()
+{
+	MarkedBytes[0] = MarkedBytes[1] = 0;
+	Freed[0] = Freed[1] = 0;
+	Promoted = 0;
+}
+
+void FGenStats::Format(FString &out)
+{
+	size_t marked = MarkedBytes[0] + MarkedBytes[1];
+	int freed = Freed[0] + Freed[1];
+	out.AppendFormat("Young: marked %zuK (%d%%)  freed %d (%d%%)  promoted %d",
+		(MarkedBytes[0] + 1023) >> 10, marked != 0 ? int(MarkedBytes[0] * 100 / marked) : 0,
+		Freed[0], freed != 0 ? Freed[0] * 100 / freed : 0, Promoted);
+}
+
 //==========================================================================
 //
 // CCMD gc
@@ -842,7 +1027,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]|resetsteps\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -874,6 +1059,10 @@ CCMD(gc)
 			GC::Pause = max(1,atoi(argv[2]));
 		}
 	}
+	else if (stricmp(argv[1], "resetsteps") == 0)
+	{
+		GC::Pauses.Reset();
+	}
 	else if (stricmp(argv[1], "stepmul") == 0)
 	{
 		if (argv.argc() == 2)
@@ -27,6 +27,7 @@ enum EObjectFlags
 	OF_Spawned			= 1 << 12,      // Thinker was spawned at all (some thinkers get deleted before spawning)
 	OF_Released			= 1 << 13,		// Object was released from the GC system and should not be processed by GC function
 	OF_Networked		= 1 << 14,		// Object has a unique network identifier that makes it synchronizable between all clients.
+	OF_Young			= 1 << 15,		// Object has not survived a collection yet (only used for statistics)
 };
 
 template<class T> class TObjPtr;
@@ -89,6 +90,9 @@ namespace GC
 	// Does one collection step.
 	void Step();
 
+	// Continues a running collection for at most the given time.
+	void StepIdle(double ms);
+
 	// Does a complete collection.
 	void FullGC();
 
@@ -55,6 +55,8 @@ int vertexcount, flatvertices, flatprimitives;
 
 int rendered_lines,rendered_flats,rendered_sprites,render_vertexsplit,render_texsplit,rendered_decals, rendered_portals, rendered_commandbuffers;
 int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
+std::atomic<int> cached_dlight;
+int occluded_subsectors, occluded_things, rendered_occluders;
 
 void ResetProfilingData()
 {
@@ -78,6 +80,7 @@ void ResetProfilingData()
 
 	flatvertices=flatprimitives=vertexcount=0;
 	render_texsplit=render_vertexsplit=rendered_lines=rendered_flats=rendered_sprites=rendered_decals=rendered_portals = 0;
+	occluded_subsectors=occluded_things=rendered_occluders = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -117,12 +120,17 @@ static void AppendRenderStats(FString &out)
 		"Flats: %d (%d primitives, %d vertices)\n"
 		"Sprites: %d, Decals=%d, Portals: %d, Command buffers: %d\n",
 		rendered_lines, render_vertexsplit, render_texsplit, vertexcount, rendered_flats, flatprimitives, flatvertices, rendered_sprites,rendered_decals, rendered_portals, rendered_commandbuffers );
+	if (rendered_occluders > 0)
+	{
+		out.AppendFormat("Occlusion: %d occluders, %d subsectors culled, %d things culled\n",
+			rendered_occluders, occluded_subsectors, occluded_things);
+	}
 }
 
 static void AppendLightStats(FString &out)
 {
-	out.AppendFormat("DLight - Walls: %d processed, %d rendered - Flats: %d processed, %d rendered\n", 
-		iter_dlight, draw_dlight, iter_dlightf, draw_dlightf );
+	out.AppendFormat("DLight - Walls: %d processed, %d rendered - Flats: %d processed, %d rendered - %d reused\n", 
+		iter_dlight, draw_dlight, iter_dlightf, draw_dlightf, cached_dlight.load() );
 }
 
 ADD_STAT(rendertimes)
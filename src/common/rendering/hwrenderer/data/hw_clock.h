@@ -1,6 +1,7 @@
 #ifndef __GL_CLOCK_H
 #define __GL_CLOCK_H
 
+#include <atomic>
 #include "stats.h"
 #include "m_fixed.h"
 
@@ -15,8 +16,10 @@ extern glcycle_t drawcalls, twoD, Flush3D;
 extern glcycle_t MTWait, WTTotal;
 
 extern int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
+extern std::atomic<int> cached_dlight;	// also counted by the BSP worker thread
 extern int rendered_lines,rendered_flats,rendered_sprites,rendered_decals,render_vertexsplit,render_texsplit;
 extern int rendered_portals;
+extern int occluded_subsectors, occluded_things, rendered_occluders;
 
 extern int vertexcount, flatvertices, flatprimitives;
 
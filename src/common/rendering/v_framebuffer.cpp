@@ -52,6 +52,7 @@
 #include "hw_material.h"
 #include "a_sharedglobal.h"
 #include "menustate.h"
+#include "dobject.h"
 
 #include <chrono>
 #include <thread>
@@ -275,6 +276,14 @@ void DFrameBuffer::FPSLimit()
 
 	uint64_t targetWakeTime = fpsLimitTime + 1'000'000 / maxfps;
 
+	// Time that would otherwise be slept away is good for garbage collection.
+	// Leave some margin, since the wakeup needs to happen on time.
+	int64_t idleTime = int64_t(targetWakeTime - duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count()) - 2'000;
+	if (idleTime > 0 && idleTime < 1'000'000)
+	{
+		GC::StepIdle(idleTime / 1000.);
+	}
+
 	while (true)
 	{
 		fpsLimitTime = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
@@ -133,8 +133,21 @@ const float png_gamma = 0;
 //
 //==========================================================================
 
+static bool CreatePNG (FileWriter *file, const uint8_t *buffer, const PalEntry *palette,
+				  ESSType color_type, int width, int height, int pitch, float gamma);
+
 bool M_CreatePNG (FileWriter *file, const uint8_t *buffer, const PalEntry *palette,
 				  ESSType color_type, int width, int height, int pitch, float gamma)
+{
+	if (auto deferred = dynamic_cast<FDeferredPNGWriter *>(file))
+	{
+		return deferred->SetImage(buffer, palette, color_type, width, height, pitch, gamma);
+	}
+	return CreatePNG(file, buffer, palette, color_type, width, height, pitch, gamma);
+}
+
+static bool CreatePNG (FileWriter *file, const uint8_t *buffer, const PalEntry *palette,
+				  ESSType color_type, int width, int height, int pitch, float gamma)
 {
 	uint8_t work[8 +				// signature
 			  12+2*4+5 +		// IHDR
@@ -179,6 +192,45 @@ bool M_CreatePNG (FileWriter *file, const uint8_t *buffer, const PalEntry *palet
 	return M_SaveBitmap (buffer, color_type, width, height, pitch, file);
 }
 
+//==========================================================================
+//
+// FDeferredPNGWriter
+//
+// Copies the image so that the source buffer can be released right away.
+//
+//==========================================================================
+
+bool FDeferredPNGWriter::SetImage(const uint8_t *buffer, const PalEntry *palette,
+	ESSType color_type, int width, int height, int pitch, float gamma)
+{
+	int bytesPerRow = width * (color_type == SS_PAL ? 1 : color_type == SS_RGB ? 3 : 4);
+
+	Pixels.Resize(bytesPerRow * height);
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(&Pixels[y * bytesPerRow], buffer + (ptrdiff_t)y * pitch, bytesPerRow);
+	}
+	if (color_type == SS_PAL)
+	{
+		memcpy(Palette, palette, sizeof(Palette));
+	}
+	ColorType = color_type;
+	Width = width;
+	Height = height;
+	Gamma = gamma;
+	return true;
+}
+
+bool FDeferredPNGWriter::Encode()
+{
+	if (Width == 0 || Height == 0) return true;	// nothing was deferred, e.g. for a dummy PNG.
+	int bytesPerRow = Pixels.Size() / Height;
+	bool res = CreatePNG(this, Pixels.Data(), Palette, ColorType, Width, Height, bytesPerRow, Gamma);
+	Pixels.Reset();
+	Width = Height = 0;
+	return res;
+}
+
 //==========================================================================
 //
 // M_CreateDummyPNG
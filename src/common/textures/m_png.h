@@ -35,6 +35,7 @@
 
 #include <stdio.h>
 #include "zstring.h"
+#include "tarray.h"
 #include "files.h"
 #include "palentry.h"
 
@@ -69,6 +70,24 @@ bool M_FinishPNG (FileWriter *file);
 
 bool M_SaveBitmap(const uint8_t *from, ESSType color_type, int width, int height, int pitch, FileWriter *file);
 
+// A PNG writer that only stores the image passed to M_CreatePNG, so that the
+// compression can be done later by calling Encode, e.g. on a worker thread.
+// Any chunks must only be appended after the image was encoded.
+class FDeferredPNGWriter : public BufferWriter
+{
+public:
+	bool SetImage(const uint8_t *buffer, const PalEntry *pal, ESSType color_type, int width, int height, int pitch, float gamma);
+	bool Encode();
+
+private:
+	TArray<uint8_t> Pixels;
+	PalEntry Palette[256];
+	ESSType ColorType = SS_RGB;
+	int Width = 0;
+	int Height = 0;
+	float Gamma = 0;
+};
+
 // PNG Reading --------------------------------------------------------------
 
 struct PNGHandle
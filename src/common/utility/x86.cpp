@@ -159,6 +159,27 @@ void CheckCPUID(CPUInfo *cpu)
 		__cpuidex(foo, 7, 1);
 		cpu->FeatureFlags[7] = foo[0];
 	}
+
+	// AVX can only be used if the OS saves the YMM registers on context switches.
+	// Clear the flags if it doesn't so that code checking them does not crash.
+	bool osavx = false;
+	if (cpu->bOSXSAVE)
+	{
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int xcr0lo, xcr0hi;
+		__asm__ __volatile__("xgetbv" : "=a" (xcr0lo), "=d" (xcr0hi) : "c" (0));
+		unsigned long long xcr0 = xcr0lo | ((unsigned long long)xcr0hi << 32);
+#endif
+		osavx = (xcr0 & 6) == 6;
+	}
+	if (!osavx)
+	{
+		cpu->bAVX = false;
+		cpu->bFMA3 = false;
+		cpu->bAVX2 = false;
+	}
 }
 
 FString DumpCPUInfo(const CPUInfo *cpu, bool brief)
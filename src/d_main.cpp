@@ -98,6 +98,7 @@
 #include "types.h"
 #include "i_system.h"
 #include "g_cvars.h"
+#include "g_precache.h"
 #include "r_data/r_vanillatrans.h"
 #include "s_music.h"
 #include "swrenderer/r_swcolormaps.h"
@@ -122,6 +123,7 @@
 #include "fs_findfile.h"
 
 #include "statdb.h"
+#include "startupgraph.h"
 
 
 #ifdef __unix__
@@ -3291,6 +3293,83 @@ static int FileSystemPrintf(FSMessageLevel level, const char* fmt, ...)
 	}
 	return (int)text.Len();
 }
+
+//==========================================================================
+//
+// Reads through the loaded archives while the main thread is busy parsing
+// them, so that most of the later lump reads are served from the OS file
+// cache instead of waiting on the disk. This uses its own file handles and
+// touches nothing else, so it is safe to run on a startup worker.
+//
+// Off by default: on a cold hard disk it competes with the main thread for
+// the same files, and no gain in time to menu has been measured yet.
+//
+//==========================================================================
+
+CUSTOM_CVAR(Int, startup_prefetchmb, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+}
+
+static void PrefetchArchives(const std::vector<std::string>& archives, int64_t budget, const FStartupGraph& graph)
+{
+	TArray<uint8_t> buffer(1024 * 1024, true);
+	for (auto& name : archives)
+	{
+		FileReader fr;
+		if (budget <= 0 || graph.Aborted()) break;
+		if (!fr.OpenFile(name.c_str())) continue;	// directories get read lump by lump anyway.
+
+		while (budget > 0 && !graph.Aborted())
+		{
+			auto len = fr.Read(buffer.Data(), buffer.Size());
+			if (len <= 0) break;
+			budget -= len;
+		}
+	}
+}
+
+//==========================================================================
+//
+// Reads the definition lumps the later startup stages parse, while the main
+// thread is still setting up the palette, sound, strings and textures. Only
+// lumps none of those stages read are picked, so no entry gets read by both
+// threads at once. Reading off the main thread never stores the skipped zip
+// headers and gets its own file handles, so this only needs the file system's
+// lookups, which do not change anymore after the FileSystem stage.
+//
+//==========================================================================
+
+static void PreloadDefinitionLumps(TMap<int, FString>& preloaded, const char* mapinfo, const FStartupGraph& graph)
+{
+	static const char* lumpnames[] = {
+		"MAPINFO", "ZMAPINFO", "UMAPINFO", "GLDEFS", "DOOMDEFS", "HTICDEFS", "HEXNDEFS", "STRFDEFS",
+		"FONTDEFS", "SNDINFO", "SNDSEQ", "DECALDEF", "ANIMDEFS", "TERRAIN", nullptr
+	};
+	TArray<int> lumps;
+	int lastlump = 0, lump;
+	while ((lump = fileSystem.FindLumpMulti(lumpnames, &lastlump)) != -1) lumps.Push(lump);
+	if (mapinfo != nullptr && *mapinfo != 0)
+	{
+		lump = fileSystem.CheckNumForFullName(mapinfo, true);
+		if (lump >= 0) lumps.Push(lump);
+	}
+
+	for (int lump : lumps)
+	{
+		if (graph.Aborted()) break;
+		try
+		{
+			auto data = fileSystem.ReadFile(lump);
+			preloaded.Insert(lump, FString(data.string(), data.size()));
+		}
+		catch (const std::exception&)
+		{
+			// The parser reads it again on the main thread and reports the error there.
+		}
+	}
+}
+
 //==========================================================================
 //
 // D_InitGame
@@ -3404,283 +3483,375 @@ static int D_InitGame(const FIWADInfo* iwad_info, std::vector<std::string>& allw
 
 	AddModFiles(allwads);
 
-	bool allowduplicates = Args->CheckParm("-allowduplicates");
-	auto hashfile = D_GetHashFile();
-	if (!fileSystem.InitMultipleFiles(allwads, &lfi, FileSystemPrintf, allowduplicates, hashfile))
-	{
-		I_FatalError("FileSystem: no files found");
-	}
-	allwads.clear();
-	allwads.shrink_to_fit();
-	SetMapxxFlag();
+	// The stages below only run concurrently where that is known to be safe.
+	// Everything that touches shared engine state stays on the main thread
+	// in its original order, the dependencies document why it is there.
+	FStartupGraph startup;
+	std::vector<std::string> archives;
+	int64_t prefetchbudget = int64_t(*startup_prefetchmb) << 20;
+	int max_progress = 0;
 
-	D_GrabCVarDefaults(); //parse DEFCVARS
-	InitPalette();
+	startup.AddTask("FileSystem", {}, [&]()
+	{
+		bool allowduplicates = Args->CheckParm("-allowduplicates");
+		auto hashfile = D_GetHashFile();
+		fileSystem.SetMapFiles(!Args->CheckParm("-nommap"));
+		if (!fileSystem.InitMultipleFiles(allwads, &lfi, FileSystemPrintf, allowduplicates, hashfile))
+		{
+			I_FatalError("FileSystem: no files found");
+		}
+		allwads.clear();
+		allwads.shrink_to_fit();
+		SetMapxxFlag();
 
-	CLOCK_START
-	if (!batchrun) Printf("S_Init: Setting up sound.\n");
-	S_Init();
-	CLOCK_END("Sound Startup")
-	
-	bool writeCache = Args->CheckParm("-writetexturecache");
-	int max_progress = TexMan.GuesstimateNumTextures();
-	if (writeCache) max_progress *= 2;	// If we are writing textures, we need to double the estimated time so we get actual progress
-	int per_shader_progress = 0;//screen->GetShaderCount()? (max_progress / 10 / screen->GetShaderCount()) : 0;
-	bool nostartscreen = batchrun || restart || Args->CheckParm("-join") || Args->CheckParm("-host") || Args->CheckParm("-norun");
+		for (int i = 0; i < fileSystem.GetNumWads(); i++)
+		{
+			archives.push_back(fileSystem.GetResourceFileFullName(i));
+		}
+	});
 
-	if (GameStartupInfo.Type == FStartupInfo::DefaultStartup)
+	// Only uses its own file handles, so this can overlap with everything that follows.
+	if (prefetchbudget > 0)
 	{
-		if (gameinfo.gametype == GAME_Hexen)
-			GameStartupInfo.Type = FStartupInfo::HexenStartup;
-		else if (gameinfo.gametype == GAME_Heretic)
-			GameStartupInfo.Type = FStartupInfo::HereticStartup;
-		else if (gameinfo.gametype == GAME_Strife)
-			GameStartupInfo.Type = FStartupInfo::StrifeStartup;
+		startup.AddWorkerTask("PrefetchArchives", { "FileSystem" }, [&]()
+		{
+			PrefetchArchives(archives, prefetchbudget, startup);
+		});
 	}
 
-	StartScreen = nostartscreen? nullptr : GetGameStartScreen(per_shader_progress > 0 ? max_progress * 10 / 9 : max_progress + 3);
-	
-	GameConfig->DoKeySetup(gameinfo.ConfigName.GetChars());
+	// Joined before the first stage that parses one of these lumps.
+	TMap<int, FString> preloaded;
+	startup.AddWorkerTask("PreloadDefinitions", { "FileSystem" }, [&]()
+	{
+		PreloadDefinitionLumps(preloaded, iwad_info->MapInfo.GetChars(), startup);
+	});
 
-	// Now that wads are loaded, define mod-specific cvars.
-	ParseCVarInfo();
+	startup.AddTask("Palette", { "FileSystem" }, [&]()
+	{
+		D_GrabCVarDefaults(); //parse DEFCVARS
+		InitPalette();
+	});
 
-	// Actually exec command line commands and exec files.
-	if (exec != NULL)
+	startup.AddTask("Sound", { "FileSystem" }, [&]()
 	{
-		exec->ExecCommands();
-		delete exec;
-		exec = NULL;
-	}
+		CLOCK_START
+		if (!batchrun) Printf("S_Init: Setting up sound.\n");
+		S_Init();
+		CLOCK_END("Sound Startup")
+	});
 
-	// @Cockatrice - Hack for Steam Deck, check for existence of g_steamdeck and set graphics quality
-	auto cv = FindCVar("g_steamdeck", nullptr);
-	if (cv != nullptr && cv->ToInt() == 1)
+	startup.AddTask("GameSetup", { "Palette" }, [&]()
 	{
-		Printf(TEXTCOLOR_BRICK"Steam Deck Detected\n");
+		bool writeCache = Args->CheckParm("-writetexturecache");
+		max_progress = TexMan.GuesstimateNumTextures();
+		if (writeCache) max_progress *= 2;	// If we are writing textures, we need to double the estimated time so we get actual progress
+		int per_shader_progress = 0;//screen->GetShaderCount()? (max_progress / 10 / screen->GetShaderCount()) : 0;
+		bool nostartscreen = batchrun || restart || Args->CheckParm("-join") || Args->CheckParm("-host") || Args->CheckParm("-norun");
 
-		// Set texture quality
-		gl_texture_quality = max((int)gl_texture_quality, 1);
+		if (GameStartupInfo.Type == FStartupInfo::DefaultStartup)
+		{
+			if (gameinfo.gametype == GAME_Hexen)
+				GameStartupInfo.Type = FStartupInfo::HexenStartup;
+			else if (gameinfo.gametype == GAME_Heretic)
+				GameStartupInfo.Type = FStartupInfo::HereticStartup;
+			else if (gameinfo.gametype == GAME_Strife)
+				GameStartupInfo.Type = FStartupInfo::StrifeStartup;
+		}
 
-		// @Cockatrice - Force texture thread limit of 1, as an emergency hotfix for stutter issues on Steam Deck
-		// TODO: Remove this, it's a hack. Figure out why the stutters are happening!
-		vk_max_transfer_threads = min(1, (int)vk_max_transfer_threads);
-	}
+		StartScreen = nostartscreen? nullptr : GetGameStartScreen(per_shader_progress > 0 ? max_progress * 10 / 9 : max_progress + 3);
 
-	if (!restart)
-		V_Init2();
+		GameConfig->DoKeySetup(gameinfo.ConfigName.GetChars());
 
-	CLOCK_START
-	// [RH] Initialize localizable strings. 
-	GStrings.LoadStrings(fileSystem, language);
-	CLOCK_END("Loaded Strings")
+		// Now that wads are loaded, define mod-specific cvars.
+		ParseCVarInfo();
 
-	V_InitFontColors ();
+		// Actually exec command line commands and exec files.
+		if (exec != NULL)
+		{
+			exec->ExecCommands();
+			delete exec;
+			exec = NULL;
+		}
 
-	// [RH] Moved these up here so that we can do most of our
-	//		startup output in a fullscreen console.
+		// @Cockatrice - Hack for Steam Deck, check for existence of g_steamdeck and set graphics quality
+		auto cv = FindCVar("g_steamdeck", nullptr);
+		if (cv != nullptr && cv->ToInt() == 1)
+		{
+			Printf(TEXTCOLOR_BRICK"Steam Deck Detected\n");
 
-	CT_Init ();
+			// Set texture quality
+			gl_texture_quality = max((int)gl_texture_quality, 1);
 
-	if (!restart)
-	{
-		if (!batchrun) Printf ("I_Init: Setting up machine state.\n");
-		CheckCPUID(&CPU);
-		CalculateCPUSpeed();
-		auto ci = DumpCPUInfo(&CPU);
-		Printf("%s", ci.GetChars());
-	}
+			// @Cockatrice - Force texture thread limit of 1, as an emergency hotfix for stutter issues on Steam Deck
+			// TODO: Remove this, it's a hack. Figure out why the stutters are happening!
+			vk_max_transfer_threads = min(1, (int)vk_max_transfer_threads);
+		}
 
+		if (!restart)
+			V_Init2();
+	});
 
-	TexMan.Init();
-	
-	if (!batchrun) Printf ("V_Init: allocate screen.\n");
-	if (!restart)
-	{
-		screen->CompileNextShader();
-		if (StartScreen != nullptr) StartScreen->Render();
-	}
-	else
+	startup.AddTask("Strings", { "GameSetup" }, [&]()
 	{
-		// Update screen palette when restarting
-		screen->UpdatePalette();
-	}
+		CLOCK_START
+		// [RH] Initialize localizable strings. 
+		GStrings.LoadStrings(fileSystem, language);
+		CLOCK_END("Loaded Strings")
 
-	// Base systems have been inited; enable cvar callbacks
-	FBaseCVar::EnableCallbacks ();
-	
-	// +compatmode cannot be used on the command line, so use this as a substitute
-	auto compatmodeval = Args->CheckValue("-compatmode");
-	if (compatmodeval)
-	{
-		compatmode = (int)strtoll(compatmodeval, nullptr, 10);
-	}
+		V_InitFontColors ();
 
-	if (!batchrun) Printf ("ST_Init: Init startup screen.\n");
-	if (!restart)
+		// [RH] Moved these up here so that we can do most of our
+		//		startup output in a fullscreen console.
+
+		CT_Init ();
+
+		if (!restart)
+		{
+			if (!batchrun) Printf ("I_Init: Setting up machine state.\n");
+			CheckCPUID(&CPU);
+			CalculateCPUSpeed();
+			auto ci = DumpCPUInfo(&CPU);
+			Printf("%s", ci.GetChars());
+		}
+	});
+
+	startup.AddTask("TexMan", { "Strings" }, [&]()
 	{
-		StartWindow = FStartupScreen::CreateInstance (TexMan.GuesstimateNumTextures() + 5);
-	}
-	else
+		TexMan.Init();
+
+		if (!batchrun) Printf ("V_Init: allocate screen.\n");
+		if (!restart)
+		{
+			screen->CompileNextShader();
+			if (StartScreen != nullptr) StartScreen->Render();
+		}
+		else
+		{
+			// Update screen palette when restarting
+			screen->UpdatePalette();
+		}
+
+		// Base systems have been inited; enable cvar callbacks
+		FBaseCVar::EnableCallbacks ();
+
+		// +compatmode cannot be used on the command line, so use this as a substitute
+		auto compatmodeval = Args->CheckValue("-compatmode");
+		if (compatmodeval)
+		{
+			compatmode = (int)strtoll(compatmodeval, nullptr, 10);
+		}
+
+		if (!batchrun) Printf ("ST_Init: Init startup screen.\n");
+		if (!restart)
+		{
+			StartWindow = FStartupScreen::CreateInstance (TexMan.GuesstimateNumTextures() + 5);
+		}
+		else
+		{
+			StartWindow = new FStartupScreen(0);
+		}
+
+		CheckCmdLine();
+	});
+
+	startup.AddTask("SoundDefs", { "Sound", "TexMan", "PreloadDefinitions" }, [&]()
 	{
-		StartWindow = new FStartupScreen(0);
-	}
+		SC_SetPreloadedLumps(preloaded);
 
-	CheckCmdLine();
+		// [RH] Load sound environments
+		S_ParseReverbDef ();
 
-	// [RH] Load sound environments
-	S_ParseReverbDef ();
+		// [RH] Parse any SNDINFO lumps
+		if (!batchrun) Printf ("S_InitData: Load sound definitions.\n");
+		S_InitData ();
+	});
 
-	// [RH] Parse any SNDINFO lumps
-	if (!batchrun) Printf ("S_InitData: Load sound definitions.\n");
-	S_InitData ();
+	startup.AddTask("MapInfo", { "SoundDefs" }, [&]()
+	{
+		// [RH] Parse through all loaded mapinfo lumps
+		if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
+		G_ParseMapInfo (iwad_info->MapInfo);
+		MessageBoxClass = gameinfo.MessageBoxClass;
+		endoomName = gameinfo.Endoom;
+		menuBlurAmount = gameinfo.bluramount;
+		ReadStatistics();
 
-	// [RH] Parse through all loaded mapinfo lumps
-	if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
-	G_ParseMapInfo (iwad_info->MapInfo);
-	MessageBoxClass = gameinfo.MessageBoxClass;
-	endoomName = gameinfo.Endoom;
-	menuBlurAmount = gameinfo.bluramount;
-	ReadStatistics();
+		// MUSINFO must be parsed after MAPINFO
+		S_ParseMusInfo();
+	});
 
-	// MUSINFO must be parsed after MAPINFO
-	S_ParseMusInfo();
+	startup.AddTask("Textures", { "MapInfo" }, [&]()
+	{
+		CLOCK_START
+		if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
+		UpdateUpscaleMask();
+		SpriteFrames.Clear();
+		TexMan.AddTextures([]() 
+		{ 
+			StartWindow->Progress(); 
+			if (StartScreen) StartScreen->Progress(1); 
+		}, CheckForHacks, InitBuildTiles);
+		PatchTextures();
+		TexAnim.Init();
+		C_InitConback(TexMan.CheckForTexture(gameinfo.BorderFlat.GetChars(), ETextureType::Flat), true, 0.25);
+
+		FixWideStatusBar();
+		CLOCK_END("Textures Startup Total")
 
-	CLOCK_START
-	if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
-	UpdateUpscaleMask();
-	SpriteFrames.Clear();
-	TexMan.AddTextures([]() 
-	{ 
 		StartWindow->Progress(); 
-		if (StartScreen) StartScreen->Progress(1); 
-	}, CheckForHacks, InitBuildTiles);
-	PatchTextures();
-	TexAnim.Init();
-	C_InitConback(TexMan.CheckForTexture(gameinfo.BorderFlat.GetChars(), ETextureType::Flat), true, 0.25);
-
-	FixWideStatusBar();
-	CLOCK_END("Textures Startup Total")
-	
-	StartWindow->Progress(); 
-	if (StartScreen) StartScreen->Progress(1);
-	
-	CLOCK_START
-	V_InitFonts();
-	InitDoomFonts();
-	CLOCK_END("Font Startup")
-	V_LoadTranslations();
-	UpdateGenericUI(false);
-
-	// @Cockatrice - Startup stats database
-	statDatabase.init();
-	statDatabase.start();
-
-	// [CW] Parse any TEAMINFO lumps.
-	if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
-	FTeam::ParseTeamInfo ();
-
-	R_ParseTrnslate();
-	PClassActor::StaticInit ();
-	FBaseCVar::InitZSCallbacks ();
-	
-	Job_Init();
+		if (StartScreen) StartScreen->Progress(1);
+	});
 
-	// [GRB] Initialize player class list
-	SetupPlayerClasses ();
+	startup.AddTask("Fonts", { "Textures" }, [&]()
+	{
+		CLOCK_START
+		V_InitFonts();
+		InitDoomFonts();
+		CLOCK_END("Font Startup")
+		V_LoadTranslations();
+		UpdateGenericUI(false);
+	});
 
-	// [RH] Load custom key and weapon settings from WADs
-	D_LoadWadSettings ();
+	startup.AddTask("StatDatabase", { "FileSystem" }, [&]()
+	{
+		// @Cockatrice - Startup stats database
+		statDatabase.init();
+		statDatabase.start();
+	});
 
-	// [GRB] Check if someone used clearplayerclasses but not addplayerclass
-	if (PlayerClasses.Size () == 0)
+	startup.AddTask("Scripts", { "Fonts" }, [&]()
 	{
-		I_FatalError ("No player classes defined");
-	}
+		// [CW] Parse any TEAMINFO lumps.
+		if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
+		FTeam::ParseTeamInfo ();
+
+		R_ParseTrnslate();
+		PClassActor::StaticInit ();
+		FBaseCVar::InitZSCallbacks ();
+
+		Job_Init();
 
-	StartWindow->Progress(); 
-	if (StartScreen) StartScreen->Progress (1);
+		// [GRB] Initialize player class list
+		SetupPlayerClasses ();
 
-	ParseGLDefs();
+		// [RH] Load custom key and weapon settings from WADs
+		D_LoadWadSettings ();
 
-	if (!batchrun) Printf ("R_Init: Init %s refresh subsystem.\n", gameinfo.ConfigName.GetChars());
-	if (StartScreen) StartScreen->LoadingStatus ("Loading graphics", 0x3f);
-	if (StartScreen) StartScreen->Progress(1);
-	StartWindow->Progress(); 
-	R_Init ();
+		// [GRB] Check if someone used clearplayerclasses but not addplayerclass
+		if (PlayerClasses.Size () == 0)
+		{
+			I_FatalError ("No player classes defined");
+		}
 
-	if (!batchrun) Printf ("DecalLibrary: Load decals.\n");
-	DecalLibrary.ReadAllDecals ();
+		StartWindow->Progress(); 
+		if (StartScreen) StartScreen->Progress (1);
+	});
 
-	auto numbasesounds = soundEngine->GetNumSounds();
+	startup.AddTask("GLDefs", { "Scripts" }, [&]()
+	{
+		ParseGLDefs();
+	});
 
-	// Load embedded Dehacked patches
-	D_LoadDehLumps(FromIWAD, iwad_info->SkipBexStringsIfLanguage ? DEH_SKIP_BEX_STRINGS_IF_LANGUAGE : 0);
+	startup.AddTask("Renderer", { "GLDefs" }, [&]()
+	{
+		if (!batchrun) Printf ("R_Init: Init %s refresh subsystem.\n", gameinfo.ConfigName.GetChars());
+		if (StartScreen) StartScreen->LoadingStatus ("Loading graphics", 0x3f);
+		if (StartScreen) StartScreen->Progress(1);
+		StartWindow->Progress(); 
+		R_Init ();
 
-	// [RH] Add any .deh and .bex files on the command line.
-	// If there are none, try adding any in the config file.
-	// Note that the command line overrides defaults from the config.
+		if (!batchrun) Printf ("DecalLibrary: Load decals.\n");
+		DecalLibrary.ReadAllDecals ();
+	});
 
-	if ((ConsiderPatches("-deh") | ConsiderPatches("-bex")) == 0 &&
-		gameinfo.gametype == GAME_Doom && GameConfig->SetSection ("Doom.DefaultDehacked"))
+	startup.AddTask("Dehacked", { "Renderer" }, [&]()
 	{
-		const char *key;
-		const char *value;
+		auto numbasesounds = soundEngine->GetNumSounds();
+
+		// Load embedded Dehacked patches
+		D_LoadDehLumps(FromIWAD, iwad_info->SkipBexStringsIfLanguage ? DEH_SKIP_BEX_STRINGS_IF_LANGUAGE : 0);
 
-		while (GameConfig->NextInSection (key, value))
+		// [RH] Add any .deh and .bex files on the command line.
+		// If there are none, try adding any in the config file.
+		// Note that the command line overrides defaults from the config.
+
+		if ((ConsiderPatches("-deh") | ConsiderPatches("-bex")) == 0 &&
+			gameinfo.gametype == GAME_Doom && GameConfig->SetSection ("Doom.DefaultDehacked"))
 		{
-			if (stricmp (key, "Path") == 0 && FileExists (value))
+			const char *key;
+			const char *value;
+
+			while (GameConfig->NextInSection (key, value))
 			{
-				if (!batchrun) Printf ("Applying patch %s\n", value);
-				D_LoadDehFile(value, 0);
+				if (stricmp (key, "Path") == 0 && FileExists (value))
+				{
+					if (!batchrun) Printf ("Applying patch %s\n", value);
+					D_LoadDehFile(value, 0);
+				}
 			}
 		}
-	}
 
-	// Load embedded Dehacked patches
-	D_LoadDehLumps(FromPWADs, 0);
+		// Load embedded Dehacked patches
+		D_LoadDehLumps(FromPWADs, 0);
 
-	// Create replacements for dehacked pickups
-	FinishDehPatch();
+		// Create replacements for dehacked pickups
+		FinishDehPatch();
 
-	auto numdehsounds = soundEngine->GetNumSounds();
-	if (numbasesounds < numdehsounds) S_LockLocalSndinfo(); // DSDHacked sounds are not compatible with map-local SNDINFOs.
+		auto numdehsounds = soundEngine->GetNumSounds();
+		if (numbasesounds < numdehsounds) S_LockLocalSndinfo(); // DSDHacked sounds are not compatible with map-local SNDINFOs.
+	});
 
-	if (!batchrun) Printf("M_Init: Init menus.\n");
-	SetDefaultMenuColors();
-	M_Init();
-	M_CreateGameMenus();
+	startup.AddTask("Menus", { "Dehacked" }, [&]()
+	{
+		if (!batchrun) Printf("M_Init: Init menus.\n");
+		SetDefaultMenuColors();
+		M_Init();
+		M_CreateGameMenus();
 
 
-	// clean up the compiler symbols which are not needed any longer.
-	RemoveUnusedSymbols();
+		// clean up the compiler symbols which are not needed any longer.
+		RemoveUnusedSymbols();
 
-	InitActorNumsFromMapinfo();
-	InitSpawnablesFromMapinfo();
-	PClassActor::StaticSetActorNums();
+		InitActorNumsFromMapinfo();
+		InitSpawnablesFromMapinfo();
+		PClassActor::StaticSetActorNums();
+	});
 
-	//Added by MC:
-	primaryLevel->BotInfo.getspawned.Clear();
-	
-	FString *args;
-	int argcount = Args->CheckParmList("-bots", &args);
-	for (int p = 0; p < argcount; ++p)
+	startup.AddTask("PlayLoop", { "Menus" }, [&]()
 	{
-		primaryLevel->BotInfo.getspawned.Push(args[p]);
-	}
-	primaryLevel->BotInfo.spawn_tries = 0;
-	primaryLevel->BotInfo.wanted_botnum = primaryLevel->BotInfo.getspawned.Size();
+		//Added by MC:
+		primaryLevel->BotInfo.getspawned.Clear();
 
-	if (!batchrun) Printf ("P_Init: Init Playloop state.\n");
-	if (StartScreen) StartScreen->LoadingStatus ("Init game engine", 0x3f);
-	AM_StaticInit();
-	
-	P_Init ();
+		FString *args;
+		int argcount = Args->CheckParmList("-bots", &args);
+		for (int p = 0; p < argcount; ++p)
+		{
+			primaryLevel->BotInfo.getspawned.Push(args[p]);
+		}
+		primaryLevel->BotInfo.spawn_tries = 0;
+		primaryLevel->BotInfo.wanted_botnum = primaryLevel->BotInfo.getspawned.Size();
+
+		if (!batchrun) Printf ("P_Init: Init Playloop state.\n");
+		if (StartScreen) StartScreen->LoadingStatus ("Init game engine", 0x3f);
+		AM_StaticInit();
+
+		P_Init ();
+
+		P_SetupWeapons_ntohton();
 
-	P_SetupWeapons_ntohton();
+		//SBarInfo support. Note that the first SBARINFO lump contains the mugshot definition so it even needs to be read when a regular status bar is being used.
+		SBarInfo::Load();
+	});
 
-	//SBarInfo support. Note that the first SBARINFO lump contains the mugshot definition so it even needs to be read when a regular status bar is being used.
-	SBarInfo::Load();
+	startup.Run();
+	SC_ClearPreloadedLumps();	// whatever no parser asked for.
+
+	if (auto tracefile = Args->CheckValue("-starttrace"))
+	{
+		if (startup.WriteTrace(tracefile)) Printf("Startup trace written to %s\n", tracefile);
+		else Printf(TEXTCOLOR_RED "Unable to write startup trace %s\n", tracefile);
+	}
+	if (Args->CheckParm("-starttimes")) startup.PrintTimes();
 
 	if (!batchrun)
 	{
@@ -3903,7 +4074,8 @@ static int D_DoomMain_Internal (void)
 		OkForLocalization,
 		[]() ->FConfigFile* { return GameConfig; },
 		nullptr, 
-		RemapUserTranslation
+		RemapUserTranslation,
+		G_RecordTextureUse
 	};
 
 	
@@ -4092,6 +4264,9 @@ void D_Cleanup()
 		G_CheckDemoStatus();
 	}
 
+	// Never leave a half written savegame behind, and report it while the console is still there.
+	G_FinishPendingSave(true);
+
 	// Music and sound should be stopped first
 	S_StopMusic(true);
 	S_ClearSoundData();
@@ -120,6 +120,9 @@ CUSTOM_CVAR (Int, cl_maxdecals, 1024, CVAR_ARCHIVE|CVAR_NOINITCALL)
 }
 
 
+// Only this many impact decals per wall, 0 for no limit. Beyond that the oldest ones get replaced.
+CVAR (Int, cl_maxwalldecals, 64, CVAR_ARCHIVE)
+
 // [BC] Allow the maximum number of particles to be specified by a cvar (so people
 // with lots of nice hardware can have lots of particles!).
 CUSTOM_CVAR(Int, r_maxparticles, 4000, CVAR_ARCHIVE | CVAR_NOINITCALL)
@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <memory>
+#include <thread>
+#include <atomic>
 
 #include "i_time.h"
 
@@ -121,6 +123,7 @@ CVAR (Bool, chasedemo, false, 0);
 CVAR (Bool, storesavepic, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, longsavemessages, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, cl_waitforsave, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR (Bool, save_async, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);	// compress the savepic and write the file on a worker thread.
 CVAR (Bool, enablescriptscreenshot, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 CVAR (Bool, cl_restartondeath, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 EXTERN_CVAR (Float, con_midtime);
@@ -1140,6 +1143,8 @@ void G_Ticker ()
 	int i;
 	gamestate_t	oldgamestate;
 
+	G_FinishPendingSave(false);
+
 	// do player reborns if needed
 	for (i = 0; i < MAXPLAYERS; i++)
 	{
@@ -1934,14 +1939,18 @@ static bool CheckSingleWad (const char *name, bool &printRequires, bool printwar
 
 // Return false if not all the needed wads have been loaded.
 bool G_CheckSaveGameWads (FSerializer &arc, bool printwarn, TArray<FString> *wadList)
+{
+	return G_CheckSaveGameWadNames(arc.GetString("Game WAD"), arc.GetString("Map WAD"), printwarn, wadList);
+}
+
+// Same as above for callers which already extracted the names, e.g. from the savegame index.
+bool G_CheckSaveGameWadNames (const char *text, const char *text2, bool printwarn, TArray<FString> *wadList)
 {
 	bool printRequires = false;
 
-	const char *text = arc.GetString("Game WAD");
 	if (!CheckSingleWad(text, printRequires, printwarn) && wadList != nullptr)
 		wadList->Push(text);
 
-	const char *text2 = arc.GetString("Map WAD");
 	// do not validate the same file twice.
 	if (text != nullptr && text2 != nullptr && stricmp(text, text2) != 0) CheckSingleWad (text2, printRequires, printwarn);
 
@@ -2032,6 +2041,9 @@ void G_DoLoadGame ()
 	hidecon = gameaction == ga_loadgamehidecon;
 	gameaction = ga_nothing;
 
+	// The file to load may still be in the process of being written.
+	G_FinishPendingSave(true);
+
 	std::unique_ptr<FResourceFile> resfile(FResourceFile::OpenResourceFile(savename.GetChars(), true));
 	if (resfile == nullptr)
 	{
@@ -2524,10 +2536,124 @@ static void PutSavePic (FileWriter *file, int width, int height)
 	}
 }
 
+//==========================================================================
+//
+// Everything needed to write a savegame after G_DoSaveGame is done.
+// The slow parts, compressing the savepic and writing the file, get
+// done on a worker thread so that the game can continue right away.
+//
+//==========================================================================
+
+struct FPendingSave
+{
+	FDeferredPNGWriter savepic;
+	TArray<FCompressedBuffer> content;	// all buffers except the savepic in slot 0 are owned by this.
+	TArray<FString> filenames;
+	FString filename;
+	FString description;
+	FString software;
+	FString mapname;
+	int saveDate = 0;
+	bool okForQuicksave = false;
+	bool forceQuicksave = false;
+	bool succeeded = false;
+
+	~FPendingSave()
+	{
+		for (unsigned i = 1; i < content.Size(); i++) content[i].Clean();
+	}
+};
+
+struct FSaveThread
+{
+	std::thread thread;
+	std::unique_ptr<FPendingSave> save;
+	std::atomic<bool> done{ false };
+
+	~FSaveThread()
+	{
+		// D_Cleanup must have finished the save. By now the file system and the console may be gone.
+		assert(!thread.joinable());
+	}
+};
+
+static FSaveThread saveThread;
+
+// Printf is not thread safe, so the save thread cannot report anything from inside the file system.
+static int SaveThreadMessage(FileSys::FSMessageLevel, const char *, ...)
+{
+	return 0;
+}
+
+static void WritePendingSave(FPendingSave *save)
+{
+	auto &savepic = save->savepic;
+
+	savepic.Encode();
+	// put some basic info into the PNG so that this isn't lost when the image gets extracted.
+	M_AppendPNGText(&savepic, "Software", save->software.GetChars());
+	M_AppendPNGText(&savepic, "Title", save->description.GetChars());
+	M_AppendPNGText(&savepic, "Current Map", save->mapname.GetChars());
+	M_FinishPNG(&savepic);
+
+	auto picdata = savepic.GetBuffer();
+	save->content[0] = { picdata->size(), picdata->size(), FileSys::METHOD_STORED, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->size())), (char*)&(*picdata)[0] };
+
+	for (unsigned i = 0; i < save->content.Size(); i++)
+		save->content[i].filename = save->filenames[i].GetChars();
+
+	if (WriteZip(save->filename.GetChars(), save->content.Data(), save->content.Size()))
+	{
+		// Check whether the file is ok by trying to open it.
+		FResourceFile *test = FResourceFile::OpenResourceFile(save->filename.GetChars(), true, nullptr, SaveThreadMessage);
+		if (test != nullptr)
+		{
+			delete test;
+			save->succeeded = true;
+		}
+	}
+}
+
+static void ReportSave(FPendingSave *save)
+{
+	if (save->succeeded)
+	{
+		savegameManager.NotifyNewSave(save->filename, save->description, save->saveDate, save->okForQuicksave, save->forceQuicksave);
+		BackupSaveName = save->filename;
+
+		if (longsavemessages) Printf("%s (%s)\n", GStrings.GetString("GGSAVED"), save->filename.GetChars());
+		else Printf("%s\n", GStrings.GetString("GGSAVED"));
+	}
+	else
+	{
+		Printf(PRINT_HIGH, "%s\n", GStrings.GetString("TXT_SAVEFAILED"));
+	}
+}
+
+//==========================================================================
+//
+// Reports the result of the last savegame once it has been written.
+// With 'wait' set this blocks until the file is complete.
+//
+//==========================================================================
+
+void G_FinishPendingSave(bool wait)
+{
+	if (!saveThread.thread.joinable()) return;
+	if (!wait && !saveThread.done) return;
+
+	saveThread.thread.join();
+	saveThread.done = false;
+	std::unique_ptr<FPendingSave> save = std::move(saveThread.save);
+	ReportSave(save.get());
+}
+
+
 void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, const char *description)
 {
-	TArray<FCompressedBuffer> savegame_content;
-	TArray<FString> savegame_filenames;
+	auto save = std::make_unique<FPendingSave>();
+	TArray<FCompressedBuffer> &savegame_content = save->content;
+	TArray<FString> &savegame_filenames = save->filenames;
 
 	char buf[100];
 
@@ -2543,6 +2669,9 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		filename = G_BuildSaveName ("demosave");
 	}
 
+	// Only one savegame may be written at a time.
+	G_FinishPendingSave(true);
+
 	if (cl_waitforsave)
 		I_FreezeTime(true);
 
@@ -2571,7 +2700,7 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		throw;
 	}
 
-	BufferWriter savepic;
+	FDeferredPNGWriter &savepic = save->savepic;
 	FSerializer savegameinfo;		// this is for displayable info about the savegame
 	FSerializer savegameglobals;	// and this for non-level related info that must be saved.
 
@@ -2581,11 +2710,6 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 	SaveVersion = SAVEVER;
 	PutSavePic(&savepic, SAVEPICWIDTH, SAVEPICHEIGHT);
 	mysnprintf(buf, countof(buf), GAMENAME " %s", GetVersionString());
-	// put some basic info into the PNG so that this isn't lost when the image gets extracted.
-	M_AppendPNGText(&savepic, "Software", buf);
-	M_AppendPNGText(&savepic, "Title", description);
-	M_AppendPNGText(&savepic, "Current Map", primaryLevel->MapName.GetChars());
-	M_FinishPNG(&savepic);
 
 	int ver = SAVEVER;
 	savegameinfo.AddString("Software", buf)
@@ -2627,51 +2751,40 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		savegameglobals("nextskill", NextSkill);
 	}
 
-	auto picdata = savepic.GetBuffer();
-	FCompressedBuffer bufpng = { picdata->size(), picdata->size(), FileSys::METHOD_STORED, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->size())), (char*)&(*picdata)[0] };
-
-	savegame_content.Push(bufpng);
+	savegame_content.Push({});	// the savepic gets filled in once it has been compressed.
 	savegame_filenames.Push("savepic.png");
 	savegame_content.Push(savegameinfo.GetCompressedOutput());
 	savegame_filenames.Push("info.json");
 	savegame_content.Push(savegameglobals.GetCompressedOutput());
 	savegame_filenames.Push("globals.json");
+	unsigned firstsnapshot = savegame_content.Size();
 	G_WriteSnapshots (savegame_filenames, savegame_content);
-	
-	for (unsigned i = 0; i < savegame_content.Size(); i++)
-		savegame_content[i].filename = savegame_filenames[i].GetChars();
 
-	bool succeeded = false;
-
-	if (WriteZip(filename.GetChars(), savegame_content.Data(), savegame_content.Size()))
+	// The snapshots are still owned by the level infos, so the worker needs its own copies.
+	// The current level's snapshot is not needed any longer so it can be taken over directly.
+	for (unsigned i = firstsnapshot; i < savegame_content.Size(); i++)
 	{
-		// Check whether the file is ok by trying to open it.
-		FResourceFile *test = FResourceFile::OpenResourceFile(filename.GetChars(), true);
-		if (test != nullptr)
+		auto &buffer = savegame_content[i];
+		if (buffer.mBuffer == level.info->Snapshot.mBuffer)
 		{
-			delete test;
-			succeeded = true;
+			level.info->Snapshot.mBuffer = nullptr;
+			level.info->Snapshot.mSize = level.info->Snapshot.mCompressedSize = 0;
+		}
+		else
+		{
+			auto copy = new char[buffer.mCompressedSize];
+			memcpy(copy, buffer.mBuffer, buffer.mCompressedSize);
+			buffer.mBuffer = copy;
 		}
 	}
 
-	if (succeeded)
-	{
-		savegameManager.NotifyNewSave(filename, description, cdatei, okForQuicksave, forceQuicksave);
-		BackupSaveName = filename;
-
-		if (longsavemessages) Printf("%s (%s)\n", GStrings.GetString("GGSAVED"), filename.GetChars());
-		else Printf("%s\n", GStrings.GetString("GGSAVED"));
-	}
-	else
-	{
-		Printf(PRINT_HIGH, "%s\n", GStrings.GetString("TXT_SAVEFAILED"));
-	}
-
-
-	// delete the JSON buffers we created just above. Everything else will
-	// either still be needed or taken care of automatically.
-	savegame_content[1].Clean();
-	savegame_content[2].Clean();
+	save->filename = filename;
+	save->description = description;
+	save->software = buf;
+	save->mapname = primaryLevel->MapName;
+	save->saveDate = cdatei;
+	save->okForQuicksave = okForQuicksave;
+	save->forceQuicksave = forceQuicksave;
 
 	// We don't need the snapshot any longer.
 	level.info->Snapshot.Clean();
@@ -2680,6 +2793,21 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 
 	if (cl_waitforsave)
 		I_FreezeTime(false);
+
+	if (save_async)
+	{
+		saveThread.save = std::move(save);
+		saveThread.thread = std::thread([]()
+		{
+			WritePendingSave(saveThread.save.get());
+			saveThread.done = true;
+		});
+	}
+	else
+	{
+		WritePendingSave(save.get());
+		ReportSave(save.get());
+	}
 }
 
 
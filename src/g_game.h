@@ -62,6 +62,7 @@ void G_DeferedPlayDemo (const char* demo);
 void G_LoadGame (const char* name, bool hidecon=false);
 
 void G_DoLoadGame (void);
+void G_FinishPendingSave (bool wait);
 
 // Called by M_Responder.
 void G_SaveGame (const char *filename, const char *description);
@@ -86,6 +87,7 @@ void G_StartSlideshow(FLevelLocals *Level, FName whichone);
 int		G_BuildSaveNames(const char* prefix, TArray<FString>& outputAr);	// @Cockatice - Get all possible locations for save path (Not a specific slot)
 class FSerializer;
 bool G_CheckSaveGameWads (FSerializer &arc, bool printwarn, TArray<FString> *wadList = nullptr);
+bool G_CheckSaveGameWadNames (const char *gamewad, const char *mapwad, bool printwarn, TArray<FString> *wadList = nullptr);
 
 enum EFinishLevelType
 {
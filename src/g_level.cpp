@@ -2366,6 +2366,10 @@ void FLevelLocals::Mark()
 	{
 		GC::Mark(c);
 	}
+	for (auto &cell : AmbientCells)
+	{
+		for (auto &a : cell) GC::Mark(a);
+	}
 	for (auto &s : sectorPortals)
 	{
 		GC::Mark(s.mSkybox);
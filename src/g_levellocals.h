@@ -671,6 +671,13 @@ public:
 
 	DSeqNode *SequenceListHead;
 
+	// Sleeping ambient sounds, listed in every cell their audible range reaches.
+	TArray<TArray<TObjPtr<AActor*>>>	AmbientCells;
+	int			AmbientCellsWidth = 0;
+	int			AmbientCellsHeight = 0;
+	int			AmbientListenerCells[MAXPLAYERS];
+	bool		AmbientCellsValid = false;
+
 	// [RH] particle globals
 	uint32_t			OldestParticle; // [MC] Oldest particle for replacing with SPF_REPLACE
 	uint32_t			ActiveParticles;
@@ -680,7 +687,8 @@ public:
 	FThinkerCollection Thinkers;
 
 	particlelevelpool_t				DefinedParticlePool;
-	TArray<uint16_t>				DefinedParticlesInSubsec;
+	TArray<TArray<uint32_t>>		DefinedParticlesInSubsec;	// Dense per subsector lists, only updated for particles that moved
+	TArray<uint32_t>				DefinedParticlesMoved;		// Particles whose subsector may have changed since the last frame
 	TMap<int, DParticleDefinition*>	ParticleDefinitionsByType;
 
 	TArray<DVector2>	Scrolls;		// NULL if no DScrollers in this level
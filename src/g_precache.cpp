@@ -0,0 +1,281 @@
+/*
+** g_precache.cpp
+** Records which resources a map really uses, for the next time it gets
+** precached
+**
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <mutex>
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "printf.h"
+#include "i_specialpaths.h"
+#include "texturemanager.h"
+#include "s_soundinternal.h"
+#include "model.h"
+#include "g_levellocals.h"
+#include "g_precache.h"
+
+CVAR(Bool, precache_record, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Bool, precache_manifest, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+FPrecacheManifest LevelPrecacheManifest;
+
+static bool Recording;
+static FString RecordFile;
+static FPrecacheManifest Recorded;
+static TArray<bool> SoundRecorded;
+static TArray<bool> ModelRecorded;
+static std::mutex ModelRecordMutex;	// models also get recorded by the BSP worker thread
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FPrecacheManifest::Clear()
+{
+	Textures.Clear();
+	Sounds.Clear();
+	Models.Clear();
+}
+
+static void MergeList(TArray<FPrecacheManifest::Entry> &list, const TArray<FPrecacheManifest::Entry> &other)
+{
+	TMap<int, unsigned> positions;
+	for (unsigned i = 0; i < list.Size(); i++)
+	{
+		positions.Insert(list[i].Index, i);
+	}
+	for (auto &entry : other)
+	{
+		auto pos = positions.CheckKey(entry.Index);
+		if (pos == nullptr)
+		{
+			positions.Insert(entry.Index, list.Size());
+			list.Push(entry);
+		}
+		else
+		{
+			list[*pos].Tic = std::min(list[*pos].Tic, entry.Tic);
+		}
+	}
+}
+
+// Different playthroughs use different things, so all of them are kept, each with its earliest use.
+void FPrecacheManifest::Merge(const FPrecacheManifest &other)
+{
+	MergeList(Textures, other.Textures);
+	MergeList(Sounds, other.Sounds);
+	MergeList(Models, other.Models);
+}
+
+void FPrecacheManifest::Sort()
+{
+	auto bytic = [](const Entry &a, const Entry &b) { return a.Tic < b.Tic; };
+	std::stable_sort(Textures.begin(), Textures.end(), bytic);
+	std::stable_sort(Sounds.begin(), Sounds.end(), bytic);
+	std::stable_sort(Models.begin(), Models.end(), bytic);
+}
+
+//==========================================================================
+//
+// One line per resource:
+//
+//   T <tic> <use type> <texture name>
+//   S <tic> <sound name>
+//   M <tic> <model file name>
+//
+// Names are the rest of the line, so they may contain spaces. Anything
+// that no longer exists is skipped.
+//
+//==========================================================================
+
+bool FPrecacheManifest::Load(const char *filename)
+{
+	Clear();
+
+	FileReader fr;
+	if (!fr.OpenFile(filename)) return false;
+	auto data = fr.ReadPadded(1);
+	FString text = data.string();
+
+	TMap<FString, int> models;
+	for (unsigned i = 0; i < ::Models.Size(); i++)
+	{
+		FString name = ::Models[i]->mFileName;
+		name.ToLower();
+		models.Insert(name, i);
+	}
+
+	for (auto &line : text.Split("\n", FString::TOK_SKIPEMPTY))
+	{
+		line.StripRight();
+		int tic, type, pos;
+		if (sscanf(line.GetChars(), "T %d %d %n", &tic, &type, &pos) == 2)
+		{
+			FTextureID tex = TexMan.CheckForTexture(line.GetChars() + pos, (ETextureType)type, FTextureManager::TEXMAN_TryAny | FTextureManager::TEXMAN_DontCreate);
+			if (tex.isValid()) Textures.Push({ tex.GetIndex(), tic });
+		}
+		else if (sscanf(line.GetChars(), "S %d %n", &tic, &pos) == 1)
+		{
+			FSoundID sound = soundEngine->FindSound(line.GetChars() + pos);
+			if (sound.isvalid()) Sounds.Push({ sound.index(), tic });
+		}
+		else if (sscanf(line.GetChars(), "M %d %n", &tic, &pos) == 1)
+		{
+			FString name = line.GetChars() + pos;
+			name.ToLower();
+			auto model = models.CheckKey(name);
+			if (model != nullptr) Models.Push({ *model, tic });
+		}
+	}
+	Sort();
+	return true;
+}
+
+bool FPrecacheManifest::Save(const char *filename) const
+{
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(filename));
+	if (fw == nullptr) return false;
+
+	FString out = "// Precache manifest\n";
+	for (auto &entry : Textures)
+	{
+		auto tex = TexMan.GameByIndex(entry.Index);
+		out.AppendFormat("T %d %d %s\n", entry.Tic, (int)tex->GetUseType(), tex->GetName().GetChars());
+	}
+	for (auto &entry : Sounds)
+	{
+		out.AppendFormat("S %d %s\n", entry.Tic, soundEngine->GetSoundName(FSoundID::fromInt(entry.Index)));
+	}
+	for (auto &entry : Models)
+	{
+		out.AppendFormat("M %d %s\n", entry.Tic, ::Models[entry.Index]->mFileName.GetChars());
+	}
+	return fw->Write(out.GetChars(), out.Len()) == out.Len();
+}
+
+//==========================================================================
+//
+// Manifests are kept in the cache directory, one per map checksum.
+//
+//==========================================================================
+
+static FString ManifestName(FLevelLocals *Level, bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/precache";
+	if (create) CreatePath(path.GetChars());
+
+	FString mapname = Level->MapName;
+	mapname.ReplaceChars('/', '%');
+	path << '/' << mapname << '-';
+	for (auto b : Level->md5) path.AppendFormat("%02x", b);
+	path << ".txt";
+	return path;
+}
+
+void G_LoadPrecacheManifest(FLevelLocals *Level)
+{
+	LevelPrecacheManifest.Clear();
+	if (!precache_manifest || Level != primaryLevel) return;
+
+	if (LevelPrecacheManifest.Load(ManifestName(Level, false).GetChars()))
+	{
+		DPrintf(DMSG_NOTIFY, "Precache manifest: %u textures, %u sounds, %u models\n",
+			LevelPrecacheManifest.Textures.Size(), LevelPrecacheManifest.Sounds.Size(), LevelPrecacheManifest.Models.Size());
+	}
+}
+
+//==========================================================================
+//
+// Recording starts once the level has been precached, so only what the
+// game asks for afterwards gets recorded.
+//
+//==========================================================================
+
+void G_StartPrecacheRecording(FLevelLocals *Level)
+{
+	if (Level != primaryLevel) return;
+	G_FinishPrecacheRecording();
+	if (!precache_record) return;
+
+	Recorded.Clear();
+	SoundRecorded.Resize(soundEngine->GetNumSounds());
+	for (auto &b : SoundRecorded) b = false;
+	ModelRecorded.Resize(Models.Size());
+	for (auto &b : ModelRecorded) b = false;
+
+	// The renderer reports each texture the first time it gets bound after this.
+	for (int i = 0; i < TexMan.NumTextures(); i++)
+	{
+		auto tex = TexMan.GameByIndex(i);
+		if (tex != nullptr) tex->isSeen(true);
+	}
+
+	RecordFile = ManifestName(Level, true);
+	Recording = true;
+}
+
+void G_FinishPrecacheRecording()
+{
+	if (!Recording) return;
+	Recording = false;
+
+	FPrecacheManifest previous;
+	previous.Load(RecordFile.GetChars());
+	Recorded.Merge(previous);
+	Recorded.Sort();
+
+	if (!Recorded.IsEmpty() && !Recorded.Save(RecordFile.GetChars()))
+	{
+		Printf("Unable to write precache manifest %s\n", RecordFile.GetChars());
+	}
+	Recorded.Clear();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void G_RecordTextureUse(FGameTexture *tex)
+{
+	if (!Recording || tex->GetName().IsEmpty()) return;
+	Recorded.Textures.Push({ tex->GetID().GetIndex(), primaryLevel->maptime });
+}
+
+void G_RecordSoundUse(FSoundID sound)
+{
+	if (!Recording || !sound.isvalid()) return;
+	unsigned index = sound.index();
+	if (index >= SoundRecorded.Size())
+	{
+		// Sounds can still get added while playing.
+		unsigned oldsize = SoundRecorded.Size();
+		SoundRecorded.Resize(index + 1);
+		for (unsigned i = oldsize; i <= index; i++) SoundRecorded[i] = false;
+	}
+	if (!SoundRecorded[index])
+	{
+		SoundRecorded[index] = true;
+		Recorded.Sounds.Push({ (int)index, primaryLevel->maptime });
+	}
+}
+
+void G_RecordModelUse(int model)
+{
+	if (!Recording || model < 0 || (unsigned)model >= ModelRecorded.Size()) return;
+	std::lock_guard<std::mutex> lock(ModelRecordMutex);
+	if (!ModelRecorded[model])
+	{
+		ModelRecorded[model] = true;
+		Recorded.Models.Push({ model, primaryLevel->maptime });
+	}
+}
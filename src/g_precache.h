@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tarray.h"
+#include "zstring.h"
+
+class FGameTexture;
+struct FLevelLocals;
+class FSoundID;
+
+//==========================================================================
+//
+// The resources one map actually used, and the tic each was first used in.
+//
+// A manifest gets recorded while a map is being played and is saved by
+// name, so that it still applies when the resource indices change between
+// sessions. Once loaded, the entries refer to this session's texture,
+// sound and model indices and are sorted by first use.
+//
+//==========================================================================
+
+struct FPrecacheManifest
+{
+	struct Entry
+	{
+		int Index;
+		int Tic;
+	};
+
+	TArray<Entry> Textures;		// texture manager indices
+	TArray<Entry> Sounds;		// sound ids
+	TArray<Entry> Models;		// indices into Models
+
+	void Clear();
+	bool IsEmpty() const { return Textures.Size() == 0 && Sounds.Size() == 0 && Models.Size() == 0; }
+	void Merge(const FPrecacheManifest &other);
+	void Sort();
+
+	bool Load(const char *filename);
+	bool Save(const char *filename) const;
+};
+
+// The manifest for the level currently being set up. Empty if there is none.
+extern FPrecacheManifest LevelPrecacheManifest;
+
+void G_LoadPrecacheManifest(FLevelLocals *Level);
+void G_StartPrecacheRecording(FLevelLocals *Level);
+void G_FinishPrecacheRecording();
+
+void G_RecordTextureUse(FGameTexture *tex);
+void G_RecordSoundUse(FSoundID sound);
+void G_RecordModelUse(int model);
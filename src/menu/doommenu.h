@@ -17,13 +17,17 @@ void M_CreateGameMenus();
 void SetDefaultMenuColors();
 void OnMenuOpen(bool makeSound);
 
+struct FSaveIndexEntry;
+
 class FSavegameManager : public FSavegameManagerBase
 {
 	void PerformSaveGame(const char *fn, const char *sgdesc) override;
 	void PerformLoadGame(const char *fn, bool) override;
 	FString ExtractSaveComment(FSerializer &arc) override;
 	FString BuildSaveName(const char* prefix, int slot) override;
+	void FinishPendingSave() override;
 	void ReadSaveStrings() override;
+	bool ReadSaveIndexEntry(const FString &filepath, FSaveIndexEntry &info);
 };
 
 extern FSavegameManager savegameManager;
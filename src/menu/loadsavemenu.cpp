@@ -46,10 +46,111 @@
 #include "v_video.h"
 #include "fs_findfile.h"
 #include "v_draw.h"
+#include "cmdlib.h"
 
 // Save name length limit for old binary formats.
 #define OLDSAVESTRINGSIZE		24
 
+//=============================================================================
+//
+// Savegame index
+//
+// Listing the savegames requires opening every single file and parsing its
+// info.json, which gets slow with lots of saves. The index keeps everything
+// the menu needs for each file, including where the uncompressed savepic is
+// located, so that only new or modified files have to be opened.
+// Entries are validated against the file's size and modification time.
+//
+//=============================================================================
+
+static const char *SAVEINDEX_NAME = "saveindex.json";
+static const int SAVEINDEX_VERSION = 1;
+
+struct FSaveIndexEntry
+{
+	enum
+	{
+		Savegame,
+		NotASavegame,	// no info.json, i.e. some unrelated file.
+	};
+
+	FString Filename;
+	int64_t FileSize = 0;
+	int64_t FileTime = 0;
+	int Kind = Savegame;
+	int SaveVersion = 0;
+	int SaveDate = 0;
+	FString Engine;
+	FString GameWad;
+	FString MapWad;
+	FString Title;
+	FString Comment;
+	int64_t PicOffset = 0;
+	int64_t PicLength = 0;
+};
+
+FSerializer &Serialize(FSerializer &arc, const char *key, FSaveIndexEntry &entry, FSaveIndexEntry *def)
+{
+	if (arc.BeginObject(key))
+	{
+		arc("file", entry.Filename)
+			("size", entry.FileSize)
+			("time", entry.FileTime)
+			("kind", entry.Kind)
+			("version", entry.SaveVersion)
+			("date", entry.SaveDate)
+			("engine", entry.Engine)
+			("gamewad", entry.GameWad)
+			("mapwad", entry.MapWad)
+			("title", entry.Title)
+			("comment", entry.Comment)
+			("picoffset", entry.PicOffset)
+			("piclength", entry.PicLength);
+		arc.EndObject();
+	}
+	return arc;
+}
+
+static void ReadSaveIndex(const FString &path, TMap<FString, FSaveIndexEntry> &index)
+{
+	FileReader fr;
+	if (!fr.OpenFile(path.GetChars())) return;
+	auto data = fr.Read();
+	fr.Close();
+
+	FSerializer arc;
+	if (!arc.OpenReader(data.string(), data.size())) return;
+
+	int version = 0;
+	arc("version", version);
+	if (version != SAVEINDEX_VERSION) return;
+
+	TArray<FSaveIndexEntry> entries;
+	arc("saves", entries);
+	for (auto &entry : entries)
+	{
+		if (entry.Filename.IsNotEmpty()) index.Insert(entry.Filename, entry);
+	}
+}
+
+static void WriteSaveIndex(const FString &path, TArray<FSaveIndexEntry> &entries)
+{
+	FSerializer arc;
+	if (!arc.OpenWriter(false)) return;
+
+	int version = SAVEINDEX_VERSION;
+	arc("version", version);
+	arc("saves", entries);
+
+	unsigned len;
+	const char *output = arc.GetOutput(&len);
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(path.GetChars()));
+	if (fw != nullptr)
+	{
+		fw->Write(output, len);
+	}
+}
+
 //=============================================================================
 //
 // M_ReadSaveStrings
@@ -72,69 +173,142 @@ void FSavegameManager::ReadSaveStrings()
 		FileSys::FileList list;
 
 		for (int searchPathIndex = 0; searchPathIndex < (int)searchPaths.Size(); searchPathIndex++) {
+			FString indexPath = searchPaths[searchPathIndex] + SAVEINDEX_NAME;
+			TMap<FString, FSaveIndexEntry> index;
+			TArray<FSaveIndexEntry> newIndex;
+			bool indexChanged = false;
+
+			ReadSaveIndex(indexPath, index);
+			list.clear();	// the index is per directory, so don't carry over the previous directory's files.
+
 			if (FileSys::ScanDirectory(list, searchPaths[searchPathIndex].GetChars(), "*." SAVEGAME_EXT, true))
 			{
 				for (auto& entry : list)
 				{
-					std::unique_ptr<FResourceFile> savegame(FResourceFile::OpenResourceFile(entry.FilePath.c_str(), true));
-					if (savegame != nullptr)
+					FString filepath = entry.FilePath.c_str();
+					size_t filesize = 0;
+					time_t filetime = 0;
+					GetFileInfo(filepath.GetChars(), &filesize, &filetime);
+
+					FSaveIndexEntry *cached = index.CheckKey(filepath);
+					FSaveIndexEntry info;
+					if (cached != nullptr && cached->FileSize == (int64_t)filesize && cached->FileTime == (int64_t)filetime)
+					{
+						info = *cached;
+					}
+					else
+					{
+						if (!ReadSaveIndexEntry(filepath, info)) continue;
+						info.FileSize = filesize;
+						info.FileTime = filetime;
+						indexChanged = true;
+					}
+					newIndex.Push(info);
+
+					if (info.Kind != FSaveIndexEntry::Savegame)
+					{
+						// savegame info not found. This is not a savegame so leave it alone.
+						continue;
+					}
+
+					bool oldVer = false;
+					bool missing = false;
+
+					if (info.Engine.Compare(GAMESIG) != 0 || info.SaveVersion > SAVEVER)
+					{
+						// different engine or newer version:
+						// not our business. Leave it alone.
+						continue;
+					}
+
+					if (info.SaveVersion < MINSAVEVER)
+					{
+						// old, incompatible savegame. List as not usable.
+						oldVer = true;
+					}
+					else if (info.GameWad.CompareNoCase(fileSystem.GetResourceFileName(fileSystem.GetIwadNum())) == 0)
 					{
-						bool oldVer = false;
-						bool missing = false;
-						auto info = savegame->FindEntry("info.json");
-						if (info < 0)
-						{
-							// savegame info not found. This is not a savegame so leave it alone.
-							continue;
-						}
-						auto data = savegame->Read(info);
-						FSerializer arc;
-						if (arc.OpenReader(data.string(), data.size()))
-						{
-							int savever = 0;
-							arc("Save Version", savever);
-							FString engine = arc.GetString("Engine");
-							FString iwad = arc.GetString("Game WAD");
-							FString title = arc.GetString("Title");
-
-							int date = 0;
-							arc("Save Date", date);
-
-							if (engine.Compare(GAMESIG) != 0 || savever > SAVEVER)
-							{
-								// different engine or newer version:
-								// not our business. Leave it alone.
-								continue;
-							}
-
-							if (savever < MINSAVEVER)
-							{
-								// old, incompatible savegame. List as not usable.
-								oldVer = true;
-							}
-							else if (iwad.CompareNoCase(fileSystem.GetResourceFileName(fileSystem.GetIwadNum())) == 0)
-							{
-								missing = !G_CheckSaveGameWads(arc, false);
-							}
-							else
-							{
-								// different game. Skip this.
-								continue;
-							}
-
-							FSaveGameNode* node = new FSaveGameNode;
-							node->Filename = entry.FilePath.c_str();
-							node->bOldVersion = oldVer;
-							node->bMissingWads = missing;
-							node->SaveTitle = title;
-							node->saveDate = date;
-							InsertSaveNode(node);
-						}
+						missing = !G_CheckSaveGameWadNames(info.GameWad.GetChars(), info.MapWad.IsEmpty() ? nullptr : info.MapWad.GetChars(), false);
 					}
+					else
+					{
+						// different game. Skip this.
+						continue;
+					}
+
+					FSaveGameNode* node = new FSaveGameNode;
+					node->Filename = filepath;
+					node->bOldVersion = oldVer;
+					node->bMissingWads = missing;
+					node->SaveTitle = info.Title;
+					node->saveDate = info.SaveDate;
+					node->SaveComment = info.Comment;
+					node->PicOffset = (size_t)info.PicOffset;
+					node->PicLength = (size_t)info.PicLength;
+					InsertSaveNode(node);
 				}
 			}
+
+			// Files that were deleted also need to be removed from the index.
+			if (indexChanged || newIndex.Size() != index.CountUsed())
+			{
+				WriteSaveIndex(indexPath, newIndex);
+			}
+		}
+	}
+}
+
+//=============================================================================
+//
+// Opens a savegame file to get the information for the savegame index.
+// Returns false if the file could not be read at all.
+//
+//=============================================================================
+
+bool FSavegameManager::ReadSaveIndexEntry(const FString &filepath, FSaveIndexEntry &info)
+{
+	std::unique_ptr<FResourceFile> savegame(FResourceFile::OpenResourceFile(filepath.GetChars(), true));
+	if (savegame == nullptr)
+	{
+		return false;
+	}
+
+	info.Filename = filepath;
+	info.Kind = FSaveIndexEntry::NotASavegame;
+
+	auto infolump = savegame->FindEntry("info.json");
+	if (infolump < 0)
+	{
+		return true;
+	}
+	auto data = savegame->Read(infolump);
+	FSerializer arc;
+	if (!arc.OpenReader(data.string(), data.size()))
+	{
+		return true;
+	}
+
+	info.Kind = FSaveIndexEntry::Savegame;
+	arc("Save Version", info.SaveVersion);
+	arc("Save Date", info.SaveDate);
+	info.Engine = arc.GetString("Engine");
+	info.GameWad = arc.GetString("Game WAD");
+	info.MapWad = arc.GetString("Map WAD");
+	info.Title = arc.GetString("Title");
+	info.Comment = ExtractSaveComment(arc);
+
+	auto pic = savegame->FindEntry("savepic.png");
+	if (pic >= 0 && !(savegame->GetEntryFlags(pic) & FileSys::RESFF_COMPRESSED))
+	{
+		// Getting a reader resolves the entry's real position inside the file.
+		savegame->GetEntryReader(pic, FileSys::READER_SHARED);
+		if (!(savegame->GetEntryFlags(pic) & FileSys::RESFF_NEEDFILESTART))
+		{
+			info.PicOffset = savegame->Offset(pic);
+			info.PicLength = savegame->Length(pic);
 		}
 	}
+	return true;
 }
 
 
@@ -166,6 +340,17 @@ void FSavegameManager::PerformSaveGame(const char *fn, const char *savegamestrin
 //
 //=============================================================================
 
+void FSavegameManager::FinishPendingSave()
+{
+	G_FinishPendingSave(true);
+}
+
+//=============================================================================
+//
+//
+//
+//=============================================================================
+
 FString FSavegameManager::ExtractSaveComment(FSerializer &arc)
 {
 	//FString comment;
@@ -61,6 +61,7 @@
 #include "r_utility.h"
 #include "p_spec.h"
 #include "g_levellocals.h"
+#include "g_precache.h"
 #include "c_dispatch.h"
 #include "a_dynlight.h"
 #include "events.h"
@@ -344,6 +345,8 @@ void FLevelLocals::ClearLevelData(bool fullgc)
 	}
 	
 	SN_StopAllSequences(this);
+	AmbientCells.Clear();
+	AmbientCellsValid = false;
 
 	FStrifeDialogueNode *node;
 	
@@ -426,6 +429,7 @@ void FLevelLocals::ClearLevelData(bool fullgc)
 
 void P_FreeLevelData (bool fullgc)
 {
+	G_FinishPrecacheRecording();
 	R_FreePastViewers();
 
 	for (auto Level : AllLevels())
@@ -609,9 +613,12 @@ void P_SetupLevel(FLevelLocals *Level, int position, bool newGame, int mapVersio
 	// preload graphics and sounds
 	if (precache)
 	{
+		G_LoadPrecacheManifest(Level);
 		PrecacheLevel(Level);
 		S_PrecacheLevel(Level);
+		LevelPrecacheManifest.Clear();
 	}
+	G_StartPrecacheRecording(Level);
 
 	if (deathmatch)
 	{
@@ -170,6 +170,7 @@ void P_Ticker (void)
 		// [ZZ] call the WorldTick hook
 		Level->localEventManager->WorldTick();
 		Level->Tick();			// [RH] let the level tick
+		S_UpdateAmbientCells(Level);
 		Level->Thinkers.RunThinkers(Level);
 
 		P_ThinkDefinedParticles(Level); // Run after the world tick so we get proper moving sector heights
@@ -48,6 +48,7 @@
 
 EXTERN_CVAR (Bool, cl_spreaddecals)
 EXTERN_CVAR (Int, cl_maxdecals)
+EXTERN_CVAR (Int, cl_maxwalldecals)
 
 
 //----------------------------------------------------------------------------
@@ -680,6 +681,27 @@ void DImpactDecal::CheckMax ()
 			Level->ImpactDecalCount--;
 		}
 	}
+
+	// Walls that get shot at a lot would otherwise keep piling up decals on top
+	// of each other, which all need to be clipped and drawn.
+	if (cl_maxwalldecals > 0 && Side != nullptr)
+	{
+		DBaseDecal *oldest = nullptr;
+		int count = 0;
+		for (DBaseDecal *decal = Side->AttachedDecals; decal != nullptr; decal = decal->WallNext)
+		{
+			if (decal->IsKindOf(RUNTIME_CLASS(DImpactDecal)))
+			{
+				if (oldest == nullptr) oldest = decal;
+				count++;
+			}
+		}
+		if (count > cl_maxwalldecals && oldest != this)
+		{
+			oldest->Destroy();
+			Level->ImpactDecalCount--;
+		}
+	}
 }
 
 //----------------------------------------------------------------------------
@@ -88,7 +88,10 @@ static FDynamicLight *GetLight(FLevelLocals *Level)
 		FreeList.Pop(ret);
 	}
 	else ret = (FDynamicLight*)DynLightArena.Alloc(sizeof(FDynamicLight));
-	memset(ret, 0, sizeof(*ret));
+	memset((void*)ret, 0, sizeof(*ret));
+	// The memset does not make valid atomics, they have to be constructed.
+	new (&ret->packedFrame) std::atomic<unsigned>(0);
+	new (&ret->packLock) std::atomic<bool>(false);
 	ret->m_cycler.m_increment = true;
 	ret->next = Level->lights;
 	Level->lights = ret;
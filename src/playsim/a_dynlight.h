@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include "c_cvars.h"
 #include "actor.h"
 #include "cycler.h"
@@ -325,6 +326,14 @@ public:
 	bool swapped;
 	bool explicitpitch;
 
+	// The light's shader data, packed by the hardware renderer on its first use in a viewpoint.
+	// packedFrame gets published after the data, packing is claimed through packLock.
+	float packedData[16];
+	double packedTicFrac;
+	std::atomic<unsigned> packedFrame;
+	std::atomic<bool> packLock;
+	int packedGroup;
+	int packedArray;
 };
 
 
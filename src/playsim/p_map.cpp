@@ -66,6 +66,7 @@
 #include "m_bbox.h"
 #include "m_random.h"
 #include "c_dispatch.h"
+#include "stats.h"
 
 #include "doomdef.h"
 #include "p_local.h"
@@ -7381,6 +7382,123 @@ void PIT_CeilingRaise(AActor *thing, FChangePosition *cpos)
 	}
 }
 
+//=============================================================================
+//
+// ChangeSectorThings
+//
+// Runs the iterators for every thing touching the sector, with one pass
+// over a snapshot of the sector's thing list, sorted by height if needed.
+// Scanning the list from the start after every thing, as killough did,
+// gets quadratic on platforms crowded with debris, and even more so when
+// every scan also has to look for the next lowest thing.
+//
+// The snapshot is a stack so that this can be reentered from the
+// iterators, e.g. when a crushed thing's death moves another sector.
+//
+//=============================================================================
+
+struct FSectorThing
+{
+	AActor *thing;
+	double z;
+};
+
+static TArray<FSectorThing> SectorThings;
+
+// For 'stat sectorthings', covering all sector moves of the last tic.
+static cycle_t SectorThingCycles;
+static double SectorThingMS;
+static int SectorThingTic = -1, SectorThingDepth;
+static int SectorThingCount, SectorThingCalls, LastSectorThingCount, LastSectorThingCalls;
+
+ADD_STAT(sectorthings)
+{
+	return FStringf("Sector things time = %04.2f ms - %d moves, %d things", SectorThingMS, LastSectorThingCalls, LastSectorThingCount);
+}
+
+static void ChangeSectorThing(msecnode_t *n, void(*iterator)(AActor *, FChangePosition *), void(*iterator2)(AActor *, FChangePosition *), FChangePosition *cpos)
+{
+	n->visited = true; 							// mark thing as processed
+	if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
+		(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
+	{
+		iterator(n->m_thing, cpos);		 			// process it
+		if (iterator2 != NULL) iterator2(n->m_thing, cpos);
+	}
+}
+
+static void ChangeSectorThings(sector_t *sec, void(*iterator)(AActor *, FChangePosition *), void(*iterator2)(AActor *, FChangePosition *), FChangePosition *cpos, bool sortZ)
+{
+	msecnode_t *n;
+	unsigned base = SectorThings.Size();
+
+	// Only the outermost call is timed, the iterators can get back here.
+	if (SectorThingDepth++ == 0)
+	{
+		if (gametic != SectorThingTic)
+		{
+			SectorThingMS = SectorThingCycles.TimeMS();
+			LastSectorThingCount = SectorThingCount;
+			LastSectorThingCalls = SectorThingCalls;
+			SectorThingCycles.Reset();
+			SectorThingCount = SectorThingCalls = 0;
+			SectorThingTic = gametic;
+		}
+		SectorThingCycles.Clock();
+	}
+	SectorThingCalls++;
+
+	for (n = sec->touching_thinglist; n; n = n->m_snext)
+	{
+		n->visited = false;
+		SectorThings.Push({ n->m_thing, n->m_thing->Z() });
+	}
+	unsigned end = SectorThings.Size();
+	SectorThingCount += end - base;
+
+	// @Cockatrice - Order things by Z for moving down
+	// Things at the same height keep the order of the list.
+	if (sortZ && end - base > 1)
+	{
+		std::stable_sort(&SectorThings[base], &SectorThings[0] + end, [](const FSectorThing &a, const FSectorThing &b) { return a.z < b.z; });
+	}
+
+	for (unsigned i = base; i < end; i++)
+	{
+		// The things processed before may have moved this one out of the sector or destroyed it,
+		// which unlinks it, so it only gets processed if it still has an unvisited node here.
+		// Its own sector list is short, unlike the sector's.
+		for (n = SectorThings[i].thing->touching_sectorlist; n && n->m_sector != sec; n = n->m_tnext);
+		if (n != nullptr && !n->visited)
+		{
+			ChangeSectorThing(n, iterator, iterator2, cpos);
+		}
+	}
+	SectorThings.Resize(base);
+
+	// killough 4/4/98: scan list front-to-back until empty or exhausted,
+	// restarting from beginning after each thing is processed. Avoids
+	// crashes, and is sure to examine all things in the sector, and only
+	// the things which are in the sector, until a steady-state is reached.
+	// Things can arbitrarily be inserted and removed and it won't mess up.
+	//
+	// This only has to pick up what got spawned in the sector in the meantime,
+	// usually nothing.
+	do
+	{
+		for (n = sec->touching_thinglist; n; n = n->m_snext)	// go through list
+		{
+			if (!n->visited)								// unprocessed thing found
+			{
+				ChangeSectorThing(n, iterator, iterator2, cpos);
+				break;										// exit and start over
+			}
+		}
+	} while (n);	// repeat from scratch until all things left are marked valid
+
+	if (--SectorThingDepth == 0) SectorThingCycles.Unclock();
+}
+
 //=============================================================================
 //
 // P_ChangeSector	[RH] Was P_CheckSector in BOOM
@@ -7432,23 +7550,7 @@ bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, b
 			// no thing checks for attached sectors because of heightsec
 			if (sec->heightsec == sector) continue;
 
-			for (n = sec->touching_thinglist; n; n = n->m_snext) n->visited = false;
-			do
-			{
-				for (n = sec->touching_thinglist; n; n = n->m_snext)
-				{
-					if (!n->visited)
-					{
-						n->visited = true;
-						if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
-							(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
-						{
-							iterator(n->m_thing, &cpos);
-						}
-						break;
-					}
-				}
-			} while (n);
+			ChangeSectorThings(sec, iterator, NULL, &cpos, false);
 			sec->CheckPortalPlane(!floorOrCeil);
 		}
 	}
@@ -7482,68 +7584,7 @@ bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, b
 		return false;
 	}
 
-	// killough 4/4/98: scan list front-to-back until empty or exhausted,
-	// restarting from beginning after each thing is processed. Avoids
-	// crashes, and is sure to examine all things in the sector, and only
-	// the things which are in the sector, until a steady-state is reached.
-	// Things can arbitrarily be inserted and removed and it won't mess up.
-	//
-	// killough 4/7/98: simplified to avoid using complicated counter
-
-	// Mark all things invalid
-	bool sortZ = amt < 0, loop = false;
-	double lastZ = DBL_MAX, orderZ;
-
-	for (n = sector->touching_thinglist; n; n = n->m_snext) {
-		n->visited = false;
-
-		// @Cockatrice - Find lowest Z
-		if (n->m_thing->Z() <= lastZ /* && !(n->m_thing->flags5 & MF5_NOINTERACTION)*/) lastZ = n->m_thing->Z();
-	}
-	orderZ = lastZ;
-
-	do
-	{
-		for (n = sector->touching_thinglist; n; n = n->m_snext)	// go through list
-		{
-			if (!n->visited)								// unprocessed thing found
-			{
-				// @Cockatrice - Order things by Z for moving down
-				// We force re-looping to find the next Z in the order
-				// Don't bother sorting actors that cannot interact with others
-				if (sortZ){//} && !(n->m_thing->flags5 & MF5_NOINTERACTION)) {
-					if (orderZ != n->m_thing->Z() && n->m_thing->Z() < lastZ) {
-						lastZ = n->m_thing->Z();
-						loop = true;
-						continue;
-					}
-					else if (orderZ != n->m_thing->Z()) {
-						loop = true;
-						continue;
-					}
-
-					orderZ = lastZ;
-					lastZ = DBL_MAX;
-				}
-
-				n->visited = true; 							// mark thing as processed
-				if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
-					(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
-				{
-					iterator(n->m_thing, &cpos);		 			// process it
-					if (iterator2 != NULL) iterator2(n->m_thing, &cpos);
-				}
-				break;										// exit and start over
-			}
-		}
-		// Restart from the beginning if we are sorting
-		if (sortZ && loop) {
-			orderZ = lastZ;
-			lastZ = DBL_MAX;
-			n = sector->touching_thinglist;
-			loop = false;
-		}
-	} while (n);	// repeat from scratch until all things left are marked valid
+	ChangeSectorThings(sector, iterator, iterator2, &cpos, amt < 0);
 
 	if (floorOrCeil != 2) sector->CheckPortalPlane(floorOrCeil);	// check for portal obstructions after everything is done.
 
@@ -9,6 +9,8 @@
 #include "texturemanager.h"
 #include "d_player.h"
 #include "actorinlines.h"
+#include "stats.h"
+#include "c_dispatch.h"
 
 // NL: This is a helper to make sure that the particles are all linked correctly.
 //     If something breaks the chain, it can cause particles to stop updating and spawning
@@ -21,6 +23,22 @@
 static int PARTICLE_COUNT = 0;
 #endif
 
+static cycle_t ParticleThinkCycles, ParticleBucketCycles;
+static int ParticleThinkCount, ParticleBucketMoves, ParticleBucketRelinks;
+
+// Totals for the particlebench command.
+static struct
+{
+	int TicsLeft;
+	int Tics, Frames;
+	double ThinkMS, BucketMS;
+	int64_t Particles, Moved, Relinked;
+} ParticleBench;
+
+static void UnlinkDefinedParticle(FLevelLocals* Level, uint32_t index);
+static void MoveDefinedParticle(FLevelLocals* Level, particledata_t* particle);
+static void ResetDefinedParticleBuckets(FLevelLocals* Level);
+
 // Taken from p_mobj.cpp
 #define WATER_SINK_SPEED		0.5
 
@@ -1158,12 +1176,28 @@ bool DParticleDefinition::CallOnParticleDeath(particledata_t* particle)
 	return result;
 }
 
-void DParticleDefinition::CallThinkParticle(particledata_t* particle)
+// ThinkParticle runs for every live particle each tic, so the override is looked up
+// once per definition. Definitions that don't override it never enter the VM.
+void DParticleDefinition::ResolveThinkParticle()
 {
+	ThinkFunc = nullptr;
+
 	IFVIRTUAL(DParticleDefinition, ThinkParticle)
+	{
+		auto base = RUNTIME_CLASS(DParticleDefinition);
+		if (VIndex >= base->Virtuals.Size() || func != base->Virtuals[VIndex])
+		{
+			ThinkFunc = func;
+		}
+	}
+}
+
+void DParticleDefinition::CallThinkParticle(particledata_t* particle)
+{
+	if (ThinkFunc != nullptr && !HasFlag(PDF_NOTHINK))
 	{
 		VMValue params[] = { this, particle };
-		VMCall(func, params, 2, nullptr, 0);
+		VMCall(ThinkFunc, params, 2, nullptr, 0);
 	}
 }
 
@@ -1415,11 +1449,11 @@ void CheckContinuity(FLevelLocals* Level)
 	particlelevelpool_t& pool = Level->DefinedParticlePool;
 
 	int count = 0;
-	int i = pool.ActiveParticles;
-	int prev = NO_PARTICLE;
+	uint32_t i = pool.ActiveParticles;
+	uint32_t prev = NO_DEFINED_PARTICLE;
 	bool inNoMansLand = false;
 
-	while (i != NO_PARTICLE)
+	while (i != NO_DEFINED_PARTICLE)
 	{
 		if (i == pool.InactiveParticles)
 		{
@@ -1432,7 +1466,7 @@ void CheckContinuity(FLevelLocals* Level)
 		{
 			assert(particle.tprev == prev);
 
-			if (prev != NO_PARTICLE)
+			if (prev != NO_DEFINED_PARTICLE)
 			{
 				assert(pool.Particles[prev].tnext == i);
 			}
@@ -1443,8 +1477,8 @@ void CheckContinuity(FLevelLocals* Level)
 		count++;
 	}
 
-	assert(count == 0 || pool.OldestParticle != NO_PARTICLE);
-	assert(count < pool.Particles.size() || pool.InactiveParticles == NO_PARTICLE);
+	assert(count == 0 || pool.OldestParticle != NO_DEFINED_PARTICLE);
+	assert(count < pool.Particles.size() || pool.InactiveParticles == NO_DEFINED_PARTICLE);
 
 	assert(count == PARTICLE_COUNT);
 }
@@ -1457,26 +1491,26 @@ particledata_t* NewDefinedParticle(FLevelLocals* Level, DParticleDefinition* def
 	particlelevelpool_t& pool = Level->DefinedParticlePool;
 
 	// Array's filled up
-	if (pool.InactiveParticles == NO_PARTICLE)
+	if (pool.InactiveParticles == NO_DEFINED_PARTICLE)
 	{
 		if (replace)
 		{
 			result = &pool.Particles[pool.OldestParticle];
 
-			// There should be NO_PARTICLE for the oldest's tnext
-			if (result->tprev != NO_PARTICLE)
+			// There should be NO_DEFINED_PARTICLE for the oldest's tnext
+			if (result->tprev != NO_DEFINED_PARTICLE)
 			{
 				// tnext: youngest to oldest
 				// tprev: oldest to youngest
 
 				// 2nd oldest -> oldest
 				particledata_t* nbottom = &pool.Particles[result->tprev];
-				nbottom->tnext = NO_PARTICLE;
+				nbottom->tnext = NO_DEFINED_PARTICLE;
 
 				// now oldest becomes youngest
 				pool.OldestParticle = result->tprev;
 				result->tnext = pool.ActiveParticles;
-				result->tprev = NO_PARTICLE;
+				result->tprev = NO_DEFINED_PARTICLE;
 				pool.ActiveParticles = uint32_t(result - pool.Particles.Data());
 
 				// youngest -> 2nd youngest
@@ -1484,12 +1518,14 @@ particledata_t* NewDefinedParticle(FLevelLocals* Level, DParticleDefinition* def
 				ntop->tprev = pool.ActiveParticles;
 			}
 			// [MC] Future proof this by resetting everything when replacing a particle.
+			UnlinkDefinedParticle(Level, uint32_t(result - pool.Particles.Data()));
 			auto tnext = result->tnext;
 			auto tprev = result->tprev;
 			*result = {};
 			result->definition = definition;
 			result->tnext = tnext;
 			result->tprev = tprev;
+			MoveDefinedParticle(Level, result);
 
 #if ENABLE_CONTINUITY_CHECKS
 			CheckContinuity(Level);
@@ -1506,10 +1542,10 @@ particledata_t* NewDefinedParticle(FLevelLocals* Level, DParticleDefinition* def
 	result->master = nullptr;
 	pool.InactiveParticles = result->tnext;
 	result->tnext = current;
-	result->tprev = NO_PARTICLE;
+	result->tprev = NO_DEFINED_PARTICLE;
 	pool.ActiveParticles = uint32_t(result - pool.Particles.Data());
 
-	if (current != NO_PARTICLE) // More than one active particles
+	if (current != NO_DEFINED_PARTICLE) // More than one active particles
 	{
 		particledata_t* next = &pool.Particles[current];
 		next->tprev = pool.ActiveParticles;
@@ -1519,6 +1555,8 @@ particledata_t* NewDefinedParticle(FLevelLocals* Level, DParticleDefinition* def
 		pool.OldestParticle = pool.ActiveParticles;
 	}
 
+	MoveDefinedParticle(Level, result);
+
 #if ENABLE_CONTINUITY_CHECKS
 	PARTICLE_COUNT++;
 	CheckContinuity(Level);
@@ -1543,6 +1581,7 @@ void P_InitParticleDefinitions(FLevelLocals* Level)
 			definition->cvarParticleLifespan = FindCVar("r_particlelifespan", nullptr);
 			definition->cvarBloodQuality = FindCVar("r_bloodquality", nullptr);
 			definition->CallInit();
+			definition->ResolveThinkParticle();
 
 			Level->ParticleDefinitionsByType.Insert(cls->TypeName.GetIndex(), definition);
 		}
@@ -1563,8 +1602,8 @@ void P_ClearAllDefinedParticles(FLevelLocals* Level)
 	particlelevelpool_t& pool = Level->DefinedParticlePool;
 
 	int i = 0;
-	pool.OldestParticle = NO_PARTICLE;
-	pool.ActiveParticles = NO_PARTICLE;
+	pool.OldestParticle = NO_DEFINED_PARTICLE;
+	pool.ActiveParticles = NO_DEFINED_PARTICLE;
 	pool.InactiveParticles = 0;
 	for (auto& p : pool.Particles)
 	{
@@ -1572,8 +1611,10 @@ void P_ClearAllDefinedParticles(FLevelLocals* Level)
 		p.tprev = i - 1;
 		p.tnext = ++i;
 	}
-	pool.Particles.Last().tnext = NO_PARTICLE;
-	pool.Particles.Data()->tprev = NO_PARTICLE;
+	pool.Particles.Last().tnext = NO_DEFINED_PARTICLE;
+	pool.Particles.Data()->tprev = NO_DEFINED_PARTICLE;
+
+	ResetDefinedParticleBuckets(Level);
 }
 
 void P_DestroyAllParticleDefinitions(FLevelLocals* Level)
@@ -1587,6 +1628,8 @@ void P_DestroyAllParticleDefinitions(FLevelLocals* Level)
 
 	Level->ParticleDefinitionsByType.Clear();
 	Level->DefinedParticlePool.Particles.Clear();
+	Level->DefinedParticlesInSubsec.Clear();
+	Level->DefinedParticlesMoved.Clear();
 }
 
 void P_ResizeDefinedParticlePool(FLevelLocals* Level, int particleLimit)
@@ -1595,9 +1638,9 @@ void P_ResizeDefinedParticlePool(FLevelLocals* Level, int particleLimit)
 	TArray<particledata_t> newParticles(particleLimit, true);
 
 	int added = 0;
-	int oldestParticle = NO_PARTICLE;
+	uint32_t oldestParticle = NO_DEFINED_PARTICLE;
 
-	for (uint16_t i = pool.ActiveParticles; i != NO_PARTICLE; i = pool.Particles[i].tnext)
+	for (uint32_t i = pool.ActiveParticles; i != NO_DEFINED_PARTICLE; i = pool.Particles[i].tnext)
 	{
 		if (added >= particleLimit)
 		{
@@ -1610,20 +1653,20 @@ void P_ResizeDefinedParticlePool(FLevelLocals* Level, int particleLimit)
 
 		particle = pool.Particles[i];
 		particle.tprev = added - 1;
-		particle.tnext = (particle.tnext != NO_PARTICLE) ? (added + 1) : NO_PARTICLE;
+		particle.tnext = (particle.tnext != NO_DEFINED_PARTICLE) ? (added + 1) : NO_DEFINED_PARTICLE;
 
 		added++;
 	}
 
-	assert(oldestParticle != NO_PARTICLE || added == 0);
+	assert(oldestParticle != NO_DEFINED_PARTICLE || added == 0);
 
 #if ENABLE_CONTINUITY_CHECKS
 	PARTICLE_COUNT = added;
 #endif
 
 	pool.OldestParticle = oldestParticle;
-	pool.ActiveParticles = added > 0 ? 0 : NO_PARTICLE;
-	pool.InactiveParticles = added < particleLimit ? added : NO_PARTICLE;
+	pool.ActiveParticles = added > 0 ? 0 : NO_DEFINED_PARTICLE;
+	pool.InactiveParticles = added < particleLimit ? added : NO_DEFINED_PARTICLE;
 
 	for (; added < particleLimit; added++)
 	{
@@ -1633,45 +1676,113 @@ void P_ResizeDefinedParticlePool(FLevelLocals* Level, int particleLimit)
 		particle.tnext = added + 1;
 	}
 
-	newParticles.Last().tnext = NO_PARTICLE;
-	newParticles.Data()->tprev = NO_PARTICLE;
+	newParticles.Last().tnext = NO_DEFINED_PARTICLE;
+	newParticles.Data()->tprev = NO_DEFINED_PARTICLE;
 
 	Level->DefinedParticlePool.Particles = newParticles;
+	ResetDefinedParticleBuckets(Level);
 
 #if ENABLE_CONTINUITY_CHECKS
 	CheckContinuity(Level);
 #endif
 }
 
-// Group particles by subsectors. Because particles are always
-// in motion, there is little benefit to caching this information
-// from one frame to the next.
-// [MC] VisualThinkers hitches a ride here
+// Particles are filed into dense per subsector lists for the renderer.
+// Most particles are resting or asleep at any given time, so instead of
+// rebuilding the lists every frame only the particles that were spawned or
+// changed subsectors since the last frame get moved.
 
-void P_FindDefinedParticleSubsectors(FLevelLocals* Level)
+static void UnlinkDefinedParticle(FLevelLocals* Level, uint32_t index)
 {
-	if (Level->DefinedParticlesInSubsec.Size() < Level->subsectors.Size())
+	particledata_t& particle = Level->DefinedParticlePool.Particles[index];
+	if (particle.bucket < 0)
 	{
-		Level->DefinedParticlesInSubsec.Reserve(Level->subsectors.Size() - Level->DefinedParticlesInSubsec.Size());
+		return;
+	}
+
+	// Swap with the last entry so that the list stays dense.
+	TArray<uint32_t>& bucket = Level->DefinedParticlesInSubsec[particle.bucket];
+	uint32_t last = bucket.Last();
+	bucket[particle.bucketSlot] = last;
+	Level->DefinedParticlePool.Particles[last].bucketSlot = particle.bucketSlot;
+	bucket.Pop();
+	particle.bucket = -1;
+}
+
+static void MoveDefinedParticle(FLevelLocals* Level, particledata_t* particle)
+{
+	Level->DefinedParticlesMoved.Push(uint32_t(particle - Level->DefinedParticlePool.Particles.Data()));
+}
+
+// For when particles changed their index or were loaded, which invalidates all the lists.
+static void ResetDefinedParticleBuckets(FLevelLocals* Level)
+{
+	particlelevelpool_t& pool = Level->DefinedParticlePool;
+
+	for (auto& bucket : Level->DefinedParticlesInSubsec)
+	{
+		bucket.Clear();
 	}
+	Level->DefinedParticlesMoved.Clear();
 
-	uint16_t* b2 = &Level->DefinedParticlesInSubsec[0];
-	for (size_t i = 0; i < Level->DefinedParticlesInSubsec.Size(); ++i)
+	for (auto& particle : pool.Particles)
+	{
+		particle.bucket = -1;
+	}
+	for (uint32_t i = pool.ActiveParticles; i != NO_DEFINED_PARTICLE; i = pool.Particles[i].tnext)
 	{
-		b2[i] = NO_PARTICLE;
+		Level->DefinedParticlesMoved.Push(i);
 	}
+}
 
-	fillshort(&Level->DefinedParticlesInSubsec[0], Level->subsectors.Size(), NO_PARTICLE);
+void P_FindDefinedParticleSubsectors(FLevelLocals* Level)
+{
+	ParticleBucketCycles.Reset();
+	ParticleBucketCycles.Clock();
+
+	if (Level->DefinedParticlesInSubsec.Size() != Level->subsectors.Size())
+	{
+		Level->DefinedParticlesInSubsec.Resize(Level->subsectors.Size());
+		ResetDefinedParticleBuckets(Level);
+	}
 
 	particlelevelpool_t& pool = Level->DefinedParticlePool;
+	int relinks = 0;
 
-	for (uint16_t i = pool.ActiveParticles; i != NO_PARTICLE; i = pool.Particles[i].tnext)
+	for (uint32_t i : Level->DefinedParticlesMoved)
 	{
+		particledata_t& particle = pool.Particles[i];
+
+		// Destroyed since it was queued.
+		if (particle.definition == nullptr)
+		{
+			continue;
+		}
+
 		// Try to reuse the subsector from the last portal check, if still valid.
-		if (pool.Particles[i].subsector == nullptr) pool.Particles[i].subsector = Level->PointInRenderSubsector(pool.Particles[i].pos);
-		int ssnum = pool.Particles[i].subsector->Index();
-		pool.Particles[i].snext = Level->DefinedParticlesInSubsec[ssnum];
-		Level->DefinedParticlesInSubsec[ssnum] = i;
+		if (particle.subsector == nullptr) particle.subsector = Level->PointInRenderSubsector(particle.pos);
+		int ssnum = particle.subsector->Index();
+		if (ssnum != particle.bucket)
+		{
+			UnlinkDefinedParticle(Level, i);
+			particle.bucket = ssnum;
+			particle.bucketSlot = Level->DefinedParticlesInSubsec[ssnum].Push(i);
+			relinks++;
+		}
+	}
+
+	ParticleBucketMoves = Level->DefinedParticlesMoved.Size();
+	ParticleBucketRelinks = relinks;
+	Level->DefinedParticlesMoved.Clear();
+
+	ParticleBucketCycles.Unclock();
+
+	if (ParticleBench.TicsLeft > 0)
+	{
+		ParticleBench.Frames++;
+		ParticleBench.BucketMS += ParticleBucketCycles.TimeMS();
+		ParticleBench.Moved += ParticleBucketMoves;
+		ParticleBench.Relinked += ParticleBucketRelinks;
 	}
 }
 
@@ -1685,12 +1796,14 @@ bool P_DestroyDefinedParticle(FLevelLocals* Level, int particleIndex)
 		return false;
 	}
 
-	if (particle.tprev != NO_PARTICLE)
+	UnlinkDefinedParticle(Level, particleIndex);
+
+	if (particle.tprev != NO_DEFINED_PARTICLE)
 		pool.Particles[particle.tprev].tnext = particle.tnext;
 	else
 		pool.ActiveParticles = particle.tnext;
 
-	if (particle.tnext != NO_PARTICLE)
+	if (particle.tnext != NO_DEFINED_PARTICLE)
 	{
 		particledata_t& next = pool.Particles[particle.tnext];
 		next.tprev = particle.tprev;
@@ -1715,6 +1828,9 @@ bool P_DestroyDefinedParticle(FLevelLocals* Level, int particleIndex)
 
 void P_ThinkDefinedParticles(FLevelLocals* Level)
 {
+	ParticleThinkCycles.Reset();
+	ParticleThinkCycles.Clock();
+
 	particlelevelpool_t* pool = &Level->DefinedParticlePool;
 
 	int particleCount = 0;
@@ -1726,9 +1842,9 @@ void P_ThinkDefinedParticles(FLevelLocals* Level)
 		P_ResizeDefinedParticlePool(Level, particleLimit);
 	}
 
-	int i = pool->ActiveParticles;
+	uint32_t i = pool->ActiveParticles;
 	particledata_t* particle = nullptr;
-	while (i != NO_PARTICLE)
+	while (i != NO_DEFINED_PARTICLE)
 	{
 		particle = &pool->Particles[i];
 		DParticleDefinition* definition = particle->definition;
@@ -1829,10 +1945,19 @@ void P_ThinkDefinedParticles(FLevelLocals* Level)
 		double movex = (particle->pos.X - particle->prevpos.X) + particle->vel.X;
 		double movey = (particle->pos.Y - particle->prevpos.Y) + particle->vel.Y;
 		DVector2 newxy = Level->GetPortalOffsetPosition(particle->prevpos.X, particle->prevpos.Y, movex, movey);
+		bool movedxy = particle->subsector == nullptr || newxy != particle->prevpos.XY();
 		particle->pos.X = newxy.X;
 		particle->pos.Y = newxy.Y;
 
-		particle->subsector = Level->PointInRenderSubsector(particle->pos);
+		if (movedxy)
+		{
+			subsector_t* subsector = Level->PointInRenderSubsector(particle->pos);
+			if (subsector != particle->subsector)
+			{
+				particle->subsector = subsector;
+				MoveDefinedParticle(Level, particle);
+			}
+		}
 		sector_t* s = particle->subsector->sector;
 
 		if (particle->gravity != 0)
@@ -1897,6 +2022,7 @@ void P_ThinkDefinedParticles(FLevelLocals* Level)
 			{
 				particle->pos += s->GetPortalDisplacement(sector_t::ceiling);
 				particle->subsector = NULL;
+				MoveDefinedParticle(Level, particle);
 			}
 		}
 		else if (!s->PortalBlocksMovement(sector_t::floor))
@@ -1905,6 +2031,7 @@ void P_ThinkDefinedParticles(FLevelLocals* Level)
 			{
 				particle->pos += s->GetPortalDisplacement(sector_t::floor);
 				particle->subsector = NULL;
+				MoveDefinedParticle(Level, particle);
 			}
 		}
 
@@ -2064,6 +2191,51 @@ void P_ThinkDefinedParticles(FLevelLocals* Level)
 
 		particleCount++;
 	}
+
+	ParticleThinkCount = particleCount;
+	ParticleThinkCycles.Unclock();
+
+	if (ParticleBench.TicsLeft > 0)
+	{
+		ParticleBench.Tics++;
+		ParticleBench.ThinkMS += ParticleThinkCycles.TimeMS();
+		ParticleBench.Particles += particleCount;
+		if (--ParticleBench.TicsLeft == 0)
+		{
+			auto &b = ParticleBench;
+			int frames = std::max(b.Frames, 1);
+			Printf("Particles over %d tics and %d frames:\n", b.Tics, b.Frames);
+			Printf("  %.1f active per tic, think time %.3f ms per tic\n", double(b.Particles) / b.Tics, b.ThinkMS / b.Tics);
+			Printf("  %.1f moved and %.1f relinked per frame (%.1f%% of the active ones), bucketing %.3f ms per frame\n",
+				double(b.Moved) / frames, double(b.Relinked) / frames,
+				b.Particles > 0 ? 100. * b.Relinked / frames / (double(b.Particles) / b.Tics) : 0., b.BucketMS / frames);
+		}
+	}
+}
+
+ADD_STAT(particlepool)
+{
+	FString out;
+	out.Format("Think time = %04.2f ms - %d particles, Bucketing = %04.2f ms - %d moved, %d relinked",
+		ParticleThinkCycles.TimeMS(), ParticleThinkCount, ParticleBucketCycles.TimeMS(), ParticleBucketMoves, ParticleBucketRelinks);
+	return out;
+}
+
+//==========================================================================
+//
+// particlebench [tics]
+//
+// Averages the pooled particle think and bucketing times over a number of
+// tics, along with how many of the active particles change subsectors.
+//
+//==========================================================================
+
+CCMD(particlebench)
+{
+	int tics = argv.argc() > 1 ? (int)strtol(argv[1], nullptr, 0) : TICRATE * 10;
+	ParticleBench = {};
+	ParticleBench.TicsLeft = std::max(tics, 1);
+	Printf("Measuring particles for %d tics\n", ParticleBench.TicsLeft);
 }
 
 particledata_t* P_SpawnDefinedParticle(FLevelLocals* Level, DParticleDefinition* definition, const DVector3& pos, const DVector3& vel, double scale, int flags, AActor* refActor)
@@ -2137,8 +2309,8 @@ void P_LoadDefinedParticles(FSerializer& arc, FLevelLocals* Level, const char* k
 	ParticleDefinitionLoadingLevel = nullptr;
 
 	// Go through all the particles and destroy any that are lacking a definition
-	int i = pool.ActiveParticles;
-	while (i != NO_PARTICLE)
+	uint32_t i = pool.ActiveParticles;
+	while (i != NO_DEFINED_PARTICLE)
 	{
 		particledata_t& particle = pool.Particles[i];
 	
@@ -2150,6 +2322,8 @@ void P_LoadDefinedParticles(FSerializer& arc, FLevelLocals* Level, const char* k
 			P_DestroyDefinedParticle(Level, particleIndex);
 		}
 	}
+
+	ResetDefinedParticleBuckets(Level);
 }
 
 
@@ -2162,7 +2336,7 @@ FSerializer& Serialize(FSerializer& arc, const char* key, particlelevelpool_t& l
 			if (arc.isWriting())
 			{
 				// Write out the particles from newest to oldest and then stop, so we only store the particles we *need*
-				for (uint16_t i = lp.ActiveParticles; i != NO_PARTICLE; i = lp.Particles[i].tnext)
+				for (uint32_t i = lp.ActiveParticles; i != NO_DEFINED_PARTICLE; i = lp.Particles[i].tnext)
 				{
 					particledata_t& p = lp.Particles[i];
 					arc(nullptr, p);
@@ -2172,8 +2346,8 @@ FSerializer& Serialize(FSerializer& arc, const char* key, particlelevelpool_t& l
 			{
 				unsigned int count = min(arc.ArraySize(), lp.Particles.Size());
 
-				lp.OldestParticle = NO_PARTICLE;
-				lp.ActiveParticles = count > 0 ? 0 : NO_PARTICLE;
+				lp.OldestParticle = NO_DEFINED_PARTICLE;
+				lp.ActiveParticles = count > 0 ? 0 : NO_DEFINED_PARTICLE;
 				lp.InactiveParticles = 0;
 
 				for (unsigned int i = 0; i < count; i++)
@@ -2182,11 +2356,11 @@ FSerializer& Serialize(FSerializer& arc, const char* key, particlelevelpool_t& l
 					arc(nullptr, p);
 
 					// Since the particles are stored newest-to-oldest, we can figure out the tprev and tnext
-					p.tprev = i > 0 ? i - 1 : NO_PARTICLE;
-					p.tnext = i < count - 1 ? i + 1 : NO_PARTICLE;
+					p.tprev = i > 0 ? i - 1 : NO_DEFINED_PARTICLE;
+					p.tnext = i < count - 1 ? i + 1 : NO_DEFINED_PARTICLE;
 
 					lp.OldestParticle = i;
-					lp.InactiveParticles = i < lp.Particles.Size() - 1 ? i + 1 : NO_PARTICLE;
+					lp.InactiveParticles = i < lp.Particles.Size() - 1 ? i + 1 : NO_DEFINED_PARTICLE;
 				}
 
 #if ENABLE_CONTINUITY_CHECKS
@@ -2264,7 +2438,7 @@ FSerializer& Serialize(FSerializer& arc, const char* key, particledata_t& p, par
 			("user3", p.user3)
 			("user4", p.user4)
 			// Deliberately not saving tprev or tnext, since they're calculated during load
-			// Deliberately not saving subsector or snext, since they're calculated every frame.
+			// Deliberately not saving subsector or bucket, since they're recalculated after loading.
 			.EndObject();
 	}
 	return arc;
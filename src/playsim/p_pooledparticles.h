@@ -14,6 +14,9 @@
 
 class DParticleDefinition;
 
+// The pool is linked through 32 bit indices, so unlike the classic particles it is not limited to 64k entries.
+const uint32_t NO_DEFINED_PARTICLE = 0xffffffff;
+
 enum EParticleDefinitionFlags
 {
 	PDF_KILLSTOP				= 1 << 0,	// Kill the particle when it stops moving
@@ -108,10 +111,11 @@ struct particledata_t
 	uint16_t sleepFor;							// +2
 	uint32_t flags;								// +4 
 	int user1, user2, user3, user4;				// +16
-	uint16_t tnext, tprev;						// +4 
+	uint32_t tnext, tprev;						// +8 
 
 	subsector_t* subsector;						// +8 
-	uint16_t snext;								// +2 
+	int32_t bucket = -1;						// +4 Subsector this particle is filed under in DefinedParticlesInSubsec
+	uint32_t bucketSlot;						// +4 
 
 	void Init(FLevelLocals* Level, DVector3 initialPos);
 
@@ -211,6 +215,7 @@ public:
 	void Emit(AActor* master, double chance, int numTries, double angle, double pitch, double speed, DVector3 offset, DVector3 velocity, int flags, float scaleBoost, int particleSpawnOffsets, float particleLifetimeModifier, float additionalAngleScale, float additionalAngleChance);
 
 	void CallInit();
+	void ResolveThinkParticle();
 	void CallOnCreateParticle(particledata_t* particle);
 	bool CallOnParticleDeath(particledata_t* particle);
 	void CallThinkParticle(particledata_t* particle);
@@ -237,6 +242,7 @@ public:
 	void ClearFlag(EParticleDefinitionFlags flag) { Flags &= ~flag; }
 
 	FLevelLocals* Level;
+	VMFunction* ThinkFunc = nullptr;	// Scripted ThinkParticle override, null if there is nothing to call
 	FBaseCVar* cvarParticleIntensity;
 	FBaseCVar* cvarParticleLifespan;
 	FBaseCVar* cvarBloodQuality;
@@ -32,6 +32,8 @@
 #include "v_video.h"
 #include "hwrenderer/scene/hw_drawstructs.h"
 #include "r_utility.h"	// For R_GetLookYaw/Pitch()
+#include "g_levellocals.h"
+#include "hw_clock.h"
 
 // If we want to share the array to avoid constant allocations it needs to be thread local unless it'd be littered with expensive synchronization.
 thread_local FDynLightData lightdata;
@@ -72,10 +74,11 @@ bool GetLight(FDynLightData& dld, int group, Plane & p, FDynamicLight * light, b
 
 //==========================================================================
 //
-// Add one dynamic light to the light data list
+// Packs one dynamic light into the 4 vec4's the shaders expect
+// and returns the light list array it belongs to.
 //
 //==========================================================================
-void AddLightToList(FDynLightData &dld, int group, FDynamicLight * light, bool forceAttenuate, double ticFrac = 1.0)
+static int PackLight(float *data, int group, FDynamicLight * light, bool forceAttenuate, double ticFrac)
 {
 	int i = 0;
 
@@ -159,7 +162,6 @@ void AddLightToList(FDynLightData &dld, int group, FDynamicLight * light, bool f
 		spotDirZ = float(-Angle.Sin() * xzLen);
 	}
 
-	float *data = &dld.arrays[i][dld.arrays[i].Reserve(16)];
 	data[0] = float(pos.X);
 	data[1] = float(pos.Z);
 	data[2] = float(pos.Y);
@@ -176,5 +178,64 @@ void AddLightToList(FDynLightData &dld, int group, FDynamicLight * light, bool f
 	data[13] = spotOuterAngle;
 	data[14] = 0.0f; // unused
 	data[15] = 0.0f; // unused
+	return i;
 }
 
+//==========================================================================
+//
+// Lights get packed on their first AddLightToList in a viewpoint, so the
+// many surfaces a light touches only need to copy the result, and lights
+// that touch nothing visible cost nothing.
+//
+// The main thread and the worker thread may both add lights. Whoever
+// claims a light's lock packs it and publishes packedFrame afterward.
+// The data does not change again in this viewpoint, so readers that see
+// the current frame can copy it without locking. If the lock is taken,
+// the light gets packed locally instead of waiting.
+//
+//==========================================================================
+static unsigned packCounter;
+
+// Must be called on the main thread before a viewpoint's scene processing starts.
+void hw_InvalidatePackedLights()
+{
+	packCounter++;
+}
+
+//==========================================================================
+//
+// Add one dynamic light to the light data list
+//
+//==========================================================================
+void AddLightToList(FDynLightData &dld, int group, FDynamicLight * light, bool forceAttenuate, double ticFrac = 1.0)
+{
+	unsigned frame = light->packedFrame.load(std::memory_order_acquire);
+	bool reused = frame == packCounter;
+	if (frame != packCounter && light->Sector != nullptr && group == light->Sector->PortalGroup && !light->packLock.exchange(true, std::memory_order_acquire))
+	{
+		if (light->packedFrame.load(std::memory_order_relaxed) != packCounter)
+		{
+			light->packedArray = PackLight(light->packedData, group, light, false, ticFrac);
+			light->packedGroup = group;
+			light->packedTicFrac = ticFrac;
+			light->packedFrame.store(packCounter, std::memory_order_release);
+		}
+		light->packLock.store(false, std::memory_order_release);
+		frame = packCounter;
+	}
+
+	if (frame == packCounter && light->packedGroup == group && light->packedTicFrac == ticFrac)
+	{
+		int i = light->packedArray;
+		float *data = &dld.arrays[i][dld.arrays[i].Reserve(16)];
+		memcpy(data, light->packedData, 16 * sizeof(float));
+		// The attenuate flag is stored in the sign bit of the shadowmap index.
+		if (forceAttenuate && data[7] > 0) data[7] = -data[7];
+		if (reused) cached_dlight.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	float data[16];
+	int i = PackLight(data, group, light, forceAttenuate, ticFrac);
+	memcpy(&dld.arrays[i][dld.arrays[i].Reserve(16)], data, 16 * sizeof(float));
+}
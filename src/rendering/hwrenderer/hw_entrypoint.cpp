@@ -51,6 +51,7 @@
 #include "hwrenderer/scene/hw_clipper.h"
 #include "hwrenderer/scene/hw_portal.h"
 #include "hw_vrmodes.h"
+#include "hw_residency.h"
 
 EXTERN_CVAR(Bool, cl_capfps)
 extern bool NoInterpolateView;
@@ -131,6 +132,11 @@ sector_t* RenderViewpoint(FRenderViewpoint& mainvp, AActor* camera, IntRect* bou
 	// This function will only do something if the setting differs.
 	FLightDefaults::SetAttenuationForLevel(!!(camera->Level->flags3 & LEVEL3_ATTENUATE));
 
+	// The shader data of a light only needs to be calculated once for all surfaces in this viewpoint.
+	hw_InvalidatePackedLights();
+
+	if (mainview && toscreen) hw_UpdateTextureResidency(camera->Level, camera);
+
 	// Render (potentially) multiple views for stereo 3d
 	// Fixme. The view offsetting should be done with a static table and not require setup of the entire render state for the mode.
 	auto vrmode = VRMode::GetVRMode(mainview && toscreen);
@@ -150,6 +156,7 @@ sector_t* RenderViewpoint(FRenderViewpoint& mainvp, AActor* camera, IntRect* bou
 		}
 
 		auto di = HWDrawInfo::StartDrawInfo(mainvp.ViewLevel, nullptr, mainvp, nullptr);
+		di->MarkRendered = mainview && toscreen && eye_ix == 0;
 		auto& vp = di->Viewpoint;
 
 		di->Set3DViewport(RenderState);
@@ -336,7 +343,7 @@ sector_t* RenderView(player_t* player)
 	{
 		hw_ClearFakeFlat();
 
-		iter_dlightf = iter_dlight = draw_dlight = draw_dlightf = 0;
+		iter_dlightf = iter_dlight = draw_dlight = draw_dlightf = cached_dlight = 0;
 
 		checkBenchActive();
 
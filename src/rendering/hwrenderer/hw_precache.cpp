@@ -40,6 +40,8 @@
 #include "modelrenderer.h"
 #include "hw_models.h"
 #include "d_main.h"
+#include "hw_residency.h"
+#include "g_precache.h"
 
 EXTERN_CVAR(Bool, gl_precache)
 EXTERN_CVAR(Bool, gl_precache_actors)
@@ -112,6 +114,26 @@ static void PrecacheSprite(FGameTexture *tex, SpriteHits &hits)
 	}
 }
 
+//==========================================================================
+//
+// Textures the precache manifest says were used go to the background
+// loader, so they are set up the same way as when they get drawn.
+//
+//==========================================================================
+
+static void PrequeueManifestTexture(FGameTexture *tex)
+{
+	if (tex == nullptr || !tex->isValid()) return;
+
+	auto useType = tex->GetUseType();
+	bool sprite = useType == ETextureType::Sprite || useType == ETextureType::SkinSprite || useType == ETextureType::Decal;
+	int scaleflags = sprite ? CTF_Expand : 0;
+	if (shouldUpscale(tex, sprite ? UF_Sprite : UF_Texture)) scaleflags |= CTF_Upscale;
+
+	FMaterial *gltex = FMaterial::ValidateTexture(tex, scaleflags);
+	if (gltex && !gltex->IsHardwareCached(0)) screen->PrequeueMaterial(gltex, 0);
+}
+
 
 // @Cockatrice - Used to unload sprites after texture quality has changed
 void hw_unloadQualitySprites() {
@@ -344,6 +366,12 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 	}
 
 	
+	// Models that were used here last time are kept, and loaded in the background if possible.
+	for (auto &entry : LevelPrecacheManifest.Models)
+	{
+		if (!modellist[entry.Index]) modellist[entry.Index] = screen->SupportsBackgroundCache() ? 2 : 1;
+	}
+
 	// delete everything unused before creating any new resources to avoid memory usage peaks.
 
 	// delete unused models
@@ -440,6 +468,18 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 			}
 		}
 
+		// Whatever was used here last time gets queued first, in the order it was first needed.
+		// The guessed sprites below are queued after it.
+		if (screen->SupportsBackgroundCache())
+		{
+			for (auto &entry : LevelPrecacheManifest.Textures)
+			{
+				// Walls and flats get loaded right away below.
+				if (texhitlist[entry.Index] & (FTextureManager::HIT_Wall | FTextureManager::HIT_Flat | FTextureManager::HIT_Sky)) continue;
+				PrequeueManifestTexture(TexMan.GameByIndex(entry.Index));
+			}
+		}
+
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
 		{
@@ -462,11 +502,16 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 		FModelRenderer* renderer = new FHWModelRenderer(nullptr, *screen->RenderState(), -1);
 		for (unsigned i = 0; i < Models.Size(); i++)
 		{
-			if (modellist[i]) 
+			if (modellist[i] == 1) 
 				Models[i]->BuildVertexBuffer(renderer);
 		}
 		delete renderer;
 
+		for (auto &entry : LevelPrecacheManifest.Models)
+		{
+			if (modellist[entry.Index] == 2) screen->BackgroundLoadModel(Models[entry.Index]);
+		}
+
 		precache.Unclock();
 		DPrintf(DMSG_NOTIFY, "Textures precached in %.3f ms\n", precache.TimeMS());
 	}
@@ -474,5 +519,7 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 	delete[] spritehitlist;
 	delete[] spritelist;
 	delete[] modellist;
+
+	hw_ResetTextureResidency();
 }
 
@@ -0,0 +1,364 @@
+//
+//---------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//--------------------------------------------------------------------------
+//
+/*
+** Texture residency management
+**
+*/
+
+#include <algorithm>
+#include "c_cvars.h"
+#include "stats.h"
+#include "doomstat.h"
+#include "g_levellocals.h"
+#include "actor.h"
+#include "texturemanager.h"
+#include "hw_material.h"
+#include "v_video.h"
+#include "hw_drawinfo.h"
+#include "hw_residency.h"
+
+CVAR(Bool, gl_texture_residency, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Int, gl_texture_budget, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)			// in MB, 0 never evicts
+CVAR(Int, gl_texture_prefetch_depth, 3, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// in sectors away from the player
+
+void hw_unloadTexture(FGameTexture* tex);
+
+// Only this many tics between updates, the areas around the player do not change faster than that.
+#define RESIDENCY_INTERVAL		4
+
+// How far ahead of the player's movement to look for the area to prefetch.
+#define RESIDENCY_LOOKAHEAD		(TICRATE / 2)
+
+// Limits how much gets handed to the background loader per update.
+#define RESIDENCY_MAXPREFETCH	32
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FTextureResidency::Reset()
+{
+	Entries.Clear();
+	Requested.Clear();
+	ResidentBytes = 0;
+	Counts = {};
+}
+
+void FTextureResidency::BeginUpdate(int time)
+{
+	Time = time;
+	UpdateCount++;
+	Requested.Clear();
+}
+
+void FTextureResidency::Request(int texture, int distance)
+{
+	if (texture <= 0) return;
+	if ((unsigned)texture >= Entries.Size()) Entries.Resize(texture + 1);
+
+	Entry &entry = Entries[texture];
+	if (entry.Update != UpdateCount)
+	{
+		entry.Update = UpdateCount;
+		entry.Distance = distance;
+		Requested.Push(texture);
+	}
+	else
+	{
+		entry.Distance = std::min(entry.Distance, distance);
+	}
+	entry.LastUsed = Time;
+}
+
+void FTextureResidency::Track(int texture)
+{
+	Entry &entry = Entries[texture];
+	if (!entry.Tracked)
+	{
+		entry.Tracked = true;
+		entry.Size = Backend.GetSize(texture);
+		ResidentBytes += entry.Size;
+	}
+}
+
+//==========================================================================
+//
+// Prefetches what is missing, nearest first, then brings the resident
+// set back under the budget.
+//
+//==========================================================================
+
+void FTextureResidency::EndUpdate(int maxprefetch)
+{
+	TArray<int> missing;
+
+	for (int texture : Requested)
+	{
+		Entry &entry = Entries[texture];
+		if (Backend.IsResident(texture))
+		{
+			Counts.Hits++;
+			Track(texture);
+		}
+		else
+		{
+			Counts.Misses++;
+			if (entry.Distance == 0) Counts.Stalls++;
+
+			// Something else may have unloaded it.
+			if (entry.Tracked)
+			{
+				entry.Tracked = false;
+				ResidentBytes -= entry.Size;
+			}
+			missing.Push(texture);
+		}
+	}
+
+	std::stable_sort(missing.begin(), missing.end(), [&](int a, int b) { return Entries[a].Distance < Entries[b].Distance; });
+	for (unsigned i = 0; i < missing.Size() && (int)i < maxprefetch; i++)
+	{
+		if (Backend.Prefetch(missing[i]))
+		{
+			Track(missing[i]);
+			Counts.Prefetches++;
+		}
+	}
+
+	EvictOverBudget();
+}
+
+void FTextureResidency::EvictOverBudget()
+{
+	if (Budget == 0 || ResidentBytes <= Budget) return;
+
+	// Whatever was requested in this update is needed right now and stays.
+	TArray<int> candidates;
+	for (unsigned i = 0; i < Entries.Size(); i++)
+	{
+		if (Entries[i].Tracked && Entries[i].Update != UpdateCount) candidates.Push(i);
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](int a, int b) { return Entries[a].LastUsed < Entries[b].LastUsed; });
+
+	for (unsigned i = 0; i < candidates.Size() && ResidentBytes > Budget; i++)
+	{
+		Entry &entry = Entries[candidates[i]];
+		Backend.Evict(candidates[i]);
+		entry.Tracked = false;
+		ResidentBytes -= entry.Size;
+		Counts.Evictions++;
+	}
+}
+
+//==========================================================================
+//
+// Backend for the hardware renderers. Only walls and flats are handled,
+// sprites are loaded by the background loader when they get drawn.
+//
+//==========================================================================
+
+class FHWResidencyBackend : public IResidencyBackend
+{
+	static FMaterial *GetMaterial(int texture, bool create)
+	{
+		auto tex = TexMan.GameByIndex(texture);
+		if (tex == nullptr || !tex->isValid()) return nullptr;
+		int scaleflags = shouldUpscale(tex, UF_Texture) ? CTF_Upscale : 0;
+		return FMaterial::ValidateTexture(tex, scaleflags, create);
+	}
+
+public:
+	bool IsResident(int texture) override
+	{
+		auto mat = GetMaterial(texture, false);
+		return mat != nullptr && mat->IsHardwareCached(0);
+	}
+
+	size_t GetSize(int texture) override
+	{
+		auto tex = TexMan.GameByIndex(texture);
+		if (tex == nullptr) return 0;
+		// 32 bit texels plus a third for the mipmaps.
+		return size_t(tex->GetTexelWidth()) * tex->GetTexelHeight() * 4 * 4 / 3;
+	}
+
+	bool Prefetch(int texture) override
+	{
+		// Loading on the main thread would just be the stall this is meant to avoid.
+		if (!screen->SupportsBackgroundCache()) return false;
+		auto mat = GetMaterial(texture, true);
+		if (mat == nullptr) return false;
+		screen->BackgroundCacheMaterial(mat, NO_TRANSLATION);
+		return true;
+	}
+
+	void Evict(int texture) override
+	{
+		hw_unloadTexture(TexMan.GameByIndex(texture));
+	}
+};
+
+static FHWResidencyBackend HWResidencyBackend;
+static FTextureResidency Residency(HWResidencyBackend);
+static TArray<int> SectorDistance;
+static TArray<sector_t *> SectorQueue;
+static TArray<uint8_t> SectorRendered;		// drawn by the main view since the last update
+static int LastUpdate = -1;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void RequestSectorTextures(sector_t *sec, int distance)
+{
+	Residency.Request(sec->GetTexture(sector_t::floor).GetIndex(), distance);
+	Residency.Request(sec->GetTexture(sector_t::ceiling).GetIndex(), distance);
+
+	for (auto line : sec->Lines)
+	{
+		for (auto side : line->sidedef)
+		{
+			if (side == nullptr) continue;
+			for (int i = side_t::top; i <= side_t::bottom; i++)
+			{
+				Residency.Request(side->GetTexture(i).GetIndex(), distance);
+			}
+		}
+	}
+}
+
+static void VisitSector(sector_t *sec, int distance)
+{
+	if (sec != nullptr && SectorDistance[sec->Index()] < 0)
+	{
+		SectorDistance[sec->Index()] = distance;
+		SectorQueue.Push(sec);
+	}
+}
+
+//==========================================================================
+//
+// Called for the main view's drawinfo and each of its portals' before they
+// are released. A texture on screen must not be evicted just because the
+// wall is further away than the prefetch depth.
+//
+//==========================================================================
+
+void hw_MarkRenderedSectors(HWDrawInfo *di)
+{
+	if (!gl_texture_residency) return;
+
+	auto Level = di->Level;
+	if (SectorRendered.Size() != Level->sectors.Size())
+	{
+		SectorRendered.Resize(Level->sectors.Size());
+		memset(SectorRendered.Data(), 0, SectorRendered.Size());
+	}
+	for (auto &sub : Level->subsectors)
+	{
+		if (di->ss_renderflags[sub.Index()] & SSRF_SEEN) SectorRendered[sub.sector->Index()] = 1;
+	}
+}
+
+//==========================================================================
+//
+// Walks the sectors outward from the player, and from where the player is
+// heading, through two-sided lines, line portals and linked sector portals.
+//
+//==========================================================================
+
+void hw_UpdateTextureResidency(FLevelLocals *Level, AActor *camera)
+{
+	if (!gl_texture_residency || camera == nullptr || camera->Sector == nullptr) return;
+	if (LastUpdate >= 0 && gametic - LastUpdate < RESIDENCY_INTERVAL && gametic >= LastUpdate) return;
+	LastUpdate = gametic;
+
+	Residency.SetBudget(size_t(std::max(0, *gl_texture_budget)) << 20);
+	Residency.BeginUpdate(gametic);
+
+	SectorDistance.Resize(Level->sectors.Size());
+	for (auto &d : SectorDistance) d = -1;
+	SectorQueue.Clear();
+
+	if (SectorRendered.Size() == Level->sectors.Size())
+	{
+		for (unsigned i = 0; i < SectorRendered.Size(); i++)
+		{
+			if (SectorRendered[i]) RequestSectorTextures(&Level->sectors[i], 0);
+			SectorRendered[i] = 0;
+		}
+	}
+
+	VisitSector(camera->Sector, 0);
+	VisitSector(Level->PointInSector(camera->Pos().XY() + camera->Vel.XY() * RESIDENCY_LOOKAHEAD), 0);
+
+	for (unsigned i = 0; i < SectorQueue.Size(); i++)
+	{
+		sector_t *sec = SectorQueue[i];
+		int distance = SectorDistance[sec->Index()];
+		RequestSectorTextures(sec, distance);
+		if (distance >= gl_texture_prefetch_depth) continue;
+
+		for (auto line : sec->Lines)
+		{
+			VisitSector(line->frontsector == sec ? line->backsector : line->frontsector, distance + 1);
+			if (line->isLinePortal())
+			{
+				auto dest = line->getPortalDestination();
+				if (dest != nullptr) VisitSector(dest->frontsector, distance + 1);
+			}
+		}
+		for (int plane = sector_t::floor; plane <= sector_t::ceiling; plane++)
+		{
+			if (sec->GetPortalType(plane) == PORTS_LINKEDPORTAL)
+			{
+				VisitSector(Level->PointInSector(sec->centerspot + sec->GetPortalDisplacement(plane)), distance + 1);
+			}
+		}
+	}
+
+	Residency.EndUpdate(RESIDENCY_MAXPREFETCH);
+}
+
+// Called after a level's precaching, which decides the starting set by itself.
+void hw_ResetTextureResidency()
+{
+	Residency.Reset();
+	SectorRendered.Clear();
+	LastUpdate = -1;
+}
+
+//==========================================================================
+//
+// STAT residency
+//
+//==========================================================================
+
+ADD_STAT(residency)
+{
+	FString out;
+	auto &stats = Residency.GetStats();
+	out.Format("Resident %zuK / %dM, Hits %d, Misses %d, Stalls %d, Prefetched %d, Evicted %d",
+		Residency.GetResidentBytes() >> 10, *gl_texture_budget, stats.Hits, stats.Misses, stats.Stalls, stats.Prefetches, stats.Evictions);
+	return out;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "tarray.h"
+
+class AActor;
+struct FLevelLocals;
+struct HWDrawInfo;
+
+//==========================================================================
+//
+// What the residency manager needs from the renderer. Textures are
+// identified by their texture manager index, so the policy can be driven
+// by a backend that does not load anything.
+//
+//==========================================================================
+
+class IResidencyBackend
+{
+public:
+	virtual ~IResidencyBackend() = default;
+	virtual bool IsResident(int texture) = 0;
+	virtual size_t GetSize(int texture) = 0;
+	virtual bool Prefetch(int texture) = 0;	// false if nothing got queued
+	virtual void Evict(int texture) = 0;
+};
+
+//==========================================================================
+//
+// Texture residency policy
+//
+// Every update gets the textures around the player along with their
+// distance, measured in sectors crossed. Whatever the renderer actually
+// drew since the last update counts as distance 0, however far away it is.
+// Textures that are not resident yet get prefetched, nearest first. When the textures it knows about go
+// over the budget, the ones that were not requested for the longest time
+// get evicted.
+//
+//==========================================================================
+
+class FTextureResidency
+{
+public:
+	struct Stats
+	{
+		int Hits;			// requested and already resident
+		int Misses;			// requested and not resident
+		int Stalls;			// misses in the player's own area, which the renderer is likely waiting for
+		int Prefetches;
+		int Evictions;
+	};
+
+	FTextureResidency(IResidencyBackend &backend) : Backend(backend) {}
+
+	void SetBudget(size_t bytes) { Budget = bytes; }
+	void Reset();
+
+	void BeginUpdate(int time);
+	void Request(int texture, int distance);
+	void EndUpdate(int maxprefetch);
+
+	size_t GetResidentBytes() const { return ResidentBytes; }
+	const Stats &GetStats() const { return Counts; }
+
+private:
+	struct Entry
+	{
+		int LastUsed = 0;
+		int Distance = 0;
+		unsigned Update = 0;	// the update this was last requested in
+		size_t Size = 0;
+		bool Tracked = false;	// resident as far as the budget is concerned
+	};
+
+	void Track(int texture);
+	void EvictOverBudget();
+
+	IResidencyBackend &Backend;
+	TArray<Entry> Entries;
+	TArray<int> Requested;
+	size_t Budget = 0;
+	size_t ResidentBytes = 0;
+	unsigned UpdateCount = 0;
+	int Time = 0;
+	Stats Counts = {};
+};
+
+void hw_UpdateTextureResidency(FLevelLocals *Level, AActor *camera);
+void hw_MarkRenderedSectors(HWDrawInfo *di);
+void hw_ResetTextureResidency();
@@ -43,12 +43,17 @@
 #include "flatvertices.h"
 #include "hw_vertexbuilder.h"
 #include "hw_walldispatcher.h"
+#include "hw_occlusion.h"
+#include "models.h"
+#include "r_state.h"
+#include "r_sky.h"
 
 #ifdef ARCH_IA32
 #include <immintrin.h>
 #endif // ARCH_IA32
 
 CVAR(Bool, gl_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Bool, gl_occlusioncull, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 
 EXTERN_CVAR(Float, r_actorspriteshadowdist)
 EXTERN_CVAR(Bool, r_radarclipper)
@@ -116,6 +121,7 @@ public:
 };
 
 static RenderJobQueue jobQueue;	// One static queue is sufficient here. This code will never be called recursively.
+static HWOcclusionBuffer occlusionBuffer;	// Only the main view uses this so one is sufficient, too.
 
 void HWDrawInfo::WorkerThread()
 {
@@ -402,6 +408,8 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 
 	seg->linedef->flags |= ML_MAPPED;
 
+	if (mOccluder && !ispoly) AddOccluders(seg, currentsector, backsector);
+
 	if (ispoly || seg->linedef->validcount!=validcount) 
 	{
 		if (!ispoly) seg->linedef->validcount=validcount;
@@ -426,6 +434,146 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 	}
 }
 
+//==========================================================================
+//
+// Rasterizes the solid parts of a seg into the occlusion buffer.
+// Only parts that are guaranteed to be drawn opaque may be used here.
+//
+//==========================================================================
+
+void HWDrawInfo::AddOccluders(seg_t *seg, sector_t *frontsector, sector_t *backsector)
+{
+	auto side = seg->sidedef;
+	auto line = seg->linedef;
+
+	if (line->isVisualPortal() || line->special == Line_Mirror || line->special == Line_Horizon) return;
+	if (side->Flags & WALLF_DITHERTRANS) return;
+	if (!(frontsector->GetPortal(sector_t::ceiling)->mFlags & PORTSF_SKYFLATONLY) ||
+		!(frontsector->GetPortal(sector_t::floor)->mFlags & PORTSF_SKYFLATONLY))
+	{
+		return;
+	}
+
+	auto isSolid = [=](int part)
+	{
+		auto tex = TexMan.GetGameTexture(side->GetTexture(part), true);
+		return tex && tex->isValid();
+	};
+
+	auto addQuad = [=](double top1, double top2, double bottom1, double bottom2)
+	{
+		if (top1 <= bottom1 || top2 <= bottom2) return;
+		FVector3 corners[4] =
+		{
+			{ (float)seg->v1->fX(), (float)seg->v1->fY(), (float)top1 },
+			{ (float)seg->v2->fX(), (float)seg->v2->fY(), (float)top2 },
+			{ (float)seg->v2->fX(), (float)seg->v2->fY(), (float)bottom2 },
+			{ (float)seg->v1->fX(), (float)seg->v1->fY(), (float)bottom1 },
+		};
+		mOccluder->AddOccluder(corners);
+	};
+
+	double fc1 = frontsector->ceilingplane.ZatPoint(seg->v1), fc2 = frontsector->ceilingplane.ZatPoint(seg->v2);
+	double ff1 = frontsector->floorplane.ZatPoint(seg->v1), ff2 = frontsector->floorplane.ZatPoint(seg->v2);
+
+	if (backsector == nullptr)
+	{
+		if (isSolid(side_t::mid)) addQuad(fc1, fc2, ff1, ff2);
+		return;
+	}
+	if (backsector == frontsector) return;
+	if (!(backsector->GetPortal(sector_t::ceiling)->mFlags & PORTSF_SKYFLATONLY) ||
+		!(backsector->GetPortal(sector_t::floor)->mFlags & PORTSF_SKYFLATONLY))
+	{
+		return;
+	}
+
+	double bc1 = backsector->ceilingplane.ZatPoint(seg->v1), bc2 = backsector->ceilingplane.ZatPoint(seg->v2);
+	double bf1 = backsector->floorplane.ZatPoint(seg->v1), bf2 = backsector->floorplane.ZatPoint(seg->v2);
+
+	// Upper and lower parts between two sky sectors are not drawn.
+	if (!(frontsector->GetTexture(sector_t::ceiling) == skyflatnum && backsector->GetTexture(sector_t::ceiling) == skyflatnum) && isSolid(side_t::top))
+	{
+		addQuad(fc1, fc2, max(bc1, ff1), max(bc2, ff2));
+	}
+	if (!(frontsector->GetTexture(sector_t::floor) == skyflatnum && backsector->GetTexture(sector_t::floor) == skyflatnum) && isSolid(side_t::bottom))
+	{
+		addQuad(min(bf1, fc1), min(bf2, fc2), ff1, ff2);
+	}
+}
+
+//==========================================================================
+//
+// Checks the subsector's bounding box, extended to the full height of
+// its sector, against the occlusion buffer.
+//
+//==========================================================================
+
+bool HWDrawInfo::IsSubsectorOccluded(subsector_t *sub, sector_t *sector)
+{
+	auto &box = sub->bbox;
+	double zmin = DBL_MAX, zmax = -DBL_MAX;
+	for (int i = 0; i < 4; i++)
+	{
+		DVector2 corner((i & 1) ? box.Right() : box.Left(), (i & 2) ? box.Top() : box.Bottom());
+		for (auto sec : { sector, sub->sector })
+		{
+			zmin = min(zmin, sec->floorplane.ZatPoint(corner));
+			zmax = max(zmax, sec->ceilingplane.ZatPoint(corner));
+		}
+	}
+	if (zmin > zmax) return false;
+
+	FVector3 mins((float)box.Left(), (float)box.Bottom(), (float)zmin);
+	FVector3 maxs((float)box.Right(), (float)box.Top(), (float)zmax);
+	return mOccluder->IsBoxOccluded(mins, maxs);
+}
+
+//==========================================================================
+//
+// Marks all hidden things in a sector as processed so that RenderThings
+// skips them. The bounds are generous, using the sprite's size in every
+// direction, because the actual sprite placement is only known after
+// HWSprite::Process did all its work.
+//
+//==========================================================================
+
+void HWDrawInfo::CullOccludedThings(sector_t *sector)
+{
+	const auto &vp = Viewpoint;
+	for (auto p = sector->touching_renderthings; p != nullptr; p = p->m_snext)
+	{
+		auto thing = p->m_thing;
+		if (thing->validcount == validcount) continue;
+		if (thing->player != nullptr || thing->picnum.isValid() || (thing->renderflags & RF_SPRITETYPEMASK) != RF_FACESPRITE) continue;
+		if ((unsigned)thing->sprite >= sprites.Size()) continue;
+		if (FindModelFrame(thing, thing->sprite, thing->frame, !!(thing->flags & MF_DROPPED)) != nullptr) continue;
+
+		DVector3 pos = thing->InterpolatedPosition(vp.TicFrac) + thing->WorldOffset;
+		pos.Z += thing->GetBobOffset(vp.TicFrac);
+
+		bool mirror;
+		DAngle sprangle = thing->GetSpriteAngle((pos - vp.Pos).Angle(), vp.TicFrac);
+		FTextureID patch = sprites[thing->sprite].GetSpriteFrame(thing->frame, -1, sprangle, &mirror, !!(thing->renderflags & RF_SPRITEFLIP));
+		if (!patch.isValid()) continue;
+		auto tex = TexMan.GetGameTexture(patch, false);
+		if (tex == nullptr) continue;
+
+		double xext = (tex->GetDisplayWidth() + fabs(tex->GetDisplayLeftOffset())) * fabs(thing->Scale.X);
+		double zext = (tex->GetDisplayHeight() + fabs(tex->GetDisplayTopOffset())) * fabs(thing->Scale.Y);
+		xext = max(xext, thing->RenderRadius());
+		zext = max(zext, thing->Height);
+
+		FVector3 mins((float)(pos.X - xext), (float)(pos.Y - xext), (float)(pos.Z - zext));
+		FVector3 maxs((float)(pos.X + xext), (float)(pos.Y + xext), (float)(pos.Z + zext));
+		if (mOccluder->IsBoxOccluded(mins, maxs))
+		{
+			thing->validcount = validcount;
+			occluded_things++;
+		}
+	}
+}
+
 //==========================================================================
 //
 // R_Subsector
@@ -697,9 +845,13 @@ void HWDrawInfo::RenderDefinedParticles(subsector_t* sub, sector_t* front)
 {
 	SetupSprite.Clock();
 
-	for (int i = Level->DefinedParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = Level->DefinedParticlePool.Particles[i].snext)
+	HWParticleBatch batch;
+	batch.Setup(this, front);
+
+	for (uint32_t i : Level->DefinedParticlesInSubsec[sub->Index()])
 	{
 		particledata_t& particle = Level->DefinedParticlePool.Particles[i];
+		if (particle.alpha <= 0) continue;
 
 		if (mClipPortal)
 		{
@@ -708,7 +860,7 @@ void HWDrawInfo::RenderDefinedParticles(subsector_t* sub, sector_t* front)
 		}
 
 		HWSprite sprite;
-		sprite.ProcessDefinedParticle(this, &particle, front);
+		sprite.ProcessDefinedParticle(this, &particle, batch);
 	}
 
 	SetupSprite.Unclock();
@@ -822,8 +974,13 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		CheckUpdate(screen->mVertexData, sector);
 	}
 
+	// Subsectors hidden behind already processed walls only need their things checked individually.
+	// Some of those may be large enough to be visible, even if the subsector itself is not.
+	bool occluded = mOccluder && IsSubsectorOccluded(sub, fakesector);
+	if (occluded) occluded_subsectors++;
+
 	// [RH] Add particles
-	if (gl_render_things && (sub->sprites.Size() > 0 || Level->ParticlesInSubsec[sub->Index()] != NO_PARTICLE))
+	if (!occluded && gl_render_things && (sub->sprites.Size() > 0 || Level->ParticlesInSubsec[sub->Index()] != NO_PARTICLE))
 	{
 		if (multithread)
 		{
@@ -837,7 +994,7 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 	
-	if (gl_render_things && Level->DefinedParticlesInSubsec[sub->Index()] != NO_PARTICLE)
+	if (!occluded && gl_render_things && Level->DefinedParticlesInSubsec[sub->Index()].Size() > 0)
 	{
 		if (multithread)
 		{
@@ -851,7 +1008,7 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 
-	AddLines(sub, fakesector);
+	if (!occluded) AddLines(sub, fakesector);
 
 	// BSP is traversed by subsector.
 	// A sector might have been split into several
@@ -865,6 +1022,7 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 
 		if (gl_render_things && (sector->touching_renderthings || sector->sectorportal_thinglist))
 		{
+			if (mOccluder) CullOccludedThings(sector);
 			if (multithread)
 			{
 				jobQueue.AddJob(RenderJob::SpriteJob, sub, nullptr);
@@ -892,7 +1050,7 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 
-	if (gl_render_flats)
+	if (gl_render_flats && !occluded)
 	{
 		// Subsectors with only 2 lines cannot have any area
 		if (sub->numlines>2 || (sub->hacked&1)) 
@@ -1069,6 +1227,15 @@ void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
 
 	validcount++;	// used for processing sidedefs only once by the renderer.
 
+	// The occlusion buffer is only reliable for a plain front to back traversal of the main view.
+	// Portals, out of bounds views and orthographic projection get no occlusion culling.
+	if (gl_occlusioncull && outer == nullptr && mCurrentPortal == nullptr && mClipPortal == nullptr && !Viewpoint.IsOrtho() && !Viewpoint.IsAllowedOoB())
+	{
+		mOccluder = &occlusionBuffer;
+		mOccluder->BeginScene(VPUniforms.mProjectionMatrix, VPUniforms.mViewMatrix);
+	}
+	else mOccluder = nullptr;
+
 	multithread = gl_multithread;
 	if (multithread)
 	{
@@ -1102,6 +1269,12 @@ void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
 		}
 	}
 
+	if (mOccluder)
+	{
+		rendered_occluders += mOccluder->NumOccluders();
+		mOccluder = nullptr;
+	}
+
 	// Process all the sprites on the current portal's back side which touch the portal.
 	if (mCurrentPortal != nullptr) mCurrentPortal->RenderAttached(this);
 
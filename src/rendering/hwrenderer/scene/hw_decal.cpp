@@ -39,13 +39,23 @@
 #include "hw_renderstate.h"
 #include "texturemanager.h"
 
+enum
+{
+	DECAL_VERTICES = 6,		// two triangles, so that adjacent decals can go into a single draw call
+	DECAL_BATCH = 32,		// decals that get clipped before their vertices are allocated
+};
+
+// LL, UL, LR, UR from ProcessDecal.
+static const int DecalTriangles[DECAL_VERTICES] = { 0, 1, 2, 2, 1, 3 };
+
 //==========================================================================
 //
-//
+// Draws this decal and the count - 1 decals whose vertices follow it.
+// Those all must pass CanBatch.
 //
 //==========================================================================
 
-void HWDecal::DrawDecal(HWDrawInfo *di, FRenderState &state)
+void HWDecal::DrawDecal(HWDrawInfo *di, FRenderState &state, int count)
 {
 	PalEntry DecalColor;
 	// alpha color only has an effect when using an alpha texture.
@@ -96,7 +106,7 @@ void HWDecal::DrawDecal(HWDrawInfo *di, FRenderState &state)
 
 	if (lightlist == nullptr)
 	{
-		state.Draw(DT_TriangleStrip, vertindex, 4);
+		state.Draw(DT_Triangles, vertindex, DECAL_VERTICES * count);
 	}
 	else
 	{
@@ -120,19 +130,45 @@ void HWDecal::DrawDecal(HWDrawInfo *di, FRenderState &state)
 				SetFog(state, di->Level, di->lightmode, thisll, rellight, di->isFullbrightScene(), &thiscm, false);
 				SetSplitPlanes(state, lightlist[k].plane, lowplane);
 
-				state.Draw(DT_TriangleStrip, vertindex, 4);
+				state.Draw(DT_Triangles, vertindex, DECAL_VERTICES);
 			}
 			if (low1 <= dv[0].z && low2 <= dv[3].z) break;
 		}
 	}
 
-	rendered_decals++;
+	rendered_decals += count;
 	state.SetTextureMode(TM_NORMAL);
 	state.SetObjectColor(0xffffffff);
 	state.SetFog(fc, -1);
 	state.SetDynLight(0, 0, 0);
 }
 
+//==========================================================================
+//
+// Decals that were clipped to the same wall one after another only
+// differ in their vertices if they share all their render state.
+// Decals on split walls and those lit by light probes still get drawn
+// one by one.
+//
+//==========================================================================
+
+bool HWDecal::CanBatch(HWDecal *next, int count)
+{
+	return next->vertindex == vertindex + DECAL_VERTICES * count &&
+		next->decal->Side == decal->Side &&
+		lightlist == nullptr && next->lightlist == nullptr &&
+		next->texture == texture &&
+		next->decal->Translation == decal->Translation &&
+		next->decal->RenderStyle == decal->RenderStyle &&
+		next->decal->AlphaColor == decal->AlphaColor &&
+		next->alpha == alpha &&
+		next->lightlevel == lightlevel &&
+		next->rellight == rellight &&
+		next->dynlightindex == dynlightindex &&
+		next->frontsector == frontsector &&
+		next->Colormap == Colormap;
+}
+
 //==========================================================================
 //
 //
@@ -141,11 +177,19 @@ void HWDecal::DrawDecal(HWDrawInfo *di, FRenderState &state)
 void HWDrawInfo::DrawDecals(FRenderState &state, TArray<HWDecal *> &decals)
 {
 	side_t *wall = nullptr;
+	bool batch = Level->LightProbes.Size() == 0;
 	state.SetDepthMask(false);
 	state.SetTextureClamp(true);
 	state.SetDepthBias(-1, -128);
-	for (auto gldecal : decals)
+	for (unsigned i = 0; i < decals.Size(); )
 	{
+		auto gldecal = decals[i];
+		int count = 1;
+		if (batch)
+		{
+			// The order must stay as it is, because it decides how the decals get blended.
+			while (i + count < decals.Size() && gldecal->CanBatch(decals[i + count], count)) count++;
+		}
 		if (gldecal->decal->Side != wall)
 		{
 			wall = gldecal->decal->Side;
@@ -159,7 +203,8 @@ void HWDrawInfo::DrawDecals(FRenderState &state, TArray<HWDecal *> &decals)
 				SetFog(state, Level, lightmode, gldecal->lightlevel, gldecal->rellight, isFullbrightScene(), &gldecal->Colormap, false);
 			}
 		}
-		gldecal->DrawDecal(this, state);
+		gldecal->DrawDecal(this, state, count);
+		i += count;
 	}
 	state.EnableSplit(false);
 	state.ClearDepthBias();
@@ -198,7 +243,7 @@ void HWWall::DrawDecalsForMirror(HWDrawInfo *di, FRenderState &state, TArray<HWD
 //==========================================================================
 EXTERN_CVAR(Bool, gl_texture_thread);
 
-void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &normal)
+HWDecal *HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &normal, FFlatVertex *verts)
 {
 	line_t * line = seg->linedef;
 	side_t * side = seg->sidedef;
@@ -208,9 +253,9 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 	FTextureID decalTile;
 	
 	
-	if (decal->RenderFlags & RF_INVISIBLE) return;
-	if (type == RENDERWALL_FFBLOCK && texture->isMasked()) return;	// No decals on 3D floors with transparent textures.
-	if (seg == nullptr) return;
+	if (decal->RenderFlags & RF_INVISIBLE) return nullptr;
+	if (type == RENDERWALL_FFBLOCK && texture->isMasked()) return nullptr;	// No decals on 3D floors with transparent textures.
+	if (seg == nullptr) return nullptr;
 	
 	
 	decalTile = decal->PicNum;
@@ -219,7 +264,7 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 
 	
 	auto texture = TexMan.GetGameTexture(decalTile);
-	if (texture == NULL) return;
+	if (texture == NULL) return nullptr;
 
 	// @Cockatrice - If this texture is not loaded, and we are able to BG load it, try to render this sprites last frame instead
 	// Also load the texture
@@ -245,10 +290,10 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 			if (lastPatch.isValid()) {
 				decalTile = lastPatch;
 				texture = TexMan.GetGameTexture(decalTile, false);
-				if (texture == NULL || !texture->isValid()) return;
+				if (texture == NULL || !texture->isValid()) return nullptr;
 			}
 			else {
-				return;
+				return nullptr;
 			}
 		}
 
@@ -273,12 +318,12 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 		default:
 			// No valid decal can have this type. If one is encountered anyway
 			// it is in some way invalid so skip it.
-			return;
+			return nullptr;
 			//zpos = decal->z;
 			//break;
 			
 		case RF_RELUPPER:
-			if (type != RENDERWALL_TOP) return;
+			if (type != RENDERWALL_TOP) return nullptr;
 			if (line->flags & ML_DONTPEGTOP)
 			{
 				zpos = decal->Z + frontsector->GetPlaneTexZ(sector_t::ceiling);
@@ -289,7 +334,7 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 			}
 			break;
 		case RF_RELLOWER:
-			if (type != RENDERWALL_BOTTOM) return;
+			if (type != RENDERWALL_BOTTOM) return nullptr;
 			if (line->flags & ML_DONTPEGBOTTOM)
 			{
 				zpos = decal->Z + frontsector->GetPlaneTexZ(sector_t::ceiling);
@@ -300,7 +345,7 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 			}
 			break;
 		case RF_RELMID:
-			if (type == RENDERWALL_TOP || type == RENDERWALL_BOTTOM) return;
+			if (type == RENDERWALL_TOP || type == RENDERWALL_BOTTOM) return nullptr;
 			if (line->flags & ML_DONTPEGBOTTOM)
 			{
 				zpos = decal->Z + frontsector->GetPlaneTexZ(sector_t::floor);
@@ -312,6 +357,10 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 	}
 
 	// now clip the decal to the actual polygon
+	// This is redone every frame rather than cached on the decal: the wall fragment
+	// it clips against is rebuilt per frame, and its extent depends on the plane
+	// heights, texture offsets and 3D floor splits, which would all have to
+	// invalidate such a cache.
 
 	float decalwidth = texture->GetDisplayWidth()  * decal->ScaleX;
 	float decalheight = texture->GetDisplayHeight() * decal->ScaleY;
@@ -351,7 +400,7 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 		righttex = decalwidth;
 	}
 	if (right <= left) 
-		return;	// nothing to draw
+		return nullptr;	// nothing to draw
 	
 
 	// one texture unit on the wall as vector
@@ -387,7 +436,7 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 	
 	// completely below the wall
 	if (topleft < dv[LL].z && topright < dv[LR].z)
-		return;
+		return nullptr;
 	
 	if (topleft < dv[UL].z || topright < dv[UR].z)
 	{
@@ -406,7 +455,7 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 	
 	// completely above the wall
 	if (bottomleft > dv[UL].z && bottomright > dv[UR].z)
-		return;
+		return nullptr;
 	
 	if (bottomleft > dv[LL].z || bottomright > dv[LR].z)
 	{
@@ -458,13 +507,31 @@ void HWWall::ProcessDecal(HWDrawInfo *di, DBaseDecal *decal, const FVector3 &nor
 	gldecal->Normal = normal;
 	gldecal->lightlist = lightlist;
 	memcpy(gldecal->dv, dv, sizeof(dv));
-	
-	auto verts = screen->mVertexData->AllocVertices(4);
-	gldecal->vertindex = verts.second;
-	
-	for (i = 0; i < 4; i++)
+
+	for (i = 0; i < DECAL_VERTICES; i++)
+	{
+		auto &v = dv[DecalTriangles[i]];
+		verts[i].Set(v.x, v.z, v.y, v.u, v.v);
+	}
+	return gldecal;
+}
+
+//==========================================================================
+//
+// Copies one batch of clipped decals into the vertex buffer with a single
+// allocation, so the decals of a wall mostly end up next to each other
+// and can be drawn together.
+//
+//==========================================================================
+
+static void FlushDecals(HWDecal **batch, FFlatVertex *vertices, unsigned count)
+{
+	if (count == 0) return;
+	auto verts = screen->mVertexData->AllocVertices(count * DECAL_VERTICES);
+	memcpy(verts.first, vertices, count * DECAL_VERTICES * sizeof(FFlatVertex));
+	for (unsigned i = 0; i < count; i++)
 	{
-		verts.first[i].Set(dv[i].x, dv[i].z, dv[i].y, dv[i].u, dv[i].v);
+		batch[i]->vertindex = verts.second + i * DECAL_VERTICES;
 	}
 }
 
@@ -482,11 +549,24 @@ void HWWall::ProcessDecals(HWDrawInfo *di)
 		if (decal)
 		{
 			auto normal = glseg.Normal();	// calculate the normal only once per wall because it requires a square root.
+			HWDecal *batch[DECAL_BATCH];
+			FFlatVertex vertices[DECAL_BATCH * DECAL_VERTICES];
+			unsigned count = 0;
 			while (decal)
 			{
-				ProcessDecal(di, decal, normal);
+				auto gldecal = ProcessDecal(di, decal, normal, &vertices[count * DECAL_VERTICES]);
+				if (gldecal != nullptr)
+				{
+					batch[count++] = gldecal;
+					if (count == DECAL_BATCH)
+					{
+						FlushDecals(batch, vertices, count);
+						count = 0;
+					}
+				}
 				decal = decal->WallNext;
 			}
+			FlushDecals(batch, vertices, count);
 		}
 	}
 }
@@ -0,0 +1,623 @@
+/*
+** hw_drawcapture.cpp
+** Writes the draw lists of one frame to disk and replays list building
+** and sorting from such a capture for offline benchmarking.
+**
+** The replay never touches the vertex buffer or the render state, so it
+** can run with any backend, including the software renderer on machines
+** without a GPU, e.g. '+gl_replaydrawlists frame.hwdl 1000 +quit'.
+**
+*/
+
+#include "c_dispatch.h"
+#include "files.h"
+#include "printf.h"
+#include "stats.h"
+#include "g_levellocals.h"
+#include "texturemanager.h"
+#include "model.h"
+#include "hw_portal.h"
+#include "hw_drawinfo.h"
+#include "hw_drawcapture.h"
+#include "hwrenderer/scene/hw_drawstructs.h"
+
+static const uint32_t CAPTURE_MAGIC = MAKE_ID('H', 'W', 'D', 'L');
+static const uint32_t CAPTURE_VERSION = 1;
+
+//==========================================================================
+//
+// Plain data records for the draw items. These contain no pointers
+// so that they can be written to and read from disk as is.
+//
+//==========================================================================
+
+struct FCapturedWall
+{
+	float seg[6];		// x1, x2, y1, y2, fracleft, fracright
+	float ztop[2], zbottom[2];
+	float zceil[2], zfloor[2];
+	float tcs[8];
+	float lightuv[8];
+	float ViewDistance;
+	float alpha;
+	int32_t texture;
+	int32_t lightlevel;
+	uint16_t flags;
+	uint8_t type;
+	uint8_t pad;
+};
+
+struct FCapturedFlat
+{
+	float z;
+	float alpha;
+	int32_t texture;
+	int32_t lightlevel;
+	uint8_t ceiling;
+	uint8_t stack;
+	uint8_t renderflags;
+	uint8_t hacktype;
+};
+
+struct FCapturedSprite
+{
+	float x, y, z;
+	float x1, y1, z1;
+	float x2, y2, z2;
+	float ul, ur, vt, vb;
+	float depth;
+	float trans;
+	int32_t index;
+	int32_t texture;
+	int32_t lightlevel;
+	uint8_t isparticle;
+	uint8_t hasmodel;
+	uint8_t fullbright;
+	uint8_t pad;
+};
+
+struct FDrawListCapture
+{
+	struct List
+	{
+		TArray<HWDrawItem> Items;
+		TArray<FCapturedWall> Walls;
+		TArray<FCapturedFlat> Flats;
+		TArray<FCapturedSprite> Sprites;
+	};
+
+	struct Portal
+	{
+		FString Name;
+		TArray<FCapturedWall> Lines;
+	};
+
+	FString MapName;
+	double Pos[3];
+	double Angles[3];	// yaw, pitch, roll
+	double FieldOfView;
+	int32_t ReverseSort;
+	int32_t InArea;
+	int32_t LightMode;
+	float Projection[16];
+	float View[16];
+	TArray<FString> Textures;
+	TArray<Portal> Portals;
+	List Lists[GLDL_TYPES];
+
+	TMap<FGameTexture *, int> TextureIndex;
+
+	int GetTextureIndex(FGameTexture *tex);
+	void CaptureWall(FCapturedWall &rec, const HWWall *w);
+	void Capture(HWDrawInfo *di);
+	bool Write(const char *filename);
+	bool Read(const char *filename);
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FDrawListCapture::GetTextureIndex(FGameTexture *tex)
+{
+	if (tex == nullptr) return -1;
+	auto check = TextureIndex.CheckKey(tex);
+	if (check) return *check;
+	int index = Textures.Push(tex->GetName());
+	TextureIndex[tex] = index;
+	return index;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FDrawListCapture::CaptureWall(FCapturedWall &rec, const HWWall *w)
+{
+	memset(&rec, 0, sizeof(rec));
+	rec.seg[0] = w->glseg.x1;
+	rec.seg[1] = w->glseg.x2;
+	rec.seg[2] = w->glseg.y1;
+	rec.seg[3] = w->glseg.y2;
+	rec.seg[4] = w->glseg.fracleft;
+	rec.seg[5] = w->glseg.fracright;
+	for (int i = 0; i < 2; i++)
+	{
+		rec.ztop[i] = w->ztop[i];
+		rec.zbottom[i] = w->zbottom[i];
+		rec.zceil[i] = w->zceil[i];
+		rec.zfloor[i] = w->zfloor[i];
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		rec.tcs[i * 2] = w->tcs[i].u;
+		rec.tcs[i * 2 + 1] = w->tcs[i].v;
+		rec.lightuv[i * 2] = w->lightuv[i].u;
+		rec.lightuv[i * 2 + 1] = w->lightuv[i].v;
+	}
+	rec.ViewDistance = w->ViewDistance;
+	rec.alpha = w->alpha;
+	rec.texture = GetTextureIndex(w->texture);
+	rec.lightlevel = w->lightlevel;
+	rec.flags = w->flags;
+	rec.type = w->type;
+}
+
+//==========================================================================
+//
+// Copies everything the scene setup produced for one viewpoint.
+//
+//==========================================================================
+
+void FDrawListCapture::Capture(HWDrawInfo *di)
+{
+	auto &vp = di->Viewpoint;
+
+	MapName = di->Level->MapName;
+	Pos[0] = vp.Pos.X;
+	Pos[1] = vp.Pos.Y;
+	Pos[2] = vp.Pos.Z;
+	Angles[0] = vp.Angles.Yaw.Degrees();
+	Angles[1] = vp.Angles.Pitch.Degrees();
+	Angles[2] = vp.Angles.Roll.Degrees();
+	FieldOfView = vp.FieldOfView.Degrees();
+	ReverseSort = !!(di->Level->i_compatflags & COMPATF_SPRITESORT);
+	InArea = di->in_area;
+	LightMode = (int)di->lightmode;
+	memcpy(Projection, di->VPUniforms.mProjectionMatrix.get(), sizeof(Projection));
+	memcpy(View, di->VPUniforms.mViewMatrix.get(), sizeof(View));
+
+	for (auto p : di->Portals)
+	{
+		auto &portal = Portals[Portals.Reserve(1)];
+		portal.Name = p->GetName();
+		portal.Lines.Resize(p->lines.Size());
+		for (unsigned i = 0; i < p->lines.Size(); i++)
+		{
+			CaptureWall(portal.Lines[i], &p->lines[i]);
+		}
+	}
+
+	for (int l = 0; l < GLDL_TYPES; l++)
+	{
+		auto &src = di->drawlists[l];
+		auto &dest = Lists[l];
+
+		dest.Items = src.drawitems;
+
+		dest.Walls.Resize(src.walls.Size());
+		for (unsigned i = 0; i < src.walls.Size(); i++)
+		{
+			CaptureWall(dest.Walls[i], src.walls[i]);
+		}
+
+		dest.Flats.Resize(src.flats.Size());
+		for (unsigned i = 0; i < src.flats.Size(); i++)
+		{
+			auto f = src.flats[i];
+			auto &rec = dest.Flats[i];
+			memset(&rec, 0, sizeof(rec));
+			rec.z = f->z;
+			rec.alpha = f->alpha;
+			rec.texture = GetTextureIndex(f->texture);
+			rec.lightlevel = f->lightlevel;
+			rec.ceiling = f->ceiling;
+			rec.stack = f->stack;
+			rec.renderflags = f->renderflags;
+			rec.hacktype = f->hacktype;
+		}
+
+		dest.Sprites.Resize(src.sprites.Size());
+		for (unsigned i = 0; i < src.sprites.Size(); i++)
+		{
+			auto s = src.sprites[i];
+			auto &rec = dest.Sprites[i];
+			memset(&rec, 0, sizeof(rec));
+			rec.x = s->x;
+			rec.y = s->y;
+			rec.z = s->z;
+			rec.x1 = s->x1;
+			rec.y1 = s->y1;
+			rec.z1 = s->z1;
+			rec.x2 = s->x2;
+			rec.y2 = s->y2;
+			rec.z2 = s->z2;
+			rec.ul = s->ul;
+			rec.ur = s->ur;
+			rec.vt = s->vt;
+			rec.vb = s->vb;
+			rec.depth = s->depth;
+			rec.trans = s->trans;
+			rec.index = s->index;
+			rec.texture = GetTextureIndex(s->texture);
+			rec.lightlevel = s->lightlevel;
+			rec.isparticle = s->isparticle;
+			rec.hasmodel = s->modelframe != nullptr;
+			rec.fullbright = s->fullbright;
+		}
+	}
+}
+
+//==========================================================================
+//
+// File I/O
+//
+//==========================================================================
+
+static void WriteString(FileWriter *fw, const FString &str)
+{
+	uint32_t len = (uint32_t)str.Len();
+	fw->Write(&len, 4);
+	fw->Write(str.GetChars(), len);
+}
+
+template<class T>
+static void WriteArray(FileWriter *fw, const TArray<T> &arr)
+{
+	uint32_t count = arr.Size();
+	fw->Write(&count, 4);
+	if (count > 0) fw->Write(arr.Data(), count * sizeof(T));
+}
+
+static bool ReadString(FileReader &fr, FString &str)
+{
+	uint32_t len = fr.ReadUInt32();
+	if (len > (uint32_t)(fr.GetLength() - fr.Tell())) return false;
+	TArray<char> buffer(len + 1, true);
+	fr.Read(buffer.Data(), len);
+	buffer[len] = 0;
+	str = buffer.Data();
+	return true;
+}
+
+template<class T>
+static bool ReadArray(FileReader &fr, TArray<T> &arr)
+{
+	uint32_t count = fr.ReadUInt32();
+	if (count > (uint32_t)(fr.GetLength() - fr.Tell()) / sizeof(T)) return false;
+	arr.Resize(count);
+	return count == 0 || fr.Read(arr.Data(), count * sizeof(T)) == (FileReader::Size)(count * sizeof(T));
+}
+
+bool FDrawListCapture::Write(const char *filename)
+{
+	auto fw = FileWriter::Open(filename);
+	if (fw == nullptr) return false;
+
+	uint32_t header[3] = { CAPTURE_MAGIC, CAPTURE_VERSION, GLDL_TYPES };
+	fw->Write(header, sizeof(header));
+	WriteString(fw, MapName);
+	fw->Write(Pos, sizeof(Pos));
+	fw->Write(Angles, sizeof(Angles));
+	fw->Write(&FieldOfView, sizeof(FieldOfView));
+	fw->Write(&ReverseSort, 4);
+	fw->Write(&InArea, 4);
+	fw->Write(&LightMode, 4);
+	fw->Write(Projection, sizeof(Projection));
+	fw->Write(View, sizeof(View));
+
+	uint32_t count = Textures.Size();
+	fw->Write(&count, 4);
+	for (auto &name : Textures) WriteString(fw, name);
+
+	count = Portals.Size();
+	fw->Write(&count, 4);
+	for (auto &portal : Portals)
+	{
+		WriteString(fw, portal.Name);
+		WriteArray(fw, portal.Lines);
+	}
+
+	for (auto &list : Lists)
+	{
+		WriteArray(fw, list.Items);
+		WriteArray(fw, list.Walls);
+		WriteArray(fw, list.Flats);
+		WriteArray(fw, list.Sprites);
+	}
+	delete fw;
+	return true;
+}
+
+bool FDrawListCapture::Read(const char *filename)
+{
+	FileReader fr;
+	if (!fr.OpenFile(filename)) return false;
+
+	uint32_t header[3];
+	if (fr.Read(header, sizeof(header)) != sizeof(header)) return false;
+	if (header[0] != CAPTURE_MAGIC || header[1] != CAPTURE_VERSION || header[2] != GLDL_TYPES) return false;
+
+	if (!ReadString(fr, MapName)) return false;
+	fr.Read(Pos, sizeof(Pos));
+	fr.Read(Angles, sizeof(Angles));
+	fr.Read(&FieldOfView, sizeof(FieldOfView));
+	ReverseSort = fr.ReadInt32();
+	InArea = fr.ReadInt32();
+	LightMode = fr.ReadInt32();
+	fr.Read(Projection, sizeof(Projection));
+	fr.Read(View, sizeof(View));
+
+	uint32_t count = fr.ReadUInt32();
+	if (count > (uint32_t)(fr.GetLength() - fr.Tell()) / 4) return false;
+	Textures.Resize(count);
+	for (auto &name : Textures)
+	{
+		if (!ReadString(fr, name)) return false;
+	}
+
+	count = fr.ReadUInt32();
+	if (count > (uint32_t)(fr.GetLength() - fr.Tell()) / 8) return false;
+	Portals.Resize(count);
+	for (auto &portal : Portals)
+	{
+		if (!ReadString(fr, portal.Name) || !ReadArray(fr, portal.Lines)) return false;
+	}
+
+	for (auto &list : Lists)
+	{
+		if (!ReadArray(fr, list.Items) || !ReadArray(fr, list.Walls) ||
+			!ReadArray(fr, list.Flats) || !ReadArray(fr, list.Sprites)) return false;
+
+		for (auto &item : list.Items)
+		{
+			unsigned limit = item.rendertype == DrawType_WALL ? list.Walls.Size() :
+				item.rendertype == DrawType_FLAT ? list.Flats.Size() :
+				item.rendertype == DrawType_SPRITE ? list.Sprites.Size() : 0;
+			if (item.index < 0 || (unsigned)item.index >= limit) return false;
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Capture
+//
+//==========================================================================
+
+static FString capturefile;
+
+CCMD(gl_capturedrawlists)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: gl_capturedrawlists <filename>\n");
+		return;
+	}
+	capturefile = argv[1];
+}
+
+void hw_CheckDrawListCapture(HWDrawInfo *di)
+{
+	if (capturefile.IsEmpty()) return;
+
+	FString filename = capturefile;
+	capturefile = "";
+
+	FDrawListCapture capture;
+	capture.Capture(di);
+	if (!capture.Write(filename.GetChars()))
+	{
+		Printf(TEXTCOLOR_RED "Unable to write draw list capture %s\n", filename.GetChars());
+		return;
+	}
+
+	unsigned walls = 0, flats = 0, sprites = 0;
+	for (auto &list : capture.Lists)
+	{
+		walls += list.Walls.Size();
+		flats += list.Flats.Size();
+		sprites += list.Sprites.Size();
+	}
+	Printf("Captured %u walls, %u flats, %u sprites and %u portals to %s\n", walls, flats, sprites, capture.Portals.Size(), filename.GetChars());
+}
+
+//==========================================================================
+//
+// Replay
+//
+//==========================================================================
+
+static FSpriteModelFrame replaymodelframe;	// only used to mark captured model sprites, it never gets dereferenced.
+
+static void ReplayWall(HWWall *w, const FCapturedWall &rec, const TArray<FGameTexture *> &textures)
+{
+	memset(w, 0, sizeof(HWWall));
+	w->glseg.x1 = rec.seg[0];
+	w->glseg.x2 = rec.seg[1];
+	w->glseg.y1 = rec.seg[2];
+	w->glseg.y2 = rec.seg[3];
+	w->glseg.fracleft = rec.seg[4];
+	w->glseg.fracright = rec.seg[5];
+	for (int i = 0; i < 2; i++)
+	{
+		w->ztop[i] = rec.ztop[i];
+		w->zbottom[i] = rec.zbottom[i];
+		w->zceil[i] = rec.zceil[i];
+		w->zfloor[i] = rec.zfloor[i];
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		w->tcs[i].u = rec.tcs[i * 2];
+		w->tcs[i].v = rec.tcs[i * 2 + 1];
+		w->lightuv[i].u = rec.lightuv[i * 2];
+		w->lightuv[i].v = rec.lightuv[i * 2 + 1];
+	}
+	w->ViewDistance = rec.ViewDistance;
+	w->alpha = rec.alpha;
+	w->texture = rec.texture >= 0 && (unsigned)rec.texture < textures.Size() ? textures[rec.texture] : nullptr;
+	w->lightlevel = rec.lightlevel;
+	w->flags = rec.flags;
+	w->type = rec.type;
+	w->dynlightindex = -1;
+}
+
+static void ReplayFlat(HWFlat *f, const FCapturedFlat &rec, const TArray<FGameTexture *> &textures)
+{
+	memset(f, 0, sizeof(HWFlat));
+	f->z = rec.z;
+	f->alpha = rec.alpha;
+	f->texture = rec.texture >= 0 && (unsigned)rec.texture < textures.Size() ? textures[rec.texture] : nullptr;
+	f->lightlevel = rec.lightlevel;
+	f->ceiling = rec.ceiling;
+	f->stack = rec.stack;
+	f->renderflags = rec.renderflags;
+	f->hacktype = rec.hacktype;
+	f->dynlightindex = -1;
+}
+
+static void ReplaySprite(HWSprite *s, const FCapturedSprite &rec, const TArray<FGameTexture *> &textures)
+{
+	memset((void*)s, 0, sizeof(HWSprite));
+	s->x = rec.x;
+	s->y = rec.y;
+	s->z = rec.z;
+	s->x1 = rec.x1;
+	s->y1 = rec.y1;
+	s->z1 = rec.z1;
+	s->x2 = rec.x2;
+	s->y2 = rec.y2;
+	s->z2 = rec.z2;
+	s->ul = rec.ul;
+	s->ur = rec.ur;
+	s->vt = rec.vt;
+	s->vb = rec.vb;
+	s->depth = rec.depth;
+	s->trans = rec.trans;
+	s->index = rec.index;
+	s->texture = rec.texture >= 0 && (unsigned)rec.texture < textures.Size() ? textures[rec.texture] : nullptr;
+	s->lightlevel = rec.lightlevel;
+	s->isparticle = rec.isparticle;
+	s->modelframe = rec.hasmodel ? &replaymodelframe : nullptr;
+	s->fullbright = rec.fullbright;
+	s->vertexindex = -1;
+	s->dynlightindex = -1;
+}
+
+//==========================================================================
+//
+// Rebuilds the draw lists from the capture and sorts them the same way
+// RenderScene and RenderTranslucent do. Only the CPU side is measured.
+//
+//==========================================================================
+
+CCMD(gl_replaydrawlists)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: gl_replaydrawlists <filename> [iterations]\n");
+		return;
+	}
+	int iterations = argv.argc() > 2 ? (int)strtol(argv[2], nullptr, 0) : 100;
+	if (iterations < 1) iterations = 1;
+
+	FDrawListCapture capture;
+	if (!capture.Read(argv[1]))
+	{
+		Printf(TEXTCOLOR_RED "%s is not a valid draw list capture\n", argv[1]);
+		return;
+	}
+
+	TArray<FGameTexture *> textures(capture.Textures.Size(), true);
+	for (unsigned i = 0; i < capture.Textures.Size(); i++)
+	{
+		auto texid = TexMan.CheckForTexture(capture.Textures[i].GetChars(), ETextureType::Any);
+		textures[i] = texid.isValid() ? TexMan.GetGameTexture(texid) : nullptr;
+	}
+
+	Printf("Map %s, position (%.2f, %.2f, %.2f), angles (%.2f, %.2f, %.2f), fov %.2f\n", capture.MapName.GetChars(),
+		capture.Pos[0], capture.Pos[1], capture.Pos[2], capture.Angles[0], capture.Angles[1], capture.Angles[2], capture.FieldOfView);
+	for (auto &portal : capture.Portals)
+	{
+		Printf("  %s with %u lines\n", portal.Name.GetChars(), portal.Lines.Size());
+	}
+
+	static HWDrawList lists[GLDL_TYPES];
+	for (auto &list : lists) list.replaymode = true;
+
+	cycle_t buildtime, sorttime, translucenttime, frametime;
+	double minframe = DBL_MAX, maxframe = 0;
+	unsigned sorteditems = 0;
+
+	buildtime.Reset();
+	sorttime.Reset();
+	translucenttime.Reset();
+
+	for (int n = 0; n < iterations; n++)
+	{
+		frametime.ResetAndClock();
+
+		buildtime.Clock();
+		for (int l = 0; l < GLDL_TYPES; l++)
+		{
+			auto &src = capture.Lists[l];
+			auto &list = lists[l];
+			for (auto &rec : src.Walls) ReplayWall(list.NewWall(), rec, textures);
+			for (auto &rec : src.Flats) ReplayFlat(list.NewFlat(), rec, textures);
+			for (auto &rec : src.Sprites) ReplaySprite(list.NewSprite(), rec, textures);
+			list.drawitems = src.Items;
+		}
+		buildtime.Unclock();
+
+		sorttime.Clock();
+		lists[GLDL_PLAINWALLS].SortWalls();
+		lists[GLDL_PLAINFLATS].SortFlats();
+		lists[GLDL_MASKEDWALLS].SortWalls();
+		lists[GLDL_MASKEDFLATS].SortFlats();
+		lists[GLDL_MASKEDWALLSOFS].SortWalls();
+		sorttime.Unclock();
+
+		translucenttime.Clock();
+		auto &translucent = lists[GLDL_TRANSLUCENT];
+		if (translucent.Size() > 0)
+		{
+			translucent.Sort(nullptr, !!capture.ReverseSort, (float)capture.Pos[2]);
+		}
+		translucenttime.Unclock();
+		sorteditems = translucent.Size();
+
+		for (auto &list : lists) list.Reset();
+		ResetRenderDataAllocator();
+
+		frametime.Unclock();
+		double ms = frametime.TimeMS();
+		if (ms < minframe) minframe = ms;
+		if (ms > maxframe) maxframe = ms;
+	}
+
+	unsigned walls = 0, flats = 0, sprites = 0;
+	for (auto &list : capture.Lists)
+	{
+		walls += list.Walls.Size();
+		flats += list.Flats.Size();
+		sprites += list.Sprites.Size();
+	}
+	Printf("%u walls, %u flats, %u sprites, %u translucent items after splitting\n", walls, flats, sprites, sorteditems);
+	Printf("%d iterations: build = %2.4f, texture sort = %2.4f, translucent sort = %2.4f ms per frame (min %2.4f, max %2.4f)\n", iterations,
+		buildtime.TimeMS() / iterations, sorttime.TimeMS() / iterations, translucenttime.TimeMS() / iterations, minframe, maxframe);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+struct HWDrawInfo;
+
+// Writes the draw lists of the main view to disk if a capture was requested with 'gl_capturedrawlists'.
+void hw_CheckDrawListCapture(HWDrawInfo *di);
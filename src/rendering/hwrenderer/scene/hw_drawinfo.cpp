@@ -44,6 +44,8 @@
 #include "hw_bonebuffer.h"
 #include "hw_vrmodes.h"
 #include "hw_clipper.h"
+#include "hw_drawcapture.h"
+#include "hw_residency.h"
 #include "v_draw.h"
 #include "a_corona.h"
 #include "texturemanager.h"
@@ -189,6 +191,7 @@ void HWDrawInfo::StartScene(FRenderViewpoint &parentvp, HWViewpointUniforms *uni
 	// Fullbright information needs to be propagated from the main view.
 	if (outer != nullptr) FullbrightFlags = outer->FullbrightFlags;
 	else FullbrightFlags = 0;
+	MarkRendered = gl_drawinfo != nullptr && gl_drawinfo->MarkRendered;
 
 	outer = gl_drawinfo;
 	gl_drawinfo = this;
@@ -204,6 +207,8 @@ void HWDrawInfo::StartScene(FRenderViewpoint &parentvp, HWViewpointUniforms *uni
 HWDrawInfo *HWDrawInfo::EndDrawInfo()
 {
 	assert(this == gl_drawinfo);
+	// Portals, mirrors and skyboxes have their own renderflags which are gone once this is released.
+	if (MarkRendered) hw_MarkRenderedSectors(this);
 	for (int i = 0; i < GLDL_TYPES; i++) drawlists[i].Reset();
 	gl_drawinfo = outer;
 	di_list.Release(this);
@@ -933,6 +938,7 @@ void HWDrawInfo::DrawScene(int drawmode, bool drawpsprites)
 	{
 		CreateScene(false);
 	}
+	if (drawmode == DM_MAINVIEW) hw_CheckDrawListCapture(this);
 	auto& RenderState = *screen->RenderState();
 
 	RenderState.SetDepthMask(true);
@@ -31,6 +31,7 @@ struct FDynLightData;
 struct HUDSprite;
 class ACorona;
 class Clipper;
+class HWOcclusionBuffer;
 class HWPortal;
 class FFlatVertexBuffer;
 class IRenderQueue;
@@ -142,6 +143,7 @@ struct HWDrawInfo
 	FLevelLocals *Level;
 	HWDrawInfo * outer = nullptr;
 	int FullbrightFlags;
+	bool MarkRendered;	// feeds the texture residency, set for the main view and inherited by its portals
 	std::atomic<int> spriteindex;
 	HWPortal *mClipPortal;
 	HWPortal *mCurrentPortal;
@@ -149,6 +151,7 @@ struct HWDrawInfo
 	Clipper *mClipper;
 	Clipper *vClipper; // Vertical clipper
 	Clipper *rClipper; // Radar clipper
+	HWOcclusionBuffer *mOccluder = nullptr;	// only used by the main view
 	FRenderViewpoint Viewpoint;
 	HWViewpointUniforms VPUniforms;	// per-viewpoint uniform state
 	TArray<HWPortal *> Portals;
@@ -204,6 +207,9 @@ private:
 	void AddPolyobjs(subsector_t *sub);
 	void AddLines(subsector_t * sub, sector_t * sector);
 	void AddSpecialPortalLines(subsector_t * sub, sector_t * sector, linebase_t *line);
+	void AddOccluders(seg_t *seg, sector_t *frontsector, sector_t *backsector);
+	bool IsSubsectorOccluded(subsector_t *sub, sector_t *sector);
+	void CullOccludedThings(sector_t *sector);
 	public:
 	void RenderThings(subsector_t * sub, sector_t * sector);
 	void RenderParticles(subsector_t *sub, sector_t *front);
@@ -305,8 +305,11 @@ void HWDrawList::SortWallIntoPlane(HWDrawInfo* di, SortNode * head, SortNode * s
 				w->tcs[HWWall::UPLFT].v = ws->tcs[HWWall::LOLFT].v = w->tcs[HWWall::UPRGT].v = ws->tcs[HWWall::LORGT].v = newtexv;
 				w->lightuv[HWWall::UPLFT].v = ws->lightuv[HWWall::LOLFT].v = w->lightuv[HWWall::UPRGT].v = ws->lightuv[HWWall::LORGT].v = newlmv;
 			}
-			w->MakeVertices(false);
-			ws->MakeVertices(false);
+			if (!replaymode)
+			{
+				w->MakeVertices(false);
+				ws->MakeVertices(false);
+			}
 		}
 
 		SortNode * sort2 = SortNodes.GetNew();
@@ -452,8 +455,11 @@ void HWDrawList::SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sor
 		w->zbottom[0]=ws->zbottom[1]=izb;
 		w->tcs[HWWall::LOLFT].u = w->tcs[HWWall::UPLFT].u = ws->tcs[HWWall::LORGT].u = ws->tcs[HWWall::UPRGT].u = iu;
 		w->lightuv[HWWall::LOLFT].u = w->lightuv[HWWall::UPLFT].u = ws->lightuv[HWWall::LORGT].u = ws->lightuv[HWWall::UPRGT].u = iu;
-		ws->MakeVertices(false);
-		w->MakeVertices(false);
+		if (!replaymode)
+		{
+			ws->MakeVertices(false);
+			w->MakeVertices(false);
+		}
 
 		SortNode * sort2=SortNodes.GetNew();
 		memset(sort2,0,sizeof(SortNode));
@@ -572,7 +578,7 @@ void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * s
 			head->AddToLeft(sort);
 			head->AddToRight(sort2);
 		}
-		if (screen->BuffersArePersistent())
+		if (replaymode || screen->BuffersArePersistent())
 		{
 			s->vertexindex = ss->vertexindex = -1;
 		}
@@ -713,8 +719,13 @@ SortNode * HWDrawList::DoSort(HWDrawInfo *di, SortNode * head)
 //==========================================================================
 void HWDrawList::Sort(HWDrawInfo *di)
 {
-	reverseSort = !!(di->Level->i_compatflags & COMPATF_SPRITESORT);
-    SortZ = di->Viewpoint.Pos.Z;
+	Sort(di, !!(di->Level->i_compatflags & COMPATF_SPRITESORT), di->Viewpoint.Pos.Z);
+}
+
+void HWDrawList::Sort(HWDrawInfo *di, bool reverse, float sortz)
+{
+	reverseSort = reverse;
+	SortZ = sortz;
 	MakeSortList();
 	sorted = DoSort(di, SortNodes[SortNodeStart]);
 }
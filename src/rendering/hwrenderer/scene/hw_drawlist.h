@@ -69,6 +69,7 @@ struct HWDrawList
     float SortZ;
 	SortNode * sorted;
 	bool reverseSort;
+	bool replaymode;	// set by the draw list replay so that sorting never touches the vertex buffer
 	
 public:
 	HWDrawList()
@@ -76,6 +77,7 @@ public:
 		next=NULL;
 		SortNodeStart=-1;
 		sorted=NULL;
+		replaymode=false;
 	}
 	
 	~HWDrawList()
@@ -108,6 +110,7 @@ public:
 	SortNode * SortSpriteList(SortNode * head);
 	SortNode * DoSort(HWDrawInfo *di, SortNode * head);
 	void Sort(HWDrawInfo *di);
+	void Sort(HWDrawInfo *di, bool reverse, float sortz);
 
 	void DoDraw(HWDrawInfo *di, FRenderState &state, bool translucent, int i);
 	void Draw(HWDrawInfo *di, FRenderState &state, bool translucent);
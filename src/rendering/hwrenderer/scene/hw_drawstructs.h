@@ -268,7 +268,7 @@ public:
 		float fch1, float fch2, float ffh1, float ffh2,
 		float bch1, float bch2, float bfh1, float bfh2);
 
-	void ProcessDecal(HWDrawInfo* di, DBaseDecal* decal, const FVector3& normal);
+	HWDecal *ProcessDecal(HWDrawInfo* di, DBaseDecal* decal, const FVector3& normal, FFlatVertex *verts);
 	void ProcessDecals(HWDrawInfo* di);
 
 	int CreateVertices(FFlatVertex*& ptr, bool nosplit);
@@ -356,6 +356,24 @@ public:
 //==========================================================================
 
 
+// The parts of a pooled particle's setup that only depend on its subsector
+// and the current frame. These get calculated once per subsector instead of
+// once per particle.
+struct HWParticleBatch
+{
+	sector_t *sector;
+	int lightlevel;
+	uint8_t foglevel;
+	FColormap Colormap;			// Only valid if the sector has no 3D floor light list
+	bool hasLightList;
+	bool fullbrightScene;
+	bool backgroundCache;		// Textures may be loaded by the background thread
+	bool frozen;
+	double timefrac;
+
+	void Setup(HWDrawInfo *di, sector_t *sector);
+};
+
 class HWSprite
 {
 public:
@@ -412,7 +430,7 @@ public:
 	void PutSprite(HWDrawInfo *di, bool translucent, double ticFrac = 1.0);
 	void Process(HWDrawInfo *di, AActor* thing,sector_t * sector, area_t in_area, int thruportal = false, bool isSpriteShadow = false);
 	void ProcessParticle(HWDrawInfo* di, particle_t* particle, sector_t* sector, class DVisualThinker* spr);//, int shade, int fakeside)
-	void ProcessDefinedParticle(HWDrawInfo *di, particledata_t *particle, sector_t *sector);
+	void ProcessDefinedParticle(HWDrawInfo *di, particledata_t *particle, const HWParticleBatch &batch);
 	void AdjustVisualThinker(HWDrawInfo *di, DVisualThinker *spr, sector_t *sector);
 
 	void DrawSprite(HWDrawInfo *di, FRenderState &state, bool translucent);
@@ -445,7 +463,8 @@ struct HWDecal
 	sector_t *frontsector;
 	FVector3 Normal;
 
-	void DrawDecal(HWDrawInfo *di, FRenderState &state);
+	bool CanBatch(HWDecal *next, int count);
+	void DrawDecal(HWDrawInfo *di, FRenderState &state, int count = 1);
 
 };
 
@@ -465,4 +484,5 @@ struct FDynLightData;
 struct FDynamicLight;
 bool GetLight(FDynLightData& dld, int group, Plane& p, FDynamicLight* light, bool checkside, double ticFrac);
 void AddLightToList(FDynLightData &dld, int group, FDynamicLight* light, bool forceAttenuate, double ticFrac);
+void hw_InvalidatePackedLights();
 void SetSplitPlanes(FRenderState& state, const secplane_t& top, const secplane_t& bottom);
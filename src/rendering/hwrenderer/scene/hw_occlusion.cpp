@@ -0,0 +1,284 @@
+/*
+** hw_occlusion.cpp
+** CPU side occlusion buffer for the BSP traversal
+**
+*/
+
+#include <math.h>
+#include <string.h>
+#include <float.h>
+#include <algorithm>
+#include "matrix.h"
+#include "hw_occlusion.h"
+
+#ifdef ARCH_IA32
+#include <emmintrin.h>
+#endif
+
+static const float OCCLUSION_NEAR = 1.f;	// anything closer than this is never rasterized and never culled.
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void HWOcclusionBuffer::BeginScene(const VSMatrix &projection, const VSMatrix &view)
+{
+	VSMatrix mvp = projection;
+	mvp.multMatrix(view);
+	for (int i = 0; i < 16; i++) Matrix[i] = (float)mvp.get()[i];
+
+	memset(Depth, 0, sizeof(Depth));
+	memset(TileMin, 0, sizeof(TileMin));
+	numoccluders = 0;
+}
+
+//==========================================================================
+//
+// Map coordinates to buffer pixels. The renderer's coordinate system
+// has y and z swapped relative to the map.
+//
+//==========================================================================
+
+bool HWOcclusionBuffer::Project(const FVector3 &pos, ScreenVertex &v) const
+{
+	const float *m = Matrix;
+	float cx = m[0] * pos.X + m[4] * pos.Z + m[8] * pos.Y + m[12];
+	float cy = m[1] * pos.X + m[5] * pos.Z + m[9] * pos.Y + m[13];
+	float cw = m[3] * pos.X + m[7] * pos.Z + m[11] * pos.Y + m[15];
+
+	if (cw < OCCLUSION_NEAR) return false;
+
+	float invw = 1.f / cw;
+	v.x = (cx * invw * 0.5f + 0.5f) * Width;
+	v.y = (cy * invw * 0.5f + 0.5f) * Height;
+	v.invw = invw;
+	return true;
+}
+
+//==========================================================================
+//
+// Recalculates the farthest depth of all tiles in the given pixel range
+//
+//==========================================================================
+
+void HWOcclusionBuffer::UpdateTiles(int x0, int y0, int x1, int y1)
+{
+	int tx0 = x0 / TileSize, tx1 = (x1 - 1) / TileSize;
+	int ty0 = y0 / TileSize, ty1 = (y1 - 1) / TileSize;
+
+	for (int ty = ty0; ty <= ty1; ty++)
+	{
+		for (int tx = tx0; tx <= tx1; tx++)
+		{
+			const float *row = &Depth[ty * TileSize * Width + tx * TileSize];
+#ifdef ARCH_IA32
+			__m128 mn = _mm_load_ps(row);
+			for (int y = 0; y < TileSize; y++, row += Width)
+			{
+				mn = _mm_min_ps(mn, _mm_load_ps(row));
+				mn = _mm_min_ps(mn, _mm_load_ps(row + 4));
+			}
+			mn = _mm_min_ps(mn, _mm_shuffle_ps(mn, mn, _MM_SHUFFLE(1, 0, 3, 2)));
+			mn = _mm_min_ps(mn, _mm_shuffle_ps(mn, mn, _MM_SHUFFLE(2, 3, 0, 1)));
+			TileMin[ty * TilesX + tx] = _mm_cvtss_f32(mn);
+#else
+			float mn = row[0];
+			for (int y = 0; y < TileSize; y++, row += Width)
+			{
+				for (int x = 0; x < TileSize; x++) mn = row[x] < mn ? row[x] : mn;
+			}
+			TileMin[ty * TilesX + tx] = mn;
+#endif
+		}
+	}
+}
+
+//==========================================================================
+//
+// Rasterizes one occluder. Only pixels whose area is completely inside
+// the quad get written, and they receive the farthest depth the quad has
+// inside that pixel, so the buffer never claims more coverage than the
+// real geometry provides.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::AddOccluder(const FVector3 *corners)
+{
+	ScreenVertex sv[4];
+	for (int i = 0; i < 4; i++)
+	{
+		if (!Project(corners[i], sv[i])) return;
+	}
+
+	float area = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		int j = (i + 1) & 3;
+		area += sv[i].x * sv[j].y - sv[j].x * sv[i].y;
+	}
+	if (fabsf(area) < 2.f) return;	// too small to ever cover a full pixel.
+	if (area < 0)
+	{
+		std::swap(sv[1], sv[3]);
+	}
+
+	float minx = sv[0].x, maxx = sv[0].x, miny = sv[0].y, maxy = sv[0].y;
+	for (int i = 1; i < 4; i++)
+	{
+		minx = std::min(minx, sv[i].x);
+		maxx = std::max(maxx, sv[i].x);
+		miny = std::min(miny, sv[i].y);
+		maxy = std::max(maxy, sv[i].y);
+	}
+	int x0 = std::max(0, (int)floorf(minx));
+	int x1 = std::min((int)Width, (int)ceilf(maxx));
+	int y0 = std::max(0, (int)floorf(miny));
+	int y1 = std::min((int)Height, (int)ceilf(maxy));
+	if (x0 >= x1 || y0 >= y1) return;
+
+	// Edge functions, biased so that they are only positive if the entire pixel is inside.
+	float ea[4], eb[4], ec[4];
+	for (int i = 0; i < 4; i++)
+	{
+		auto &a = sv[i];
+		auto &b = sv[(i + 1) & 3];
+		ea[i] = a.y - b.y;
+		eb[i] = b.x - a.x;
+		ec[i] = -(ea[i] * a.x + eb[i] * a.y) - 0.5f * (fabsf(ea[i]) + fabsf(eb[i]));
+	}
+
+	// 1/w is linear in screen space for planar polygons.
+	// Use the triangle with the larger area to get a stable plane equation.
+	int i0 = 0, i1 = 1, i2 = 2;
+	float d1 = (sv[1].x - sv[0].x) * (sv[2].y - sv[0].y) - (sv[2].x - sv[0].x) * (sv[1].y - sv[0].y);
+	float d2 = (sv[2].x - sv[0].x) * (sv[3].y - sv[0].y) - (sv[3].x - sv[0].x) * (sv[2].y - sv[0].y);
+	if (fabsf(d2) > fabsf(d1))
+	{
+		i1 = 2;
+		i2 = 3;
+		d1 = d2;
+	}
+	if (d1 == 0) return;
+	float dx1 = sv[i1].x - sv[i0].x, dy1 = sv[i1].y - sv[i0].y, dz1 = sv[i1].invw - sv[i0].invw;
+	float dx2 = sv[i2].x - sv[i0].x, dy2 = sv[i2].y - sv[i0].y, dz2 = sv[i2].invw - sv[i0].invw;
+	float za = (dz1 * dy2 - dz2 * dy1) / d1;
+	float zb = (dx1 * dz2 - dx2 * dz1) / d1;
+	float zc = sv[i0].invw - za * sv[i0].x - zb * sv[i0].y - 0.5f * (fabsf(za) + fabsf(zb));
+
+	bool written = false;
+	for (int y = y0; y < y1; y++)
+	{
+		float cy = y + 0.5f;
+		float *row = &Depth[y * Width];
+
+#ifdef ARCH_IA32
+		int xs = x0 & ~3;
+		__m128 xoffs = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 zero = _mm_setzero_ps();
+		for (int x = xs; x < x1; x += 4)
+		{
+			__m128 cx = _mm_add_ps(_mm_set1_ps((float)x), xoffs);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int i = 0; i < 4; i++)
+			{
+				__m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[i]), cx), _mm_set1_ps(eb[i] * cy + ec[i]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(e, zero));
+			}
+			if (_mm_movemask_ps(inside) == 0) continue;
+
+			__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), cx), _mm_set1_ps(zb * cy + zc));
+			__m128 old = _mm_load_ps(row + x);
+			__m128 closer = _mm_and_ps(inside, _mm_cmpgt_ps(z, old));
+			_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(closer, z), _mm_andnot_ps(closer, old)));
+			written = true;
+		}
+#else
+		for (int x = x0; x < x1; x++)
+		{
+			float cx = x + 0.5f;
+			bool inside = true;
+			for (int i = 0; i < 4 && inside; i++)
+			{
+				inside = ea[i] * cx + eb[i] * cy + ec[i] >= 0;
+			}
+			if (!inside) continue;
+			float z = za * cx + zb * cy + zc;
+			if (z > row[x]) row[x] = z;
+			written = true;
+		}
+#endif
+	}
+
+	if (written)
+	{
+		numoccluders++;
+		UpdateTiles(x0, y0, x1, y1);
+	}
+}
+
+//==========================================================================
+//
+// A box is occluded if every pixel its projection touches is covered by
+// an occluder closer than the box's nearest point.
+//
+//==========================================================================
+
+bool HWOcclusionBuffer::IsBoxOccluded(const FVector3 &mins, const FVector3 &maxs)
+{
+	if (numoccluders == 0) return false;
+
+	float minx = FLT_MAX, maxx = -FLT_MAX, miny = FLT_MAX, maxy = -FLT_MAX, nearest = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		FVector3 corner((i & 1) ? maxs.X : mins.X, (i & 2) ? maxs.Y : mins.Y, (i & 4) ? maxs.Z : mins.Z);
+		ScreenVertex v;
+		if (!Project(corner, v)) return false;
+		minx = std::min(minx, v.x);
+		maxx = std::max(maxx, v.x);
+		miny = std::min(miny, v.y);
+		maxy = std::max(maxy, v.y);
+		nearest = std::max(nearest, v.invw);
+	}
+
+	int x0 = std::max(0, (int)floorf(minx));
+	int x1 = std::min((int)Width, (int)ceilf(maxx));
+	int y0 = std::max(0, (int)floorf(miny));
+	int y1 = std::min((int)Height, (int)ceilf(maxy));
+	if (x0 >= x1 || y0 >= y1) return false;	// off screen. This is for the frustum checks to decide.
+
+	for (int ty = y0 / TileSize; ty <= (y1 - 1) / TileSize; ty++)
+	{
+		for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; tx++)
+		{
+			if (TileMin[ty * TilesX + tx] >= nearest) continue;
+
+			// The tile has some pixels behind the box. Check whether any of them are inside the box's rectangle.
+			int px0 = std::max(x0, tx * TileSize), px1 = std::min(x1, (tx + 1) * TileSize);
+			int py0 = std::max(y0, ty * TileSize), py1 = std::min(y1, (ty + 1) * TileSize);
+			for (int y = py0; y < py1; y++)
+			{
+				const float *row = &Depth[y * Width];
+#ifdef ARCH_IA32
+				__m128 nz = _mm_set1_ps(nearest);
+				__m128 xoffs = _mm_setr_ps(0, 1, 2, 3);
+				__m128 limit0 = _mm_set1_ps((float)px0), limit1 = _mm_set1_ps((float)px1);
+				for (int x = px0 & ~3; x < px1; x += 4)
+				{
+					__m128 cx = _mm_add_ps(_mm_set1_ps((float)x), xoffs);
+					__m128 inrange = _mm_and_ps(_mm_cmpge_ps(cx, limit0), _mm_cmplt_ps(cx, limit1));
+					__m128 behind = _mm_and_ps(inrange, _mm_cmplt_ps(_mm_load_ps(row + x), nz));
+					if (_mm_movemask_ps(behind)) return false;
+				}
+#else
+				for (int x = px0; x < px1; x++)
+				{
+					if (row[x] < nearest) return false;
+				}
+#endif
+			}
+		}
+	}
+	return true;
+}
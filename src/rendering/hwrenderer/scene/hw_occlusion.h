@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vectors.h"
+
+class VSMatrix;
+
+//==========================================================================
+//
+// Low resolution software depth buffer for occlusion culling during BSP
+// traversal. Solid walls are rasterized into it front to back as the
+// BSP is walked, so that subsectors and things hidden behind them can
+// be rejected before any walls, flats or sprites get generated for them.
+//
+// The buffer stores 1/w, so larger values are closer to the viewer.
+// Occluders are rasterized conservatively (only pixels that are fully
+// covered, using the farthest depth within the pixel), and every 8x8
+// tile keeps the farthest depth it contains for quick rejection.
+//
+//==========================================================================
+
+class HWOcclusionBuffer
+{
+public:
+	enum
+	{
+		Width = 256,
+		Height = 128,
+		TileSize = 8,
+		TilesX = Width / TileSize,
+		TilesY = Height / TileSize,
+	};
+
+	void BeginScene(const VSMatrix &projection, const VSMatrix &view);
+
+	// The corners must describe a planar convex quad, in map coordinates.
+	void AddOccluder(const FVector3 *corners);
+	bool IsBoxOccluded(const FVector3 &mins, const FVector3 &maxs);
+
+	int NumOccluders() const { return numoccluders; }
+
+private:
+	struct ScreenVertex
+	{
+		float x, y, invw;
+	};
+
+	bool Project(const FVector3 &pos, ScreenVertex &v) const;
+	void UpdateTiles(int x0, int y0, int x1, int y1);
+
+	alignas(16) float Depth[Width * Height];
+	alignas(16) float TileMin[TilesX * TilesY];
+	float Matrix[16];
+	int numoccluders = 0;
+};
@@ -59,6 +59,7 @@
 #include "hw_lightbuffer.h"
 #include "hw_renderstate.h"
 #include "quaternion.h"
+#include "g_precache.h"
 
 extern TArray<spritedef_t> sprites;
 extern TArray<spriteframe_t> SpriteFrames;
@@ -1180,6 +1181,10 @@ void HWSprite::Process(HWDrawInfo *di, AActor* thing, sector_t * sector, area_t
 		z1 = z2 = z;
 		texture = nullptr;
 
+		for (int x = 0; x < modelframe->modelsAmount; x++)
+		{
+			G_RecordModelUse(modelframe->modelIDs[x]);
+		}
 
 		// Model textures will only load in the background thread if they are considered unimportant (Hacky solution)
 		// Because some models may define the visible world. In that case they should be precached to avoid stutter
@@ -1693,13 +1698,34 @@ void HWSprite::ProcessParticle(HWDrawInfo *di, particle_t *particle, sector_t *s
 	rendered_sprites++;
 }
 
-void HWSprite::ProcessDefinedParticle(HWDrawInfo* di, particledata_t* particle, sector_t* sector)
+void HWParticleBatch::Setup(HWDrawInfo* di, sector_t* sec)
+{
+	sector = sec;
+	lightlevel = hw_ClampLight(sec->GetSpriteLight());
+	foglevel = (uint8_t)clamp<short>(sec->lightlevel, 0, 255);
+	hasLightList = sec->e->XFloor.lightlist.Size() != 0;
+	fullbrightScene = di->isFullbrightScene();
+	frozen = di->Level->isFrozen();
+	timefrac = paused ? 0. : di->Viewpoint.TicFrac;
+	backgroundCache = gametic - primaryLevel->starttime > 2 &&	// On the first tic or so, do not use the background loader to avoid pop-in
+		gl_texture_thread &&
+		screen->SupportsBackgroundCache();
+
+	Colormap = sec->Colormap;
+	if (di->Level->flags3 & LEVEL3_NOCOLOREDSPRITELIGHTING)
+	{
+		Colormap.Decolorize();	// ZDoom never applies colored light to particles.
+	}
+}
+
+void HWSprite::ProcessDefinedParticle(HWDrawInfo* di, particledata_t* particle, const HWParticleBatch& batch)
 {
 	if (!particle || particle->alpha <= 0)
 		return;
 
-	lightlevel = hw_ClampLight(sector->GetSpriteLight());
-	foglevel = (uint8_t)clamp<short>(sector->lightlevel, 0, 255);
+	sector_t* sector = batch.sector;
+	lightlevel = batch.lightlevel;
+	foglevel = batch.foglevel;
 
 	DParticleDefinition* definition = particle->definition;
 
@@ -1718,10 +1744,14 @@ void HWSprite::ProcessDefinedParticle(HWDrawInfo* di, particledata_t* particle,
 	particleflags = particle->flags;
 	particlesubsector = particle->subsector;
 
-	if (di->isFullbrightScene())
+	if (batch.fullbrightScene)
 	{
 		Colormap.Clear();
 	}
+	else if (!(particle->flags & SPF_FULLBRIGHT) && !batch.hasLightList)
+	{
+		Colormap = batch.Colormap;
+	}
 	else if (!(particle->flags & SPF_FULLBRIGHT))
 	{
 		TArray<lightlist_t>& lightlist = sector->e->XFloor.lightlist;
@@ -1765,8 +1795,8 @@ void HWSprite::ProcessDefinedParticle(HWDrawInfo* di, particledata_t* particle,
 	ThingColor.a = 255;
 	const auto& vp = di->Viewpoint;
 
-	double timefrac = vp.TicFrac;
-	if (paused || (di->Level->isFrozen() && !(particle->flags & SPF_NOTIMEFREEZE)))
+	double timefrac = batch.timefrac;
+	if (batch.frozen && !(particle->flags & SPF_NOTIMEFREEZE))
 		timefrac = 0.;
 
 	int particle_style = particlehastexture ? 2 : gl_particles_style; // Treat custom texture the same as smooth particles
@@ -1805,10 +1835,7 @@ void HWSprite::ProcessDefinedParticle(HWDrawInfo* di, particledata_t* particle,
 			texture = TexMan.GetGameTexture(lump, false);
 
 			const FTextureID& lastTexture = particle->lastTexture;
-			if (lump != lastTexture &&
-				gametic - primaryLevel->starttime > 2 &&	// On the first tic or so, do not use the background loader to avoid pop-in
-				gl_texture_thread &&
-				screen->SupportsBackgroundCache()) 
+			if (lump != lastTexture && batch.backgroundCache)
 			{
 				int scaleflags = texture->ShouldExpandSprite() ? CTF_Expand : 0;
 				if (shouldUpscale(texture, UF_Sprite)) scaleflags |= CTF_Upscale;
@@ -1932,7 +1959,7 @@ void HWSprite::ProcessDefinedParticle(HWDrawInfo* di, particledata_t* particle,
 	if (particle_style != 2 && trans >= 1.0f - FLT_EPSILON) hw_styleflags = STYLEHW_Solid;
 	else hw_styleflags = STYLEHW_NoAlphaTest;
 
-	if (sector->e->XFloor.lightlist.Size() != 0 && !di->isFullbrightScene() && !fullbright)
+	if (batch.hasLightList && !batch.fullbrightScene && !fullbright)
 		lightlist = &sector->e->XFloor.lightlist;
 	else
 		lightlist = nullptr;
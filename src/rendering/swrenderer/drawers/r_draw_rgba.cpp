@@ -59,6 +59,10 @@
 #include "r_draw_sprite32_sse2.h"
 #include "r_draw_span32_sse2.h"
 #include "r_draw_sky32_sse2.h"
+#include "r_draw_wall32_avx2.h"
+#include "r_draw_sprite32_avx2.h"
+#include "r_draw_span32_avx2.h"
+#include "x86.h"
 #endif
 
 #include "gi.h"
@@ -78,66 +82,141 @@ CVAR(Bool, r_mipmap, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 // Level of detail texture bias
 CVAR(Float, r_lod_bias, -1.5, 0); // To do: add CVAR_ARCHIVE | CVAR_GLOBALCONFIG when a good default has been decided
 
+// Use the AVX2 drawers if the CPU supports them
+CVAR(Bool, r_avx2drawers, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+
 namespace swrenderer
 {
+#ifdef NO_SSE
+	// There are no AVX2 drawers on this platform. UseAVX2Drawers always returns false.
+	typedef DrawWall32Command DrawWall32AVX2Command;
+	typedef DrawWallMasked32Command DrawWallMasked32AVX2Command;
+	typedef DrawWallAddClamp32Command DrawWallAddClamp32AVX2Command;
+	typedef DrawWallSubClamp32Command DrawWallSubClamp32AVX2Command;
+	typedef DrawWallRevSubClamp32Command DrawWallRevSubClamp32AVX2Command;
+	typedef DrawSprite32Command DrawSprite32AVX2Command;
+	typedef DrawSpriteAddClamp32Command DrawSpriteAddClamp32AVX2Command;
+	typedef DrawSpriteSubClamp32Command DrawSpriteSubClamp32AVX2Command;
+	typedef DrawSpriteRevSubClamp32Command DrawSpriteRevSubClamp32AVX2Command;
+	typedef FillSprite32Command FillSprite32AVX2Command;
+	typedef FillSpriteAddClamp32Command FillSpriteAddClamp32AVX2Command;
+	typedef FillSpriteSubClamp32Command FillSpriteSubClamp32AVX2Command;
+	typedef FillSpriteRevSubClamp32Command FillSpriteRevSubClamp32AVX2Command;
+	typedef DrawSpriteShaded32Command DrawSpriteShaded32AVX2Command;
+	typedef DrawSpriteAddClampShaded32Command DrawSpriteAddClampShaded32AVX2Command;
+	typedef DrawSpriteTranslated32Command DrawSpriteTranslated32AVX2Command;
+	typedef DrawSpriteTranslatedAddClamp32Command DrawSpriteTranslatedAddClamp32AVX2Command;
+	typedef DrawSpriteTranslatedSubClamp32Command DrawSpriteTranslatedSubClamp32AVX2Command;
+	typedef DrawSpriteTranslatedRevSubClamp32Command DrawSpriteTranslatedRevSubClamp32AVX2Command;
+	typedef DrawSpan32Command DrawSpan32AVX2Command;
+	typedef DrawSpanMasked32Command DrawSpanMasked32AVX2Command;
+	typedef DrawSpanTranslucent32Command DrawSpanTranslucent32AVX2Command;
+	typedef DrawSpanAddClamp32Command DrawSpanAddClamp32AVX2Command;
+#endif
+
+	static bool UseAVX2Drawers()
+	{
+#ifdef NO_SSE
+		return false;
+#else
+		return CPU.bAVX2 && r_avx2drawers;
+#endif
+	}
+
 	void SWTruecolorDrawers::DrawWall(const WallDrawerArgs &args)
 	{
-		DrawWallColumns<DrawWall32Command>(args);
+		if (UseAVX2Drawers())
+			DrawWallColumns<DrawWall32AVX2Command>(args);
+		else
+			DrawWallColumns<DrawWall32Command>(args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallMasked(const WallDrawerArgs &args)
 	{
-		DrawWallColumns<DrawWallMasked32Command>(args);
+		if (UseAVX2Drawers())
+			DrawWallColumns<DrawWallMasked32AVX2Command>(args);
+		else
+			DrawWallColumns<DrawWallMasked32Command>(args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallAdd(const WallDrawerArgs &args)
 	{
-		DrawWallColumns<DrawWallAddClamp32Command>(args);
+		if (UseAVX2Drawers())
+			DrawWallColumns<DrawWallAddClamp32AVX2Command>(args);
+		else
+			DrawWallColumns<DrawWallAddClamp32Command>(args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallAddClamp(const WallDrawerArgs &args)
 	{
-		DrawWallColumns<DrawWallAddClamp32Command>(args);
+		if (UseAVX2Drawers())
+			DrawWallColumns<DrawWallAddClamp32AVX2Command>(args);
+		else
+			DrawWallColumns<DrawWallAddClamp32Command>(args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallSubClamp(const WallDrawerArgs &args)
 	{
-		DrawWallColumns<DrawWallSubClamp32Command>(args);
+		if (UseAVX2Drawers())
+			DrawWallColumns<DrawWallSubClamp32AVX2Command>(args);
+		else
+			DrawWallColumns<DrawWallSubClamp32Command>(args);
 	}
 	
 	void SWTruecolorDrawers::DrawWallRevSubClamp(const WallDrawerArgs &args)
 	{
-		DrawWallColumns<DrawWallRevSubClamp32Command>(args);
+		if (UseAVX2Drawers())
+			DrawWallColumns<DrawWallRevSubClamp32AVX2Command>(args);
+		else
+			DrawWallColumns<DrawWallRevSubClamp32Command>(args);
 	}
 	
 	void SWTruecolorDrawers::DrawColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSprite32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSprite32AVX2Command::DrawColumn(args);
+		else
+			DrawSprite32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillColumn(const SpriteDrawerArgs &args)
 	{
-		FillSprite32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			FillSprite32AVX2Command::DrawColumn(args);
+		else
+			FillSprite32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillAddColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			FillSpriteAddClamp32AVX2Command::DrawColumn(args);
+		else
+			FillSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillAddClampColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			FillSpriteAddClamp32AVX2Command::DrawColumn(args);
+		else
+			FillSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteSubClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			FillSpriteSubClamp32AVX2Command::DrawColumn(args);
+		else
+			FillSpriteSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillRevSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteRevSubClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			FillSpriteRevSubClamp32AVX2Command::DrawColumn(args);
+		else
+			FillSpriteRevSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawFuzzColumn(const SpriteDrawerArgs &args)
@@ -151,87 +230,138 @@ namespace swrenderer
 
 	void SWTruecolorDrawers::DrawAddColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteAddClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslated32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteTranslated32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteTranslated32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawTranslatedAddColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteTranslatedAddClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawShadedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteShaded32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteShaded32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteShaded32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawAddClampShadedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteAddClampShaded32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteAddClampShaded32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteAddClampShaded32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawAddClampColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteAddClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawAddClampTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteTranslatedAddClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteSubClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteSubClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawSubClampTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedSubClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteTranslatedSubClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteTranslatedSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawRevSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteRevSubClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteRevSubClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteRevSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawRevSubClampTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedRevSubClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpriteTranslatedRevSubClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpriteTranslatedRevSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawSpan(const SpanDrawerArgs &args)
 	{
-		DrawSpan32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpan32AVX2Command::DrawColumn(args);
+		else
+			DrawSpan32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMasked(const SpanDrawerArgs &args)
 	{
-		DrawSpanMasked32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpanMasked32AVX2Command::DrawColumn(args);
+		else
+			DrawSpanMasked32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanTranslucent(const SpanDrawerArgs &args)
 	{
-		DrawSpanTranslucent32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpanTranslucent32AVX2Command::DrawColumn(args);
+		else
+			DrawSpanTranslucent32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMaskedTranslucent(const SpanDrawerArgs &args)
 	{
-		DrawSpanAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpanAddClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpanAddClamp32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanAddClamp(const SpanDrawerArgs &args)
 	{
-		DrawSpanTranslucent32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpanTranslucent32AVX2Command::DrawColumn(args);
+		else
+			DrawSpanTranslucent32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMaskedAddClamp(const SpanDrawerArgs &args)
 	{
-		DrawSpanAddClamp32Command::DrawColumn(args);
+		if (UseAVX2Drawers())
+			DrawSpanAddClamp32AVX2Command::DrawColumn(args);
+		else
+			DrawSpanAddClamp32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSingleSkyColumn(const SkyDrawerArgs &args)
@@ -71,6 +71,14 @@ namespace swrenderer
 	#define VECTORCALL
 	#endif
 
+	// Allow the compiler to use AVX2 in these functions without enabling it for the whole file.
+	// Only call them after checking CPU.bAVX2.
+	#if defined(__GNUC__)
+	#define AVX2_TARGET __attribute__((target("avx2")))
+	#else
+	#define AVX2_TARGET
+	#endif
+
 	template<typename CommandType, typename BlendMode>
 	class DrawerBlendCommand : public CommandType
 	{
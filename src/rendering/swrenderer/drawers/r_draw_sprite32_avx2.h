@@ -0,0 +1,334 @@
+/*
+**  AVX2 drawer commands for sprites
+**
+**  Processes four pixels of the column per iteration instead of two.
+**  The math is identical to DrawSprite32T, so both produce the same output.
+**
+*/
+
+#pragma once
+
+#include <immintrin.h>
+#include "swrenderer/drawers/r_draw_sprite32_sse2.h"
+
+namespace swrenderer
+{
+	template<typename BlendT, typename SamplerT>
+	class DrawSprite32AVX2T
+	{
+	public:
+		typedef DrawSprite32T<BlendT, SamplerT> SSEDrawer;
+
+		AVX2_TARGET static void DrawColumn(const SpriteDrawerArgs& args)
+		{
+			using namespace DrawSprite32TModes;
+
+			auto shade_constants = args.ColormapConstants();
+			if (SamplerT::Mode == (int)SpriteSamplers::Texture)
+			{
+				const uint32_t *source2 = (const uint32_t*)args.TexturePixels2();
+				bool is_nearest_filter = (source2 == nullptr);
+
+				if (shade_constants.simple_shade)
+				{
+					if (is_nearest_filter)
+						Loop<SimpleShade, NearestFilter>(args, shade_constants);
+					else
+						Loop<SimpleShade, LinearFilter>(args, shade_constants);
+				}
+				else
+				{
+					if (is_nearest_filter)
+						Loop<AdvancedShade, NearestFilter>(args, shade_constants);
+					else
+						Loop<AdvancedShade, LinearFilter>(args, shade_constants);
+				}
+			}
+			else // no linear filtering for translated, shaded or fill
+			{
+				if (shade_constants.simple_shade)
+				{
+					Loop<SimpleShade, NearestFilter>(args, shade_constants);
+				}
+				else
+				{
+					Loop<AdvancedShade, NearestFilter>(args, shade_constants);
+				}
+			}
+		}
+
+		template<typename ShadeModeT, typename FilterModeT>
+		FORCEINLINE AVX2_TARGET static void VECTORCALL Loop(const SpriteDrawerArgs& args, ShadeConstants shade_constants)
+		{
+			using namespace DrawSprite32TModes;
+
+			const uint32_t *source;
+			const uint32_t *source2;
+			const uint8_t *colormap;
+			const uint32_t *translation;
+
+			if (SamplerT::Mode == (int)SpriteSamplers::Shaded || SamplerT::Mode == (int)SpriteSamplers::Translated)
+			{
+				source = (const uint32_t*)args.TexturePixels();
+				source2 = nullptr;
+				colormap = args.Colormap(args.Viewport());
+				translation = (const uint32_t*)args.TranslationMap();
+			}
+			else
+			{
+				source = (const uint32_t*)args.TexturePixels();
+				source2 = (const uint32_t*)args.TexturePixels2();
+				colormap = nullptr;
+				translation = nullptr;
+			}
+
+			int textureheight = args.TextureHeight();
+			uint32_t one = ((0x20000000 + textureheight - 1) / textureheight) * 2 + 1;
+
+			// Shade constants
+			__m128i dynlight = _mm_cvtsi32_si128(args.DynamicLight());
+			dynlight = _mm_unpacklo_epi8(dynlight, _mm_setzero_si128());
+			__m256i mdynlight = _mm256_broadcastq_epi64(dynlight);
+			int light = 256 - (args.Light() >> (FRACBITS - 8));
+			__m256i mlight = _mm256_broadcastsi128_si256(_mm_set_epi16(256, light, light, light, 256, light, light, light));
+
+			__m256i inv_desaturate, shade_fade, shade_light;
+			int desaturate;
+			__m256i lightcontrib;
+			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			{
+				__m256i inv_light = _mm256_broadcastsi128_si256(_mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light));
+				inv_desaturate = _mm256_broadcastsi128_si256(_mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate));
+				shade_fade = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue));
+				shade_fade = _mm256_mullo_epi16(shade_fade, inv_light);
+				shade_light = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue));
+				desaturate = shade_constants.desaturate;
+
+				lightcontrib = _mm256_min_epi16(_mm256_add_epi16(mlight, mdynlight), _mm256_set1_epi16(256));
+				lightcontrib = _mm256_sub_epi16(lightcontrib, mlight);
+			}
+			else
+			{
+				inv_desaturate = _mm256_setzero_si256();
+				shade_fade = _mm256_setzero_si256();
+				shade_light = _mm256_setzero_si256();
+				desaturate = 0;
+				lightcontrib = _mm256_setzero_si256();
+
+				mlight = _mm256_min_epi16(_mm256_add_epi16(mlight, mdynlight), _mm256_set1_epi16(256));
+			}
+
+			int count = args.Count();
+			if (count <= 0) return;
+			int pitch = args.Viewport()->RenderTarget->GetPitch();
+			uint32_t fracstep = args.TextureVStep();
+			uint32_t frac = args.TextureVPos();
+			uint32_t texturefracx = args.TextureUPos();
+			uint32_t *dest = (uint32_t*)args.Dest();
+
+			if (FilterModeT::Mode == (int)FilterModes::Linear)
+			{
+				frac -= one / 2;
+			}
+
+			uint32_t srcalpha = args.SrcAlpha() >> (FRACBITS - 8);
+			uint32_t destalpha = args.DestAlpha() >> (FRACBITS - 8);
+			uint32_t srccolor = args.SrcColorBgra();
+			uint32_t color = LightBgra::shade_bgra_simple(args.SolidColorBgra(),
+				LightBgra::calc_light_multiplier(light));
+
+			const bool readdest = BlendT::Mode != (int)SpriteBlendModes::Opaque && BlendT::Mode != (int)SpriteBlendModes::Copy;
+
+			int index = 0;
+			while (index < count)
+			{
+				int pixels = min(count - index, 4);
+				int offset = index * pitch;
+
+				uint32_t desttmp[4] = { 0, 0, 0, 0 };
+				unsigned int ifgcolor[4] = { 0, 0, 0, 0 };
+				unsigned int ifgshade[4] = { 0, 0, 0, 0 };
+				for (int i = 0; i < pixels; i++)
+				{
+					if (readdest)
+						desttmp[i] = dest[offset + i * pitch];
+					ifgcolor[i] = SSEDrawer::template Sample<FilterModeT>(frac, source, source2, translation, textureheight, one, texturefracx, color, srccolor);
+					ifgshade[i] = SSEDrawer::SampleShade(frac, source, colormap);
+					frac += fracstep;
+				}
+
+				__m256i bgcolor;
+				if (readdest)
+				{
+					bgcolor = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)desttmp));
+				}
+				else
+				{
+					bgcolor = _mm256_setzero_si256();
+				}
+
+				__m256i fgcolor = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)ifgcolor));
+
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor, desaturate, inv_desaturate, shade_fade, shade_light, lightcontrib);
+				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor, ifgshade, srcalpha, destalpha);
+
+				_mm_storeu_si128((__m128i*)desttmp, outcolor);
+				for (int i = 0; i < pixels; i++)
+				{
+					dest[offset + i * pitch] = desttmp[i];
+				}
+				index += 4;
+			}
+		}
+
+		// Packs four pixels of 16 bit lanes back into bytes.
+		FORCEINLINE AVX2_TARGET static __m128i VECTORCALL Pack(__m256i color)
+		{
+			return _mm_packus_epi16(_mm256_castsi256_si128(color), _mm256_extracti128_si256(color, 1));
+		}
+
+		// Puts one value per pixel into all four color lanes of that pixel.
+		FORCEINLINE AVX2_TARGET static __m256i VECTORCALL Spread(const unsigned int *v)
+		{
+			return _mm256_set_epi16(
+				v[3], v[3], v[3], v[3], v[2], v[2], v[2], v[2],
+				v[1], v[1], v[1], v[1], v[0], v[0], v[0], v[0]);
+		}
+
+		template<typename ShadeModeT>
+		FORCEINLINE AVX2_TARGET static __m256i VECTORCALL Shade(__m256i fgcolor, __m256i mlight, const unsigned int *ifgcolor, int desaturate, __m256i inv_desaturate, __m256i shade_fade, __m256i shade_light, __m256i lightcontrib)
+		{
+			using namespace DrawSprite32TModes;
+
+			if (BlendT::Mode == (int)SpriteBlendModes::Copy)
+				return fgcolor;
+
+			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
+			{
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, mlight), 8);
+				return fgcolor;
+			}
+			else
+			{
+				__m256i lit_dynlight = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, lightcontrib), 8);
+
+				int intensity[4];
+				for (int i = 0; i < 4; i++)
+				{
+					int blue = BPART(ifgcolor[i]);
+					int green = GPART(ifgcolor[i]);
+					int red = RPART(ifgcolor[i]);
+					intensity[i] = ((red * 77 + green * 143 + blue * 37) >> 8) * desaturate;
+				}
+
+				__m256i mintensity = _mm256_set_epi16(
+					0, intensity[3], intensity[3], intensity[3], 0, intensity[2], intensity[2], intensity[2],
+					0, intensity[1], intensity[1], intensity[1], 0, intensity[0], intensity[0], intensity[0]);
+
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(fgcolor, inv_desaturate), mintensity), 8);
+				fgcolor = _mm256_mullo_epi16(fgcolor, mlight);
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(shade_fade, fgcolor), 8);
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, shade_light), 8);
+
+				fgcolor = _mm256_add_epi16(fgcolor, lit_dynlight);
+				fgcolor = _mm256_min_epi16(fgcolor, _mm256_set1_epi16(255));
+				return fgcolor;
+			}
+		}
+
+		FORCEINLINE AVX2_TARGET static __m128i VECTORCALL Blend(__m256i fgcolor, __m256i bgcolor, const unsigned int *ifgcolor, const unsigned int *ifgshade, uint32_t srcalpha, uint32_t destalpha)
+		{
+			using namespace DrawSprite32TModes;
+
+			if (BlendT::Mode == (int)SpriteBlendModes::Opaque)
+			{
+				__m128i outcolor = Pack(fgcolor);
+				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
+				return outcolor;
+			}
+			else if (BlendT::Mode == (int)SpriteBlendModes::Shaded)
+			{
+				__m256i alpha = Spread(ifgshade);
+				__m256i inv_alpha = _mm256_sub_epi16(_mm256_set1_epi16(256), alpha);
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, alpha);
+				bgcolor = _mm256_mullo_epi16(bgcolor, inv_alpha);
+				__m128i outcolor = Pack(_mm256_srli_epi16(_mm256_add_epi16(fgcolor, bgcolor), 8));
+				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
+				return outcolor;
+			}
+			else if (BlendT::Mode == (int)SpriteBlendModes::AddClampShaded)
+			{
+				__m256i alpha = Spread(ifgshade);
+
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, alpha), 8);
+				__m128i outcolor = Pack(_mm256_add_epi16(fgcolor, bgcolor));
+				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
+				return outcolor;
+			}
+			else
+			{
+				unsigned int fgalpha[4], bgalpha[4];
+				for (int i = 0; i < 4; i++)
+				{
+					uint32_t alpha = APART(ifgcolor[i]);
+					alpha += alpha >> 7; // 255->256
+					uint32_t inv_alpha = 256 - alpha;
+					bgalpha[i] = (destalpha * alpha + (inv_alpha << 8) + 128) >> 8;
+					fgalpha[i] = (srcalpha * alpha + 128) >> 8;
+				}
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, Spread(fgalpha));
+				bgcolor = _mm256_mullo_epi16(bgcolor, Spread(bgalpha));
+
+				__m256i fg_lo = _mm256_unpacklo_epi16(fgcolor, _mm256_setzero_si256());
+				__m256i bg_lo = _mm256_unpacklo_epi16(bgcolor, _mm256_setzero_si256());
+				__m256i fg_hi = _mm256_unpackhi_epi16(fgcolor, _mm256_setzero_si256());
+				__m256i bg_hi = _mm256_unpackhi_epi16(bgcolor, _mm256_setzero_si256());
+
+				__m256i out_lo, out_hi;
+				if (BlendT::Mode == (int)SpriteBlendModes::AddClamp)
+				{
+					out_lo = _mm256_add_epi32(fg_lo, bg_lo);
+					out_hi = _mm256_add_epi32(fg_hi, bg_hi);
+				}
+				else if (BlendT::Mode == (int)SpriteBlendModes::SubClamp)
+				{
+					out_lo = _mm256_sub_epi32(fg_lo, bg_lo);
+					out_hi = _mm256_sub_epi32(fg_hi, bg_hi);
+				}
+				else
+				{
+					out_lo = _mm256_sub_epi32(bg_lo, fg_lo);
+					out_hi = _mm256_sub_epi32(bg_hi, fg_hi);
+				}
+
+				out_lo = _mm256_srai_epi32(out_lo, 8);
+				out_hi = _mm256_srai_epi32(out_hi, 8);
+				__m128i outcolor = Pack(_mm256_packs_epi32(out_lo, out_hi));
+				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
+				return outcolor;
+			}
+		}
+	};
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::CopySprite, DrawSprite32TModes::TextureSampler> DrawSpriteCopy32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::OpaqueSprite, DrawSprite32TModes::TextureSampler> DrawSprite32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampSprite, DrawSprite32TModes::TextureSampler> DrawSpriteAddClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::SubClampSprite, DrawSprite32TModes::TextureSampler> DrawSpriteSubClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::RevSubClampSprite, DrawSprite32TModes::TextureSampler> DrawSpriteRevSubClamp32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::OpaqueSprite, DrawSprite32TModes::FillSampler> FillSprite32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampSprite, DrawSprite32TModes::FillSampler> FillSpriteAddClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::SubClampSprite, DrawSprite32TModes::FillSampler> FillSpriteSubClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::RevSubClampSprite, DrawSprite32TModes::FillSampler> FillSpriteRevSubClamp32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::ShadedSprite, DrawSprite32TModes::ShadedSampler> DrawSpriteShaded32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampShadedSprite, DrawSprite32TModes::ShadedSampler> DrawSpriteAddClampShaded32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::OpaqueSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslated32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslatedAddClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::SubClampSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslatedSubClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::RevSubClampSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslatedRevSubClamp32AVX2Command;
+}
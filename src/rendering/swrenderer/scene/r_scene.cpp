@@ -63,6 +63,7 @@ EXTERN_CVAR(Int, r_clearbuffer)
 EXTERN_CVAR(Int, r_debug_draw)
 
 CVAR(Int, r_scene_multithreaded, 1, 0);
+CVAR(Bool, r_scene_balance, true, 0);
 CVAR(Bool, r_models, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 namespace swrenderer
@@ -192,9 +193,8 @@ namespace swrenderer
 		{
 			*Threads[i]->Viewport = *MainThread()->Viewport;
 			*Threads[i]->Light = *MainThread()->Light;
-			Threads[i]->X1 = viewwidth * i / numThreads;
-			Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
 		}
+		PartitionSlices(numThreads);
 		run_id++;
 		FSoftwareTexture::CurrentUpdate = run_id;
 		start_lock.unlock();
@@ -221,13 +221,95 @@ namespace swrenderer
 			finished_threads = 0;
 		}
 
+		UpdateSliceCosts(numThreads);
+
 		// Change main thread back to covering the whole screen for player sprites
 		MainThread()->X1 = 0;
 		MainThread()->X2 = viewwidth;
 	}
 
+	// Slices covering busy geometry take a lot longer than ones looking at the sky,
+	// so instead of giving every thread the same width, the slices get sized so that
+	// each one gets the same share of the time the previous frames took to render.
+	void RenderScene::PartitionSlices(int numThreads)
+	{
+		int minwidth = viewwidth / (numThreads * 8);
+		bool balance = r_scene_balance && numThreads > 1 && minwidth > 0 && (int)ColumnCost.size() == viewwidth && !MainThread()->Viewport->RenderingToCanvas;
+
+		double total = 0.0;
+		if (balance)
+		{
+			for (float cost : ColumnCost)
+				total += cost;
+		}
+
+		if (total <= 0.0)
+		{
+			for (int i = 0; i < numThreads; i++)
+			{
+				Threads[i]->X1 = viewwidth * i / numThreads;
+				Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			}
+			return;
+		}
+
+		int x = 0;
+		double sum = 0.0;
+		for (int i = 0; i < numThreads - 1; i++)
+		{
+			double target = total * (i + 1) / numThreads;
+			int maxx = viewwidth - minwidth * (numThreads - 1 - i);
+
+			Threads[i]->X1 = x;
+			int end = x;
+			while (end < x + minwidth)
+				sum += ColumnCost[end++];
+			while (end < maxx && sum + ColumnCost[end] * 0.5 < target)
+				sum += ColumnCost[end++];
+			Threads[i]->X2 = end;
+			x = end;
+		}
+		Threads[numThreads - 1]->X1 = x;
+		Threads[numThreads - 1]->X2 = viewwidth;
+	}
+
+	struct SliceStat
+	{
+		int X1, X2;
+		double Time;
+	};
+	static TArray<SliceStat> SliceStats;
+
+	void RenderScene::UpdateSliceCosts(int numThreads)
+	{
+		// Camera textures have nothing to do with the cost of the main view.
+		if (MainThread()->Viewport->RenderingToCanvas)
+			return;
+
+		bool reset = (int)ColumnCost.size() != viewwidth;
+		if (reset)
+			ColumnCost.assign(viewwidth, 0.0f);
+
+		SliceStats.Resize(numThreads);
+		for (int i = 0; i < numThreads; i++)
+		{
+			RenderThread *thread = Threads[i].get();
+			SliceStats[i] = { thread->X1, thread->X2, thread->SliceTime };
+
+			// The time can only be known per slice, so it gets spread evenly over its columns.
+			// Blending with the previous frames sharpens this as the slice edges move around.
+			if (thread->X2 <= thread->X1)
+				continue;
+			float cost = float(thread->SliceTime / (thread->X2 - thread->X1));
+			for (int x = thread->X1; x < thread->X2; x++)
+				ColumnCost[x] = reset ? cost : ColumnCost[x] * 0.5f + cost * 0.5f;
+		}
+	}
+
 	void RenderScene::RenderThreadSlice(RenderThread *thread)
 	{
+		auto starttime = std::chrono::steady_clock::now();
+
 		thread->FrameMemory->Clear();
 		thread->Clip3D->Cleanup();
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
@@ -260,6 +342,8 @@ namespace swrenderer
 			thread->TranslucentPass->Render();
 		}
 
+		thread->SliceTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - starttime).count();
+
 #if 0 // shows the render slice edges
 		if (thread->Viewport->RenderTarget->IsBgra())
 		{
@@ -396,6 +480,21 @@ namespace swrenderer
 		return out;
 	}
 
+	ADD_STAT(swthreads)
+	{
+		FString out;
+		double total = 0.0, slowest = 0.0;
+		for (auto &slice : SliceStats)
+		{
+			out.AppendFormat("slice %d-%d: %04.1f ms\n", slice.X1, slice.X2, slice.Time);
+			total += slice.Time;
+			slowest = max(slowest, slice.Time);
+		}
+		if (SliceStats.Size() > 0 && total > 0.0)
+			out.AppendFormat("imbalance (slowest / average): %.2f", slowest * SliceStats.Size() / total);
+		return out;
+	}
+
 	static double f_acc, w_acc, p_acc, m_acc;
 	static int acc_c;
 
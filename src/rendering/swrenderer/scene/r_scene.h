@@ -59,6 +59,8 @@ namespace swrenderer
 		void RenderActorView(AActor *actor,bool renderplayersprite, bool dontmaplines);
 		void RenderThreadSlices();
 		void RenderThreadSlice(RenderThread *thread);
+		void PartitionSlices(int numThreads);
+		void UpdateSliceCosts(int numThreads);
 		void RenderPSprites();
 
 		void StartThreads(size_t numThreads);
@@ -75,5 +77,8 @@ namespace swrenderer
 		std::mutex end_mutex;
 		std::condition_variable end_condition;
 		size_t finished_threads = 0;
+
+		// Smoothed render time per screen column over the last frames, used to balance the slices.
+		std::vector<float> ColumnCost;
 	};
 }
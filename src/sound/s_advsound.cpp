@@ -1843,6 +1843,145 @@ DEFINE_ACTION_FUNCTION(AAmbientSound, GetAudibleRange)
 	ACTION_RETURN_FLOAT(GetRange(self));
 }
 
+//==========================================================================
+//
+// Ambient sounds that nobody can hear sleep until a listener gets close.
+//
+// The map is split into a coarse grid. A sleeping sound is listed in
+// every cell its audible range reaches, and only goes to sleep when no
+// listener is in any of them. Whenever a listener moves into another
+// cell, everything listed there gets woken up and does its own range
+// check again, so only the sounds near a listener ever tick.
+//
+//==========================================================================
+
+#define AMBIENT_CELL_SIZE	512.
+
+static AActor *GetAmbientListener(FLevelLocals *Level, int i)
+{
+	if (!Level->PlayerInGame(i)) return nullptr;
+	auto p = Level->Players[i];
+	return p->camera != nullptr && p->camera->player == nullptr ? p->camera : p->mo;
+}
+
+static int GetAmbientCellX(FLevelLocals *Level, double x)
+{
+	return clamp(int((x - Level->blockmap.bmaporgx) / AMBIENT_CELL_SIZE), 0, Level->AmbientCellsWidth - 1);
+}
+
+static int GetAmbientCellY(FLevelLocals *Level, double y)
+{
+	return clamp(int((y - Level->blockmap.bmaporgy) / AMBIENT_CELL_SIZE), 0, Level->AmbientCellsHeight - 1);
+}
+
+static void LinkAmbient(FLevelLocals *Level, AActor *self, double range)
+{
+	int x1 = GetAmbientCellX(Level, self->X() - range), x2 = GetAmbientCellX(Level, self->X() + range);
+	int y1 = GetAmbientCellY(Level, self->Y() - range), y2 = GetAmbientCellY(Level, self->Y() + range);
+
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+		{
+			// Cells only get emptied when a listener enters them, so this sound may still be listed from an earlier sleep.
+			auto &cell = Level->AmbientCells[x + y * Level->AmbientCellsWidth];
+			bool listed = false;
+			for (auto &a : cell)
+			{
+				if (a.ForceGet() == self)
+				{
+					listed = true;
+					break;
+				}
+			}
+			if (!listed) cell.Push(MakeObjPtr<AActor*>(self));
+		}
+	}
+}
+
+static void InitAmbientCells(FLevelLocals *Level)
+{
+	Level->AmbientCellsWidth = max(1, int(Level->blockmap.bmapwidth * FBlockmap::MAPBLOCKUNITS / AMBIENT_CELL_SIZE) + 1);
+	Level->AmbientCellsHeight = max(1, int(Level->blockmap.bmapheight * FBlockmap::MAPBLOCKUNITS / AMBIENT_CELL_SIZE) + 1);
+	Level->AmbientCells.Clear();
+	Level->AmbientCells.Resize(Level->AmbientCellsWidth * Level->AmbientCellsHeight);
+	for (auto &c : Level->AmbientListenerCells) c = -1;
+
+	// After loading a savegame the sleeping sounds need to be listed again.
+	auto it = Level->GetThinkerIterator<AActor>(NAME_AmbientSound, STAT_SLEEP_FOREVER);
+	for (AActor *self = it.Next(); self != nullptr; self = it.Next())
+	{
+		LinkAmbient(Level, self, GetRange(self));
+	}
+	Level->AmbientCellsValid = true;
+}
+
+static void WakeAmbient(AActor *self)
+{
+	// Does nothing if it is awake.
+	if (self->IsKindOf(NAME_AmbientSound))
+	{
+		self->Wake();
+	}
+}
+
+void S_UpdateAmbientCells(FLevelLocals *Level)
+{
+	if (!Level->AmbientCellsValid) InitAmbientCells(Level);
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		AActor *mo = GetAmbientListener(Level, i);
+		if (mo == nullptr) continue;
+
+		int cell = GetAmbientCellX(Level, mo->X()) + GetAmbientCellY(Level, mo->Y()) * Level->AmbientCellsWidth;
+		if (cell == Level->AmbientListenerCells[i]) continue;
+		Level->AmbientListenerCells[i] = cell;
+
+		auto &sleepers = Level->AmbientCells[cell];
+		for (auto &a : sleepers)
+		{
+			if (a != nullptr) WakeAmbient(a);
+		}
+		sleepers.Clear();
+	}
+}
+
+// Only sounds that have nothing left to do until somebody comes close can sleep.
+static bool TrySleepAmbient(AActor *self, FAmbientSound *ambient)
+{
+	auto Level = self->Level;
+
+	if (Level->maptime <= 6) return false;			// not activated yet
+	if (Level->Displacements.size > 1) return false;	// the range checks do not work through portals
+	if (!self->Vel.isZero() || (!(self->flags & MF_NOGRAVITY) && self->Z() > self->floorz)) return false;
+
+	if (self->special2)
+	{
+		bool loop = (ambient->type & CONTINUOUS) == CONTINUOUS;
+		// Still playing, or waiting for the next repeat.
+		if (loop ? self->special1 == INT_MAX : self->special1 != 0) return false;
+	}
+
+	double range = GetRange(self);
+	if (range <= 0) return false;
+
+	if (!Level->AmbientCellsValid) InitAmbientCells(Level);
+	int x1 = GetAmbientCellX(Level, self->X() - range), x2 = GetAmbientCellX(Level, self->X() + range);
+	int y1 = GetAmbientCellY(Level, self->Y() - range), y2 = GetAmbientCellY(Level, self->Y() + range);
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		AActor *mo = GetAmbientListener(Level, i);
+		if (mo == nullptr) continue;
+		int x = GetAmbientCellX(Level, mo->X()), y = GetAmbientCellY(Level, mo->Y());
+		if (x >= x1 && x <= x2 && y >= y1 && y <= y2) return false;
+	}
+
+	LinkAmbient(Level, self, range);
+	self->SleepIndefinite();
+	return true;
+}
+
 
 DEFINE_ACTION_FUNCTION(AAmbientSound, IsLooping)
 {
@@ -1862,6 +2001,8 @@ DEFINE_ACTION_FUNCTION(AAmbientSound, StartPlaying)
 
 	FAmbientSound* ambient = Ambients.CheckKey(self->args[0]);
 	if (ambient != NULL) {
+		// Linked sounds get started by each other, and need to tick to stop again.
+		WakeAmbient(self);
 		ACTION_RETURN_BOOL(StartAmbient(self, ambient, (ambient->type & CONTINUOUS) != 0));
 	}
 
@@ -1893,7 +2034,11 @@ DEFINE_ACTION_FUNCTION(AAmbientSound, AmbientTick)
 	}
 
 	if (!self->special2)
+	{
+		FAmbientSound *ambient = Ambients.CheckKey(self->args[0]);
+		if (ambient != NULL) TrySleepAmbient(self, ambient);
 		return 0;
+	}
 
 	FAmbientSound *ambient;
 	//EChanFlags loop = 0;
@@ -1916,6 +2061,11 @@ DEFINE_ACTION_FUNCTION(AAmbientSound, AmbientTick)
 		return 0;
 	}
 
+	if (TrySleepAmbient(self, ambient))
+	{
+		return 0;
+	}
+
 	bool inRange = false;
 
 	// @Cockatrice - If an ambient sound falls in the forest and there is no player around to hear it, does it actually play? 
@@ -2004,6 +2154,7 @@ DEFINE_ACTION_FUNCTION(AAmbientSound, ActivateAmbient)
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT(activator, AActor);
 		
+	WakeAmbient(self);
 	self->Activate(activator);
 	FAmbientSound *amb = Ambients.CheckKey(self->args[0]);
 
@@ -68,6 +68,7 @@
 #include "v_draw.h"
 #include "m_argv.h"
 #include "s_loader.h"
+#include "g_precache.h"
 
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
@@ -86,6 +87,10 @@ class DoomSoundEngine : public SoundEngine
 	TArray<uint8_t> ReadSound(int lumpnum);
 	FSoundID PickReplacement(FSoundID refid);
 	FSoundID ResolveSound(const void *ent, int type, FSoundID soundid, float &attenuation) override;
+	void NoteSoundUse(FSoundID soundid) override
+	{
+		G_RecordSoundUse(soundid);
+	}
 	void CacheSound(sfxinfo_t* sfx) override;
 	void StopChannel(FSoundChan* chan) override;
 	FSoundID AddSoundLump(const char* logicalname, int lump, int CurrentPitchMask, int resid = -1, int nearlimit = 2) override
@@ -360,6 +365,11 @@ void S_PrecacheLevel(FLevelLocals* Level)
 		{
 			soundEngine->MarkUsed(snd);
 		}
+		// And everything that was played here last time.
+		for (auto &entry : LevelPrecacheManifest.Sounds)
+		{
+			soundEngine->MarkUsed(FSoundID::fromInt(entry.Index));
+		}
 		soundEngine->CacheMarkedSounds();
 	}
 }
@@ -79,6 +79,7 @@ FSoundID S_AddPlayerSoundExisting (const char *playerclass, const int gender, FS
 void S_MarkPlayerSounds (AActor *player);
 void S_ShrinkPlayerSoundLists ();
 unsigned int S_GetMSLength(FSoundID sound);
+void S_UpdateAmbientCells(FLevelLocals *Level);
 
 // [RH] Prints sound debug info to the screen.
 //		Modelled after Hexen's noise cheat.